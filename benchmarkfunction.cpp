@@ -0,0 +1,581 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmarkfunction.h"
+
+#include <math.h>
+
+#include "philoxrandom.h"
+
+namespace
+{
+    const double pi = 3.14159265358979323846;
+    const double schwefel_minimum = 420.968746227503;
+    const double schwefel_constant = 418.982887272433799807913601398;
+
+    struct BenchmarkInfo
+    {
+        const char *name;
+        double      min;            //search domain in each coordinate
+        double      max;
+        double      minimum;        //coordinate of the global minimum
+    };
+
+    const BenchmarkInfo benchmark_info[BenchmarkFunction::NUMBER_OF_TYPES] =
+    {
+        {"sphere",      -5.12,    5.12,   0.},
+        {"rosenbrock",  -2.048,   2.048,  1.},
+        {"rastrigin",   -5.12,    5.12,   0.},
+        {"ackley",      -32.768,  32.768, 0.},
+        {"griewank",    -600.,    600.,   0.},
+        {"schwefel",    -500.,    500.,   schwefel_minimum},
+        {"levy",        -10.,     10.,    1.}
+    };
+}
+
+/**
+    \param[in] type_
+    \param[in] dim      number of variables, at least one
+*/
+BenchmarkFunction::BenchmarkFunction( Type type_, size_t dim ) : type( type_ ), dimension( dim ), shifted( false ), rotated( false ), shift_seed( 0 ), rotation_seed( 0 )
+{
+    if( type < 0 || type >= NUMBER_OF_TYPES )
+    {
+        throw RuntimeError( "Unknown benchmark function!" );
+    }
+
+    if( dimension == 0 )
+    {
+        throw RuntimeError( "A benchmark function needs at least one variable!" );
+    }
+}
+
+void BenchmarkFunction::setType( Type type_ )
+{
+    if( type_ < 0 || type_ >= NUMBER_OF_TYPES )
+    {
+        throw RuntimeError( "Unknown benchmark function!" );
+    }
+
+    type = type_;
+    updateTransformation();
+}
+
+BenchmarkFunction::Type BenchmarkFunction::getType() const
+{
+    return type;
+}
+
+/**
+    Changes the number of variables, a shift and rotation are drawn again
+    from their seeds for the new dimension.
+*/
+void BenchmarkFunction::setDimension( size_t dim )
+{
+    if( dim == 0 )
+    {
+        throw RuntimeError( "A benchmark function needs at least one variable!" );
+    }
+
+    dimension = dim;
+    updateTransformation();
+}
+
+size_t BenchmarkFunction::getDimension() const
+{
+    return dimension;
+}
+
+/**
+    Moves the global minimum to a point drawn uniformly from the inner 80% of
+    the search domain, see \ref getDomain. The same seed always yields the same
+    shift for a given type and dimension.
+
+    \param[in] seed
+*/
+void BenchmarkFunction::setShift( uint64_t seed )
+{
+    shifted = true;
+    shift_seed = seed;
+    updateTransformation();
+}
+
+/**
+    Rotates the coordinate system by a random orthogonal matrix, which makes
+    the separable functions like RASTRIGIN non separable. The matrix is built
+    by orthonormalizing normal distributed rows, the same seed always yields
+    the same matrix for a given dimension.
+
+    \param[in] seed
+*/
+void BenchmarkFunction::setRotation( uint64_t seed )
+{
+    rotated = true;
+    rotation_seed = seed;
+    updateTransformation();
+}
+
+void BenchmarkFunction::removeShift()
+{
+    shifted = false;
+    updateTransformation();
+}
+
+void BenchmarkFunction::removeRotation()
+{
+    rotated = false;
+    updateTransformation();
+}
+
+bool BenchmarkFunction::isShifted() const
+{
+    return shifted;
+}
+
+bool BenchmarkFunction::isRotated() const
+{
+    return rotated;
+}
+
+/**
+    Returns the name of the function with the prefixes "shifted_" and
+    "rotated_" for the variants, for example "shifted_rotated_rastrigin".
+*/
+std::string BenchmarkFunction::getName() const
+{
+    return std::string( shifted ? "shifted_" : "" ) + std::string( rotated ? "rotated_" : "" ) + getName( type );
+}
+
+/**
+    Returns the position of the global minimum in \a x.
+*/
+void BenchmarkFunction::getMinimum( VectorN<double> &x ) const
+{
+    x.resize( dimension );
+
+    for( size_t i = 0; i < dimension; i++ )
+    {
+        x[i] = shift.empty() ? getMinimum( type ) : shift[i];
+    }
+}
+
+/**
+    Evaluates the function at position x and returns the result
+
+    \param[in] x
+*/
+double BenchmarkFunction::operator()( VectorN<double> &x )
+{
+    if( x.size() < dimension )
+    {
+        throw RuntimeError( "Error evaluating function: to few variables given in x!" );
+    }
+
+    return ( *getKernel( type ) )( transform( &x[0] ), dimension );
+}
+
+/**
+    Same as \ref operator()(VectorN<double>&) but evaluates the function at a
+    position provided as view, for example a row of the \ref ParticleStore.
+
+    \param[in] x
+*/
+double BenchmarkFunction::operator()( const VectorView<double> &x )
+{
+    if( x.size() < dimension )
+    {
+        throw RuntimeError( "Error evaluating function: to few variables given in x!" );
+    }
+
+    return ( *getKernel( type ) )( transform( x.getData() ), dimension );
+}
+
+/**
+    Evaluates the function at \a count points. The coordinates of point i
+    start at positions[i * stride], its result is written to out[i].
+
+    \param[in]  positions
+    \param[in]  count
+    \param[in]  stride    distance between two points, at least the dimension
+    \param[out] out
+*/
+void BenchmarkFunction::evaluateBatch( const double *positions, size_t count, size_t stride, double *out )
+{
+    if( stride < dimension )
+    {
+        throw RuntimeError( "Error evaluating function: to few variables given in x!" );
+    }
+
+    Kernel kernel = getKernel( type );
+
+    if( shift.empty() )
+    {
+        for( size_t i = 0; i < count; i++ )
+        {
+            out[i] = ( *kernel )( positions + i * stride, dimension );
+        }
+    }
+    else
+    {
+        for( size_t i = 0; i < count; i++ )
+        {
+            out[i] = ( *kernel )( transform( positions + i * stride ), dimension );
+        }
+    }
+}
+
+std::string BenchmarkFunction::getName( Type type_ )
+{
+    return benchmark_info[type_].name;
+}
+
+/**
+    Looks up the type of the function \a name, as returned by the static
+    \ref getName. Returns false if the name is unknown.
+
+    \param[in]  name
+    \param[out] type_
+*/
+bool BenchmarkFunction::getType( const std::string &name, Type &type_ )
+{
+    for( int i = 0; i < NUMBER_OF_TYPES; i++ )
+    {
+        if( name == benchmark_info[i].name )
+        {
+            type_ = static_cast<Type>( i );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+    Returns the usual search domain [min, max] of each coordinate.
+*/
+void BenchmarkFunction::getDomain( Type type_, double &min, double &max )
+{
+    min = benchmark_info[type_].min;
+    max = benchmark_info[type_].max;
+}
+
+/**
+    Returns the coordinate of the global minimum of the plain function,
+    which is the same for all coordinates.
+*/
+double BenchmarkFunction::getMinimum( Type type_ )
+{
+    return benchmark_info[type_].minimum;
+}
+
+double BenchmarkFunction::sphere( const double *x, size_t n )
+{
+    double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+    size_t i = 0;
+
+    for( ; i + 4 <= n; i += 4 )
+    {
+        s0 += x[i] * x[i];
+        s1 += x[i + 1] * x[i + 1];
+        s2 += x[i + 2] * x[i + 2];
+        s3 += x[i + 3] * x[i + 3];
+    }
+
+    for( ; i < n; i++ )
+    {
+        s0 += x[i] * x[i];
+    }
+
+    return ( s0 + s1 ) + ( s2 + s3 );
+}
+
+double BenchmarkFunction::rosenbrock( const double *x, size_t n )
+{
+    double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+    size_t i = 0;
+
+    for( ; i + 5 <= n; i += 4 )
+    {
+        double a0 = x[i + 1] - x[i] * x[i], b0 = 1. - x[i];
+        double a1 = x[i + 2] - x[i + 1] * x[i + 1], b1 = 1. - x[i + 1];
+        double a2 = x[i + 3] - x[i + 2] * x[i + 2], b2 = 1. - x[i + 2];
+        double a3 = x[i + 4] - x[i + 3] * x[i + 3], b3 = 1. - x[i + 3];
+        s0 += 100. * a0 * a0 + b0 * b0;
+        s1 += 100. * a1 * a1 + b1 * b1;
+        s2 += 100. * a2 * a2 + b2 * b2;
+        s3 += 100. * a3 * a3 + b3 * b3;
+    }
+
+    for( ; i + 1 < n; i++ )
+    {
+        double a = x[i + 1] - x[i] * x[i], b = 1. - x[i];
+        s0 += 100. * a * a + b * b;
+    }
+
+    return ( s0 + s1 ) + ( s2 + s3 );
+}
+
+double BenchmarkFunction::rastrigin( const double *x, size_t n )
+{
+    double sum = 10. * n;
+
+    for( size_t i = 0; i < n; i++ )
+    {
+        sum += x[i] * x[i] - 10. * cos( 2. * pi * x[i] );
+    }
+
+    return sum;
+}
+
+double BenchmarkFunction::ackley( const double *x, size_t n )
+{
+    double sum_square = 0., sum_cos = 0.;
+
+    for( size_t i = 0; i < n; i++ )
+    {
+        sum_square += x[i] * x[i];
+        sum_cos += cos( 2. * pi * x[i] );
+    }
+
+    return -20. * exp( -0.2 * sqrt( sum_square / n ) ) - exp( sum_cos / n ) + 20. + M_E;
+}
+
+double BenchmarkFunction::griewank( const double *x, size_t n )
+{
+    double sum = 0., product = 1.;
+
+    for( size_t i = 0; i < n; i++ )
+    {
+        sum += x[i] * x[i];
+        product *= cos( x[i] / sqrt( i + 1. ) );
+    }
+
+    return 1. + sum / 4000. - product;
+}
+
+/**
+    Outside of [-500, 500] the function is unbounded below, there the
+    coordinate is folded back into the domain and a quadratic penalty is
+    added like in the CEC benchmark suites. This keeps the global minimum
+    when the shifted or rotated variant maps a point outside of the domain.
+*/
+double BenchmarkFunction::schwefel( const double *x, size_t n )
+{
+    double sum = schwefel_constant * n;
+
+    for( size_t i = 0; i < n; i++ )
+    {
+        double z = x[i];
+
+        if( z > 500. )
+        {
+            double folded = 500. - fmod( z, 500. );
+            sum -= folded * sin( sqrt( fabs( folded ) ) ) - ( z - 500. ) * ( z - 500. ) / ( 10000. * n );
+        }
+        else if( z < -500. )
+        {
+            double folded = fmod( -z, 500. ) - 500.;
+            sum -= folded * sin( sqrt( fabs( folded ) ) ) - ( z + 500. ) * ( z + 500. ) / ( 10000. * n );
+        }
+        else
+        {
+            sum -= z * sin( sqrt( fabs( z ) ) );
+        }
+    }
+
+    return sum;
+}
+
+double BenchmarkFunction::levy( const double *x, size_t n )
+{
+    double w = 1. + ( x[0] - 1. ) / 4.;
+    double s = sin( pi * w );
+    double sum = s * s;
+
+    for( size_t i = 0; i + 1 < n; i++ )
+    {
+        w = 1. + ( x[i] - 1. ) / 4.;
+        s = sin( pi * w + 1. );
+        sum += ( w - 1. ) * ( w - 1. ) * ( 1. + 10. * s * s );
+    }
+
+    w = 1. + ( x[n - 1] - 1. ) / 4.;
+    s = sin( 2. * pi * w );
+    sum += ( w - 1. ) * ( w - 1. ) * ( 1. + s * s );
+
+    return sum;
+}
+
+BenchmarkFunction::Kernel BenchmarkFunction::getKernel( Type type_ )
+{
+    switch( type_ )
+    {
+        case ROSENBROCK:
+            return rosenbrock;
+
+        case RASTRIGIN:
+            return rastrigin;
+
+        case ACKLEY:
+            return ackley;
+
+        case GRIEWANK:
+            return griewank;
+
+        case SCHWEFEL:
+            return schwefel;
+
+        case LEVY:
+            return levy;
+
+        default:
+            return sphere;
+    }
+}
+
+/**
+    Draws the shift and the rotation from their seeds for the current type
+    and dimension. Without shift and rotation the vectors are empty and the
+    points are passed unchanged to the kernel.
+*/
+void BenchmarkFunction::updateTransformation()
+{
+    shift.clear();
+    rotation.clear();
+
+    if( !shifted && !rotated )
+    {
+        return;
+    }
+
+    PhiloxRandom random( shifted ? shift_seed : 0 );
+    double min, max;
+    getDomain( type, min, max );
+
+    shift.assign( dimension, getMinimum( type ) );
+
+    if( shifted )
+    {
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            double r = random.getRandomNumber( 0, 0, PhiloxRandom::STREAM_BENCHMARK, i );
+            shift[i] = 0.5 * ( min + max ) + 0.8 * ( r - 0.5 ) * ( max - min );
+        }
+    }
+
+    if( rotated )
+    {
+        random.setSeed( rotation_seed );
+        rotation.resize( dimension * dimension );
+
+        //normal distributed rows by the Box-Muller transform
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            for( size_t j = 0; j < dimension; j++ )
+            {
+                double u1 = 1. - random.getRandomNumber( i, 1, PhiloxRandom::STREAM_BENCHMARK, 2 * j );
+                double u2 = random.getRandomNumber( i, 1, PhiloxRandom::STREAM_BENCHMARK, 2 * j + 1 );
+                rotation[i * dimension + j] = sqrt( -2. * log( u1 ) ) * cos( 2. * pi * u2 );
+            }
+        }
+
+        //modified Gram-Schmidt orthonormalization of the rows
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            double *row = &rotation[i * dimension];
+
+            for( size_t k = 0; k < i; k++ )
+            {
+                const double *other = &rotation[k * dimension];
+                double dot = 0.;
+
+                for( size_t j = 0; j < dimension; j++ )
+                {
+                    dot += row[j] * other[j];
+                }
+
+                for( size_t j = 0; j < dimension; j++ )
+                {
+                    row[j] -= dot * other[j];
+                }
+            }
+
+            double norm = sqrt( sphere( row, dimension ) );
+
+            for( size_t j = 0; j < dimension; j++ )
+            {
+                row[j] /= norm;
+            }
+        }
+    }
+
+    difference.resize( dimension );
+    transformed.resize( dimension );
+}
+
+/**
+    Returns R * ( x - o ) + m for the shifted or rotated variants, otherwise x.
+    The result is stored in \ref transformed and valid until the next call.
+*/
+const double *BenchmarkFunction::transform( const double *x )
+{
+    if( shift.empty() )
+    {
+        return x;
+    }
+
+    for( size_t i = 0; i < dimension; i++ )
+    {
+        difference[i] = x[i] - shift[i];
+    }
+
+    if( rotation.empty() )
+    {
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            transformed[i] = difference[i] + getMinimum( type );
+        }
+
+        return &transformed[0];
+    }
+
+    double minimum = getMinimum( type );
+
+    for( size_t i = 0; i < dimension; i++ )
+    {
+        const double *row = &rotation[i * dimension];
+        double s0 = 0., s1 = 0.;
+        size_t j = 0;
+
+        for( ; j + 2 <= dimension; j += 2 )
+        {
+            s0 += row[j] * difference[j];
+            s1 += row[j + 1] * difference[j + 1];
+        }
+
+        for( ; j < dimension; j++ )
+        {
+            s0 += row[j] * difference[j];
+        }
+
+        transformed[i] = s0 + s1 + minimum;
+    }
+
+    return &transformed[0];
+}
@@ -0,0 +1,125 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCHMARKFUNCTION_H
+#define BENCHMARKFUNCTION_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "vectorn.h"
+#include "vectorview.h"
+
+/**
+    Natively compiled standard test functions for the optimization. In contrast
+    to the interpreted \ref Function no parser is involved, therefore it is used
+    to measure the throughput of the swarm itself and as fast reference
+    objective for regression runs. All functions are minimized, the global
+    minimum is zero.
+
+    The shifted and rotated variants evaluate f( R * ( x - o ) + m ), where m is
+    the minimum of the plain function and the shift o and the orthogonal matrix
+    R are drawn reproducibly from a seed, see \ref setShift and \ref setRotation.
+    The minimum is therefore moved to o, without shift o is equal to m.
+
+    The kernels work on a contiguous array of coordinates, the cheap polynomial
+    ones use four independent partial sums, so the compiler can vectorise the
+    loops without reassociating floating point operations. \ref evaluateBatch
+    selects the kernel once and evaluates a whole block of points, for example
+    all positions of a \ref ParticleStore.
+*/
+class BenchmarkFunction
+{
+    public:
+        enum Type {SPHERE, ROSENBROCK, RASTRIGIN, ACKLEY, GRIEWANK, SCHWEFEL, LEVY, NUMBER_OF_TYPES};
+
+        BenchmarkFunction( Type type_ = SPHERE, size_t dim = 2 );
+
+        void setType( Type type_ );
+        Type getType() const;
+
+        void setDimension( size_t dim );
+        size_t getDimension() const;
+
+        void setShift( uint64_t seed );
+        void setRotation( uint64_t seed );
+        void removeShift();
+        void removeRotation();
+        bool isShifted() const;
+        bool isRotated() const;
+
+        std::string getName() const;
+        void getMinimum( VectorN<double> &x ) const;
+
+        double operator()( VectorN<double> &x );
+        double operator()( const VectorView<double> &x );
+
+        void evaluateBatch( const double *positions, size_t count, size_t stride, double *out );
+
+        static std::string getName( Type type_ );
+        static bool getType( const std::string &name, Type &type_ );
+        static void getDomain( Type type_, double &min, double &max );
+        static double getMinimum( Type type_ );
+
+        static double sphere( const double *x, size_t n );
+        static double rosenbrock( const double *x, size_t n );
+        static double rastrigin( const double *x, size_t n );
+        static double ackley( const double *x, size_t n );
+        static double griewank( const double *x, size_t n );
+        static double schwefel( const double *x, size_t n );
+        static double levy( const double *x, size_t n );
+
+    protected:
+        typedef double ( *Kernel )( const double *x, size_t n );
+
+        static Kernel getKernel( Type type_ );
+
+        void updateTransformation();
+        const double *transform( const double *x );
+
+        Type                 type;
+        size_t               dimension;
+        bool                 shifted;
+        bool                 rotated;
+        uint64_t             shift_seed;
+        uint64_t             rotation_seed;
+        std::vector<double>  shift;         //o, empty if neither shifted nor rotated
+        std::vector<double>  rotation;      //row major dimension * dimension matrix R, empty if not rotated
+        std::vector<double>  difference;    //x - o of the current point
+        std::vector<double>  transformed;   //R * ( x - o ) + m of the current point
+};
+
+/**
+    Overload of the generic batch evaluation of \ref Swarm which evaluates
+    the whole block with \ref BenchmarkFunction::evaluateBatch.
+*/
+inline void evaluateBatch( BenchmarkFunction &func, const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    if( dim < func.getDimension() )
+    {
+        throw RuntimeError( "Error evaluating function: to few variables given in x!" );
+    }
+
+    func.evaluateBatch( positions, count, stride, out );
+}
+
+#endif // BENCHMARKFUNCTION_H
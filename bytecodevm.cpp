@@ -0,0 +1,621 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "bytecodevm.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "exception.h"
+#include "psokernel.h"
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define BYTECODEVM_X86
+#endif
+
+#define VM_INLINE inline __attribute__( ( always_inline ) )
+
+namespace
+{
+    const double magic = 6755399441055744.0;    //1.5 * 2^52, adding it rounds to an integer which is stored in the low bits
+
+    const double ln2_hi = 6.93147180369123816490e-01;
+    const double ln2_lo = 1.90821492927058770002e-10;
+    const double log2e = 1.44269504088896338700e+00;
+    const double exp_min = -708.;               //2^k stays a normal number
+    const double exp_max = 709.;
+
+    const double sqrt2 = 1.41421356237309514547e+00;
+    const double ln2_inverse = 1.44269504088896338700e+00;
+    const double ln10_inverse = 4.34294481903251816668e-01;
+    const int64_t mantissa_mask = 0x000FFFFFFFFFFFFFLL;
+    const int64_t exponent_one = 0x3FF0000000000000LL;
+
+    //coefficients of log( 1 + f ) from fdlibm
+    const double lg1 = 6.666666666666735130e-01, lg2 = 3.999999999940941908e-01, lg3 = 2.857142874366239149e-01, lg4 = 2.222219843214978396e-01;
+    const double lg5 = 1.818357216161805012e-01, lg6 = 1.531383769920937332e-01, lg7 = 1.479819860511658591e-01;
+
+    //pi / 2 split into three parts of 33 bits, k * pio2_i is exact for |k| < 2^20
+    const double two_over_pi = 6.36619772367581382433e-01;
+    const double pio2_1 = 1.57079632673412561417e+00, pio2_2 = 6.07710050630396597660e-11, pio2_3 = 2.02226624871116645580e-21;
+    const double trig_max = 1e5;
+
+    //sin and cos on [-pi/4, pi/4] from fdlibm
+    const double s1 = -1.66666666666666324348e-01, s2 = 8.33333333332248946124e-03, s3 = -1.98412698298579493134e-04;
+    const double s4 = 2.75573137070700676789e-06, s5 = -2.50507602534068634195e-08, s6 = 1.58969099521155010221e-10;
+    const double c1 = 4.16666666666666019037e-02, c2 = -1.38888888888741095749e-03, c3 = 2.48015872894767294178e-05;
+    const double c4 = -2.75573143513906633035e-07, c5 = 2.08757232129817482790e-09, c6 = -1.13596475577881948265e-11;
+
+    VM_INLINE int64_t toBits( double d )
+    {
+        int64_t i;
+        memcpy( &i, &d, sizeof( i ) );
+        return i;
+    }
+
+    VM_INLINE double fromBits( int64_t i )
+    {
+        double d;
+        memcpy( &d, &i, sizeof( d ) );
+        return d;
+    }
+
+    /**
+        exp( x ) = 2^k * exp( r ) with |r| <= ln( 2 ) / 2, exp( r ) is the
+        Taylor polynomial of degree 13.
+    */
+    template<size_t N>
+    VM_INLINE void expLanes( const double *__restrict__ a, double *__restrict__ out )
+    {
+        int special = 0;
+
+        for( size_t l = 0; l < N; l++ )
+        {
+            double x = a[l];
+            int inside = ( x >= exp_min ) & ( x <= exp_max );
+            special |= !inside;
+            x = inside ? x : 0.;
+
+            double t = x * log2e + magic;
+            double k = t - magic;
+            double r = ( x - k * ln2_hi ) - k * ln2_lo;
+            double p = 1. / 479001600. + r * ( 1. / 6227020800. );
+            p = 1. / 39916800. + r * p;
+            p = 1. / 3628800. + r * p;
+            p = 1. / 362880. + r * p;
+            p = 1. / 40320. + r * p;
+            p = 1. / 5040. + r * p;
+            p = 1. / 720. + r * p;
+            p = 1. / 120. + r * p;
+            p = 1. / 24. + r * p;
+            p = 1. / 6. + r * p;
+            p = 0.5 + r * p;
+            p = 1. + r * p;
+            p = 1. + r * p;
+
+            out[l] = p * fromBits( ( toBits( t ) - toBits( magic ) + 1023 ) << 52 );
+        }
+
+        if( special )
+        {
+            for( size_t l = 0; l < N; l++ )
+            {
+                if( !( a[l] >= exp_min && a[l] <= exp_max ) ) {out[l] = exp( a[l] );}
+            }
+        }
+    }
+
+    /**
+        ln( x ) = k * ln( 2 ) + ln( m ) with sqrt( 2 ) / 2 <= m < sqrt( 2 ), the
+        evaluation of ln( m ) is the one of fdlibm.
+    */
+    template<size_t N>
+    VM_INLINE void logLanes( const double *__restrict__ a, double *__restrict__ out )
+    {
+        int special = 0;
+
+        for( size_t l = 0; l < N; l++ )
+        {
+            double x = a[l];
+            int inside = ( x >= DBL_MIN ) & ( x <= DBL_MAX );
+            special |= !inside;
+            x = inside ? x : 1.;
+
+            int64_t bits = toBits( x );
+            int64_t e = ( bits >> 52 ) - 1023;
+            double m = fromBits( ( bits & mantissa_mask ) | exponent_one );
+            int big = m > sqrt2;
+            m = big ? 0.5 * m : m;
+            e = big ? e + 1 : e;
+
+            double f = m - 1.;
+            double s = f / ( 2. + f );
+            double z = s * s, w = z * z;
+            double r = z * ( lg1 + w * ( lg3 + w * ( lg5 + w * lg7 ) ) ) + w * ( lg2 + w * ( lg4 + w * lg6 ) );
+            double hfsq = 0.5 * f * f;
+            double k = fromBits( toBits( magic ) + e ) - magic;
+
+            out[l] = k * ln2_hi - ( ( hfsq - ( s * ( hfsq + r ) + k * ln2_lo ) ) - f );
+        }
+
+        if( special )
+        {
+            for( size_t l = 0; l < N; l++ )
+            {
+                if( !( a[l] >= DBL_MIN && a[l] <= DBL_MAX ) ) {out[l] = log( a[l] );}
+            }
+        }
+    }
+
+    /**
+        Reduces x to r = x - k * pi / 2 with |r| <= pi / 4 and selects the sine
+        or cosine polynomial of r by the quadrant k. cos( x ) is sin( x + pi / 2 ),
+        which is the next quadrant.
+    */
+    template<size_t N, bool Cosine>
+    VM_INLINE void sinCosLanes( const double *__restrict__ a, double *__restrict__ out )
+    {
+        int special = 0;
+
+        for( size_t l = 0; l < N; l++ )
+        {
+            double x = a[l];
+            int inside = ( x >= -trig_max ) & ( x <= trig_max );
+            special |= !inside;
+            x = inside ? x : 0.;
+
+            double t = x * two_over_pi + magic;
+            double k = t - magic;
+            int64_t quadrant = toBits( t ) - toBits( magic ) + ( Cosine ? 1 : 0 );
+            double r = ( ( x - k * pio2_1 ) - k * pio2_2 ) - k * pio2_3;
+
+            double z = r * r, w = z * z;
+            double sin_r = r + z * r * ( s1 + z * ( s2 + z * ( s3 + z * s4 ) + z * w * ( s5 + z * s6 ) ) );
+            double cos_poly = z * ( c1 + z * ( c2 + z * c3 ) ) + w * w * ( c4 + z * ( c5 + z * c6 ) );
+            double hz = 0.5 * z;
+            double one_hz = 1. - hz;
+            double cos_r = one_hz + ( ( ( 1. - one_hz ) - hz ) + z * cos_poly );
+
+            double v = ( quadrant & 1 ) ? cos_r : sin_r;
+            out[l] = ( quadrant & 2 ) ? -v : v;
+        }
+
+        if( special )
+        {
+            for( size_t l = 0; l < N; l++ )
+            {
+                if( !( a[l] >= -trig_max && a[l] <= trig_max ) ) {out[l] = Cosine ? cos( a[l] ) : sin( a[l] );}
+            }
+        }
+    }
+
+    /**
+        pow( x, y ) = exp( y * ln( x ) ) for positive normal x, all other
+        cases and results outside of the range of \ref expLanes are computed
+        by the C library.
+    */
+    template<size_t N>
+    VM_INLINE void powLanes( const double *__restrict__ a, const double *__restrict__ b, double *__restrict__ out )
+    {
+        double t[N];
+        int special = 0;
+
+        logLanes<N>( a, t );
+
+        for( size_t l = 0; l < N; l++ )
+        {
+            t[l] *= b[l];
+            special |= !( ( a[l] >= DBL_MIN ) & ( a[l] <= DBL_MAX ) & ( t[l] >= exp_min ) & ( t[l] <= exp_max ) );
+        }
+
+        expLanes<N>( t, out );
+
+        if( special )
+        {
+            for( size_t l = 0; l < N; l++ )
+            {
+                if( !( a[l] >= DBL_MIN && a[l] <= DBL_MAX && t[l] >= exp_min && t[l] <= exp_max ) ) {out[l] = pow( a[l], b[l] );}
+            }
+        }
+    }
+
+    /**
+        x^n by repeated squaring, negative exponents are inverted at the end.
+    */
+    template<size_t N>
+    VM_INLINE void powiLanes( const double *__restrict__ a, int exponent, double *__restrict__ out )
+    {
+        double base[N];
+        unsigned int n = exponent < 0 ? -exponent : exponent;
+
+        for( size_t l = 0; l < N; l++ )
+        {
+            base[l] = a[l];
+            out[l] = 1.;
+        }
+
+        while( n )
+        {
+            if( n & 1 )
+            {
+                for( size_t l = 0; l < N; l++ ) {out[l] *= base[l];}
+            }
+
+            n >>= 1;
+
+            if( n )
+            {
+                for( size_t l = 0; l < N; l++ ) {base[l] *= base[l];}
+            }
+        }
+
+        if( exponent < 0 )
+        {
+            for( size_t l = 0; l < N; l++ ) {out[l] = 1. / out[l];}
+        }
+    }
+
+    /**
+        Executes the instructions for the first N lanes of each register.
+    */
+    template<size_t N>
+    VM_INLINE void executeInstructions( const BytecodeVM::Instruction *code, size_t num_instructions, double *registers )
+    {
+        registers = static_cast<double *>( __builtin_assume_aligned( registers, 64 ) );
+
+        for( size_t i = 0; i < num_instructions; i++ )
+        {
+            const BytecodeVM::Instruction &instruction = code[i];
+            double *__restrict__ r = registers + instruction.dest * BytecodeVM::lanes;
+            const double *__restrict__ a = registers + instruction.args[0] * BytecodeVM::lanes;
+            const double *__restrict__ b = registers + instruction.args[1] * BytecodeVM::lanes;
+            const double *__restrict__ c = registers + instruction.args[2] * BytecodeVM::lanes;
+
+#define VM_LANES( expr ) for( size_t l = 0; l < N; l++ ) {r[l] = ( expr );} break
+
+            switch( instruction.opcode )
+            {
+                case Expression::OP_NEGATE:         VM_LANES( -a[l] );
+                case Expression::OP_ADD:            VM_LANES( a[l] + b[l] );
+                case Expression::OP_SUBTRACT:       VM_LANES( a[l] - b[l] );
+                case Expression::OP_MULTIPLY:       VM_LANES( a[l] * b[l] );
+                case Expression::OP_DIVIDE:         VM_LANES( a[l] / b[l] );
+                case Expression::OP_LESS:           VM_LANES( a[l] < b[l] ? 1. : 0. );
+                case Expression::OP_GREATER:        VM_LANES( a[l] > b[l] ? 1. : 0. );
+                case Expression::OP_LESS_EQUAL:     VM_LANES( a[l] <= b[l] ? 1. : 0. );
+                case Expression::OP_GREATER_EQUAL:  VM_LANES( a[l] >= b[l] ? 1. : 0. );
+                case Expression::OP_EQUAL:          VM_LANES( a[l] == b[l] ? 1. : 0. );
+                case Expression::OP_NOT_EQUAL:      VM_LANES( a[l] != b[l] ? 1. : 0. );
+                case Expression::OP_AND:            VM_LANES( a[l] != 0. && b[l] != 0. ? 1. : 0. );
+                case Expression::OP_OR:             VM_LANES( a[l] != 0. || b[l] != 0. ? 1. : 0. );
+                case Expression::OP_IF:             VM_LANES( a[l] != 0. ? b[l] : c[l] );
+                case Expression::OP_SQRT:           VM_LANES( sqrt( a[l] ) );
+                case Expression::OP_ABS:            VM_LANES( fabs( a[l] ) );
+                case Expression::OP_SIGN:           VM_LANES( a[l] > 0. ? 1. : ( a[l] < 0. ? -1. : 0. ) );
+                case Expression::OP_RINT:           VM_LANES( floor( a[l] + 0.5 ) );
+                case Expression::OP_MIN:            VM_LANES( b[l] < a[l] ? b[l] : a[l] );
+                case Expression::OP_MAX:            VM_LANES( a[l] < b[l] ? b[l] : a[l] );
+                case Expression::OP_LOG2:           logLanes<N>( a, r ); VM_LANES( r[l] * ln2_inverse );
+                case Expression::OP_LOG10:          logLanes<N>( a, r ); VM_LANES( r[l] * ln10_inverse );
+                case Expression::OP_TAN:            VM_LANES( tan( a[l] ) );
+                case Expression::OP_ASIN:           VM_LANES( asin( a[l] ) );
+                case Expression::OP_ACOS:           VM_LANES( acos( a[l] ) );
+                case Expression::OP_ATAN:           VM_LANES( atan( a[l] ) );
+                case Expression::OP_SINH:           VM_LANES( sinh( a[l] ) );
+                case Expression::OP_COSH:           VM_LANES( cosh( a[l] ) );
+                case Expression::OP_TANH:           VM_LANES( tanh( a[l] ) );
+                case Expression::OP_ASINH:          VM_LANES( asinh( a[l] ) );
+                case Expression::OP_ACOSH:          VM_LANES( acosh( a[l] ) );
+                case Expression::OP_ATANH:          VM_LANES( atanh( a[l] ) );
+                case Expression::OP_EXP:            expLanes<N>( a, r ); break;
+                case Expression::OP_LOG:            logLanes<N>( a, r ); break;
+                case Expression::OP_SIN:            sinCosLanes<N, false>( a, r ); break;
+                case Expression::OP_COS:            sinCosLanes<N, true>( a, r ); break;
+                case Expression::OP_POWER:          powLanes<N>( a, b, r ); break;
+                case BytecodeVM::op_powi:           powiLanes<N>( a, instruction.exponent, r ); break;
+            }
+
+#undef VM_LANES
+        }
+    }
+
+    void executeLanes( const BytecodeVM::Instruction *code, size_t num_instructions, double *registers )
+    {
+        executeInstructions<BytecodeVM::lanes>( code, num_instructions, registers );
+    }
+
+#ifdef BYTECODEVM_X86
+    //without FMA, the results are the same as the ones of executeLanes
+    __attribute__( ( target( "avx2" ) ) )
+    void executeLanesAVX2( const BytecodeVM::Instruction *code, size_t num_instructions, double *registers )
+    {
+        executeInstructions<BytecodeVM::lanes>( code, num_instructions, registers );
+    }
+#endif
+
+    void executeSingle( const BytecodeVM::Instruction *code, size_t num_instructions, double *registers )
+    {
+        executeInstructions<1>( code, num_instructions, registers );
+    }
+}
+
+const size_t BytecodeVM::lanes;
+
+/**
+    Lowers \a expr into bytecode. Throws a RuntimeError if the expression is empty.
+
+    \param[in] expr
+*/
+BytecodeVM::BytecodeVM( const Expression &expr ) : num_variables( expr.getNumberOfVariables() ), result_register( 0 ), num_registers( 0 ), storage_offset( 0 ),
+    execute_block( executeLanes ), execute_single( executeSingle )
+{
+    lower( expr );
+
+#ifdef BYTECODEVM_X86
+
+    if( PSOKernel::getInstructionSet() >= PSOKernel::AVX2 )
+    {
+        execute_block = executeLanesAVX2;
+    }
+
+#endif
+}
+
+/**
+    Copies the bytecode and the constants of \a other, the copy has its own
+    register file and can be used by another thread.
+
+    \param[in] other
+*/
+BytecodeVM::BytecodeVM( const BytecodeVM &other ) : code( other.code ), variables( other.variables ), num_variables( other.num_variables ),
+    result_register( other.result_register ), num_registers( other.num_registers ), storage_offset( 0 ), execute_block( other.execute_block ),
+    execute_single( other.execute_single )
+{
+    allocateRegisters();
+    memcpy( getRegister( 0 ), &other.storage[other.storage_offset], num_registers * lanes * sizeof( double ) );
+}
+
+/**
+    Evaluates the expression at the point x.
+
+    \param[in] x    \ref getNumberOfVariables values
+*/
+double BytecodeVM::evaluate( const double *x )
+{
+    for( size_t v = 0; v < variables.size(); v++ )
+    {
+        getRegister( variables[v].second )[0] = x[variables[v].first];
+    }
+
+    ( *execute_single )( code.empty() ? NULL : &code[0], code.size(), getRegister( 0 ) );
+    return getRegister( result_register )[0];
+}
+
+/**
+    Evaluates the expression at \a count points in blocks of \ref lanes
+    points. The coordinates of point i start at positions[i * stride], its
+    result is written to out[i].
+
+    \param[in]  positions
+    \param[in]  count
+    \param[in]  stride    distance between two points, at least the number of variables
+    \param[out] out
+*/
+void BytecodeVM::evaluateBatch( const double *positions, size_t count, size_t stride, double *out )
+{
+    const double *result = getRegister( result_register );
+
+    for( size_t offset = 0; offset < count; offset += lanes )
+    {
+        size_t n = std::min( lanes, count - offset );
+
+        gather( positions + offset * stride, n, stride );
+        ( *execute_block )( code.empty() ? NULL : &code[0], code.size(), getRegister( 0 ) );
+        memcpy( out + offset, result, n * sizeof( double ) );
+    }
+}
+
+size_t BytecodeVM::getNumberOfVariables() const
+{
+    return num_variables;
+}
+
+size_t BytecodeVM::getNumberOfInstructions() const
+{
+    return code.size();
+}
+
+size_t BytecodeVM::getNumberOfRegisters() const
+{
+    return num_registers;
+}
+
+const BytecodeVM::Instruction &BytecodeVM::getInstruction( size_t i ) const
+{
+    return code[i];
+}
+
+/**
+    Translates the nodes which contribute to the root into instructions. The
+    register of a node is released after the instruction of its last reader,
+    the destination is allocated before, so it never overlaps an argument.
+    pow with an integer constant exponent becomes op_powi.
+*/
+void BytecodeVM::lower( const Expression &expr )
+{
+    size_t num = expr.getNumberOfNodes();
+
+    if( num == 0 )
+    {
+        throw RuntimeError( "Unable to lower an empty expression" );
+    }
+
+    std::vector<bool> used( num, false );
+    std::vector<size_t> last_use( num, 0 );
+    std::vector<size_t> node_register( num, 0 );
+    std::vector<size_t> variable_register( num_variables, num );
+    std::vector<size_t> free_registers;
+    std::vector<std::pair<size_t, double> > constants;
+
+    used[expr.getRoot()] = true;
+
+    for( size_t i = num; i-- > 0; )
+    {
+        if( !used[i] ) {continue;}
+
+        for( size_t j = 0; j < Expression::getNumberOfArguments( expr.getNode( i ).opcode ); j++ )
+        {
+            used[expr.getNode( i ).args[j]] = true;
+        }
+    }
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        if( !used[i] ) {continue;}
+
+        for( size_t j = 0; j < Expression::getNumberOfArguments( expr.getNode( i ).opcode ); j++ )
+        {
+            last_use[expr.getNode( i ).args[j]] = i;
+        }
+    }
+
+    last_use[expr.getRoot()] = num;
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        if( !used[i] ) {continue;}
+
+        const Expression::Node &node = expr.getNode( i );
+
+        if( node.opcode == Expression::OP_CONSTANT )
+        {
+            node_register[i] = num_registers++;
+            constants.push_back( std::make_pair( node_register[i], node.value ) );
+            continue;
+        }
+
+        if( node.opcode == Expression::OP_VARIABLE )
+        {
+            if( variable_register[node.variable] == num )
+            {
+                variable_register[node.variable] = num_registers++;
+                variables.push_back( std::make_pair( node.variable, variable_register[node.variable] ) );
+            }
+
+            node_register[i] = variable_register[node.variable];
+            continue;
+        }
+
+        Instruction instruction;
+        instruction.opcode = node.opcode;
+        instruction.exponent = 0;
+        size_t num_args = Expression::getNumberOfArguments( node.opcode );
+
+        for( size_t j = 0; j < 3; j++ )
+        {
+            instruction.args[j] = j < num_args ? node_register[node.args[j]] : 0;
+        }
+
+        if( node.opcode == Expression::OP_POWER )
+        {
+            const Expression::Node &exponent = expr.getNode( node.args[1] );
+
+            if( exponent.opcode == Expression::OP_CONSTANT && exponent.value == floor( exponent.value ) && fabs( exponent.value ) <= 64. )
+            {
+                instruction.opcode = op_powi;
+                instruction.exponent = static_cast<int32_t>( exponent.value );
+            }
+        }
+
+        if( free_registers.empty() )
+        {
+            instruction.dest = num_registers++;
+        }
+        else
+        {
+            instruction.dest = free_registers.back();
+            free_registers.pop_back();
+        }
+
+        node_register[i] = instruction.dest;
+        code.push_back( instruction );
+
+        for( size_t j = 0; j < num_args; j++ )
+        {
+            const Expression::Node &arg = expr.getNode( node.args[j] );
+            bool repeated = ( j > 0 && node.args[j] == node.args[0] ) || ( j > 1 && node.args[j] == node.args[1] );
+
+            if( arg.opcode != Expression::OP_CONSTANT && arg.opcode != Expression::OP_VARIABLE && last_use[node.args[j]] == i && !repeated )
+            {
+                free_registers.push_back( node_register[node.args[j]] );
+            }
+        }
+    }
+
+    result_register = node_register[expr.getRoot()];
+
+    allocateRegisters();
+
+    for( size_t i = 0; i < constants.size(); i++ )
+    {
+        std::fill( getRegister( constants[i].first ), getRegister( constants[i].first ) + lanes, constants[i].second );
+    }
+}
+
+/**
+    Allocates the register file with one more register than needed to align
+    the first one to 64 bytes. All registers are zero.
+*/
+void BytecodeVM::allocateRegisters()
+{
+    storage.assign( ( num_registers + 1 ) * lanes, 0. );
+    size_t misalignment = reinterpret_cast<uintptr_t>( &storage[0] ) % 64;
+    storage_offset = misalignment ? ( 64 - misalignment ) / sizeof( double ) : 0;
+}
+
+/**
+    Copies the used variables of \a count points into their registers, the
+    remaining lanes get the last point so they do not hit special cases.
+*/
+void BytecodeVM::gather( const double *positions, size_t count, size_t stride )
+{
+    for( size_t v = 0; v < variables.size(); v++ )
+    {
+        double *reg = getRegister( variables[v].second );
+        const double *x = positions + variables[v].first;
+
+        if( count == lanes )
+        {
+            for( size_t l = 0; l < lanes; l++ )
+            {
+                reg[l] = x[l * stride];
+            }
+        }
+        else
+        {
+            for( size_t l = 0; l < lanes; l++ )
+            {
+                reg[l] = x[std::min( l, count - 1 ) * stride];
+            }
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BYTECODEVM_H
+#define BYTECODEVM_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "expression.h"
+
+/**
+    Evaluation backend of \ref Function which does not need a compiler. The
+    \ref Expression is lowered into a register bytecode, each register holds
+    the values of \ref lanes points and each instruction processes all of
+    them in one tight loop, which the compiler vectorises. The interpretation
+    overhead of an instruction is therefore shared by \ref lanes points.
+
+    The registers are allocated like in a compiler: a register is reused as
+    soon as its last reader has been executed, so the register file of a
+    large expression still fits into the first level cache. Constants and
+    variables get their own registers, the variables of a block of points
+    are gathered from the positions before the instructions are executed.
+
+    sqrt, abs and the arithmetic are exact. exp, ln, log2, log10, sin and cos
+    use vectorised polynomial approximations accurate to a few ulp, their
+    special cases like NaN, overflow or huge arguments are handed to the C
+    library. pow with an integer constant exponent is lowered into
+    multiplications, otherwise it is computed as exp( y * ln( x ) ), whose
+    relative error grows with |y * ln( x )| * 2^-53. Therefore the results
+    can differ from muParser in the last digits. The remaining functions call
+    the C library for each lane.
+
+    The instruction loops are compiled a second time for AVX2, which is used
+    if \ref PSOKernel selects AVX2 or AVX-512. Both produce identical results.
+*/
+class BytecodeVM
+{
+    public:
+        static const size_t lanes = 16;                              //points per block
+        static const int op_powi = Expression::NUMBER_OF_OPCODES;   //integer power, see Instruction::exponent
+
+        struct Instruction
+        {
+            int32_t     opcode;         //Expression::Opcode or op_powi
+            int32_t     exponent;       //op_powi
+            uint32_t    dest;
+            uint32_t    args[3];
+        };
+
+        BytecodeVM( const Expression &expr );
+        BytecodeVM( const BytecodeVM &other );
+
+        double evaluate( const double *x );
+        void evaluateBatch( const double *positions, size_t count, size_t stride, double *out );
+
+        size_t getNumberOfVariables() const;
+        size_t getNumberOfInstructions() const;
+        size_t getNumberOfRegisters() const;
+        const Instruction &getInstruction( size_t i ) const;
+
+    private:
+        typedef void ( *ExecuteFunction )( const Instruction *code, size_t num_instructions, double *registers );
+
+        BytecodeVM &operator=( const BytecodeVM &other ) {return *this;}
+
+        void lower( const Expression &expr );
+        void allocateRegisters();
+        void gather( const double *positions, size_t count, size_t stride );
+
+        double *getRegister( size_t r );
+
+        std::vector<Instruction>    code;
+        std::vector<std::pair<size_t, size_t> > variables;  //index of a used variable and its register
+        size_t                      num_variables;
+        size_t                      result_register;
+        size_t                      num_registers;
+        std::vector<double>         storage;                //register file, num_registers * lanes
+        size_t                      storage_offset;         //aligns the register file to a cache line
+        ExecuteFunction             execute_block;
+        ExecuteFunction             execute_single;
+};
+
+inline double *BytecodeVM::getRegister( size_t r )
+{
+    return &storage[storage_offset + r * lanes];
+}
+
+#endif // BYTECODEVM_H
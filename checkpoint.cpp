@@ -0,0 +1,474 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "exception.h"
+
+namespace
+{
+    const char magic_number[8] = {'P', 'S', 'O', 'C', 'K', 'P', 'T', '\0'};
+    const uint32_t byte_order_mark = 0x01020304;
+    const size_t block_alignment = 64;
+}
+
+CheckpointImage::CheckpointImage() : mapping( NULL ), data( NULL ), size( 0 )
+{
+}
+
+CheckpointImage::~CheckpointImage()
+{
+    unmap();
+}
+
+/**
+    Creates an image for \a state_ in memory. The particle arrays have to be
+    filled by the caller afterwards. The memory is reused if the size does not
+    change.
+
+    \param[in] state_
+*/
+void CheckpointImage::create( const SwarmState &state_ )
+{
+    unmap();
+
+    size = getFileSize( state_ );
+    buffer.resize( ( size + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t ) );
+    data = reinterpret_cast<char *>( &buffer[0] );
+
+    Header *header = reinterpret_cast<Header *>( data );
+    memset( header, 0, getHeaderSize() );
+    memcpy( header->magic, magic_number, sizeof( magic_number ) );
+    header->version = version;
+    header->byte_order = byte_order_mark;
+    header->header_size = getHeaderSize();
+    header->file_size = size;
+    header->state = state_;
+}
+
+/**
+    Maps the checkpoint \a filename read only into memory and checks the
+    header and the checksum. Throws a RuntimeError if the file is not a
+    valid checkpoint.
+
+    \param[in] filename
+*/
+void CheckpointImage::load( const std::string &filename )
+{
+    unmap();
+    buffer.clear();
+
+    int fd = open( filename.c_str(), O_RDONLY );
+
+    if( fd == -1 ) {throw RuntimeError( "Unable to open checkpoint " + filename );}
+
+    struct stat st;
+
+    if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < getHeaderSize() )
+    {
+        close( fd );
+        throw RuntimeError( "Checkpoint " + filename + " is truncated" );
+    }
+
+    mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if( mapping == MAP_FAILED )
+    {
+        mapping = NULL;
+        throw RuntimeError( "Unable to map checkpoint " + filename );
+    }
+
+    data = static_cast<char *>( mapping );
+    size = st.st_size;
+
+    const Header *header = reinterpret_cast<const Header *>( data );
+    std::string error;
+
+    //bounds the arrays by the file before their size is computed, a crafted header must not overflow getFileSize
+    uint64_t max_doubles = size / sizeof( double );
+
+    if( memcmp( header->magic, magic_number, sizeof( magic_number ) ) != 0 )
+    {
+        error = "is not a checkpoint";
+    }
+    else if( header->byte_order != byte_order_mark )
+    {
+        error = "was written on a machine with a different byte order";
+    }
+    else if( header->version > version || header->header_size != getHeaderSize() )
+    {
+        error = "has an unsupported version";
+    }
+    else if( header->state.count > max_doubles || header->state.dimension > max_doubles ||
+             ( header->state.dimension != 0 && header->state.count > max_doubles / header->state.dimension ) )
+    {
+        error = "has an invalid number of particles or dimension";
+    }
+    else if( header->file_size != size || getFileSize( header->state ) != size )
+    {
+        error = "is truncated";
+    }
+    else if( header->checksum != checksum( data + getHeaderSize(), size - getHeaderSize() ) )
+    {
+        error = "is corrupted";
+    }
+
+    if( !error.empty() )
+    {
+        unmap();
+        throw RuntimeError( "Checkpoint " + filename + " " + error );
+    }
+}
+
+/**
+    Computes the checksum and writes the image to \a filename. The data is
+    written to a temporary file which replaces \a filename after it was
+    synchronized to the disk.
+
+    \param[in] filename
+*/
+void CheckpointImage::save( const std::string &filename )
+{
+    if( !data ) {throw RuntimeError( "Empty checkpoint" );}
+
+    if( !mapping )
+    {
+        Header *header = reinterpret_cast<Header *>( data );
+        header->checksum = checksum( data + getHeaderSize(), size - getHeaderSize() );
+    }
+
+    std::string temporary = filename + ".tmp";
+    int fd = open( temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+
+    if( fd == -1 ) {throw RuntimeError( "Unable to create checkpoint " + temporary );}
+
+    size_t offset = 0;
+
+    while( offset < size )
+    {
+        ssize_t n = write( fd, data + offset, size - offset );
+
+        if( n < 0 && errno == EINTR ) {continue;}
+
+        if( n <= 0 )
+        {
+            close( fd );
+            unlink( temporary.c_str() );
+            throw RuntimeError( "Unable to write checkpoint " + temporary );
+        }
+
+        offset += n;
+    }
+
+    if( fsync( fd ) != 0 || close( fd ) != 0 )
+    {
+        unlink( temporary.c_str() );
+        throw RuntimeError( "Unable to write checkpoint " + temporary );
+    }
+
+    if( rename( temporary.c_str(), filename.c_str() ) != 0 )
+    {
+        unlink( temporary.c_str() );
+        throw RuntimeError( "Unable to rename checkpoint " + temporary );
+    }
+}
+
+const SwarmState &CheckpointImage::getState() const
+{
+    return reinterpret_cast<const Header *>( data )->state;
+}
+
+double *CheckpointImage::getPositions() const
+{
+    return reinterpret_cast<double *>( getArray( 0 ) );
+}
+
+double *CheckpointImage::getVelocities() const
+{
+    return reinterpret_cast<double *>( getArray( 1 ) );
+}
+
+double *CheckpointImage::getBestPositions() const
+{
+    return reinterpret_cast<double *>( getArray( 2 ) );
+}
+
+double *CheckpointImage::getCurrentValues() const
+{
+    return reinterpret_cast<double *>( getArray( 3 ) );
+}
+
+double *CheckpointImage::getBestValues() const
+{
+    return reinterpret_cast<double *>( getArray( 4 ) );
+}
+
+int64_t *CheckpointImage::getBestNeighbours() const
+{
+    return reinterpret_cast<int64_t *>( getArray( 5 ) );
+}
+
+uint32_t *CheckpointImage::getUpdateCounts() const
+{
+    return reinterpret_cast<uint32_t *>( getArray( 6 ) );
+}
+
+size_t CheckpointImage::getSize() const
+{
+    return size;
+}
+
+size_t CheckpointImage::roundUp( size_t size )
+{
+    return ( size + block_alignment - 1 ) / block_alignment * block_alignment;
+}
+
+size_t CheckpointImage::getHeaderSize()
+{
+    return roundUp( sizeof( Header ) );
+}
+
+size_t CheckpointImage::getFileSize( const SwarmState &state )
+{
+    size_t vectors = roundUp( state.count * state.dimension * sizeof( double ) );
+    size_t values = roundUp( state.count * sizeof( double ) );
+
+    return getHeaderSize() + 3 * vectors + 2 * values + roundUp( state.count * sizeof( int64_t ) ) + roundUp( state.count * sizeof( uint32_t ) );
+}
+
+uint64_t CheckpointImage::checksum( const char *data, size_t size )
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for( size_t i = 0; i < size; i++ )
+    {
+        hash ^= static_cast<unsigned char>( data[i] );
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+void CheckpointImage::unmap()
+{
+    if( mapping )
+    {
+        munmap( mapping, size );
+        mapping = NULL;
+        data = NULL;
+        size = 0;
+    }
+}
+
+/**
+    Returns the start of the array \a index in the order of the file layout.
+*/
+char *CheckpointImage::getArray( size_t index ) const
+{
+    const SwarmState &state = getState();
+    size_t vectors = roundUp( state.count * state.dimension * sizeof( double ) );
+    size_t values = roundUp( state.count * sizeof( double ) );
+    size_t offset = getHeaderSize();
+
+    for( size_t i = 0; i < index; i++ )
+    {
+        offset += i < 3 ? vectors : ( i < 5 ? values : roundUp( state.count * sizeof( int64_t ) ) );
+    }
+
+    return data + offset;
+}
+
+CheckpointWriter::CheckpointWriter( const std::string &filename_ ) : filename( filename_ ), filling( -1 ), writing( -1 ), pending( -1 ), written( 0 ), stop( false ), error_occurred( false )
+{
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &snapshot_available, NULL );
+    pthread_cond_init( &snapshot_written, NULL );
+
+    if( pthread_create( &thread, NULL, writerEntry, this ) != 0 )
+    {
+        throw RuntimeError( "Unable to create checkpoint thread" );
+    }
+}
+
+/**
+    Writes the pending snapshot and stops the background thread.
+*/
+CheckpointWriter::~CheckpointWriter()
+{
+    pthread_mutex_lock( &mutex );
+    stop = true;
+    pthread_cond_broadcast( &snapshot_available );
+    pthread_mutex_unlock( &mutex );
+
+    pthread_join( thread, NULL );
+
+    pthread_cond_destroy( &snapshot_written );
+    pthread_cond_destroy( &snapshot_available );
+    pthread_mutex_destroy( &mutex );
+}
+
+/**
+    Returns the image which is not written at the moment. A pending snapshot
+    which was not written yet is discarded. Throws a RuntimeError if writing a
+    previous snapshot has failed.
+*/
+CheckpointImage &CheckpointWriter::beginSnapshot()
+{
+    pthread_mutex_lock( &mutex );
+
+    if( error_occurred )
+    {
+        pthread_mutex_unlock( &mutex );
+        throwError();
+    }
+
+    filling = writing == 0 ? 1 : 0;
+
+    if( pending == filling )
+    {
+        pending = -1;
+    }
+
+    pthread_mutex_unlock( &mutex );
+
+    return images[filling];
+}
+
+/**
+    Hands the image returned by \ref beginSnapshot over to the background thread.
+*/
+void CheckpointWriter::commitSnapshot()
+{
+    pthread_mutex_lock( &mutex );
+    pending = filling;
+    filling = -1;
+    pthread_cond_signal( &snapshot_available );
+    pthread_mutex_unlock( &mutex );
+}
+
+/**
+    Waits until the committed snapshots are written. Throws a RuntimeError if
+    writing a snapshot has failed.
+*/
+void CheckpointWriter::flush()
+{
+    pthread_mutex_lock( &mutex );
+
+    while( pending != -1 || writing != -1 )
+    {
+        pthread_cond_wait( &snapshot_written, &mutex );
+    }
+
+    bool error = error_occurred;
+    pthread_mutex_unlock( &mutex );
+
+    if( error ) {throwError();}
+}
+
+const std::string &CheckpointWriter::getFilename() const
+{
+    return filename;
+}
+
+size_t CheckpointWriter::getNumberOfWritten()
+{
+    pthread_mutex_lock( &mutex );
+    size_t num = written;
+    pthread_mutex_unlock( &mutex );
+    return num;
+}
+
+void *CheckpointWriter::writerEntry( void *arg )
+{
+    static_cast<CheckpointWriter *>( arg )->writerLoop();
+    return NULL;
+}
+
+void CheckpointWriter::writerLoop()
+{
+    pthread_mutex_lock( &mutex );
+
+    for( ;; )
+    {
+        while( pending == -1 && !stop )
+        {
+            pthread_cond_wait( &snapshot_available, &mutex );
+        }
+
+        if( pending == -1 )
+        {
+            break;
+        }
+
+        writing = pending;
+        pending = -1;
+        pthread_mutex_unlock( &mutex );
+
+        std::string message;
+
+        try
+        {
+            images[writing].save( filename );
+        }
+        catch( Exception &err )
+        {
+            message = err.getMessage();
+        }
+        catch( std::exception &err )
+        {
+            message = err.what();
+        }
+
+        pthread_mutex_lock( &mutex );
+
+        if( message.empty() )
+        {
+            written++;
+        }
+        else if( !error_occurred )
+        {
+            error_occurred = true;
+            error_message = message;
+        }
+
+        writing = -1;
+        pthread_cond_broadcast( &snapshot_written );
+    }
+
+    pthread_mutex_unlock( &mutex );
+}
+
+void CheckpointWriter::throwError()
+{
+    pthread_mutex_lock( &mutex );
+    std::string message = error_message;
+    error_occurred = false;
+    pthread_mutex_unlock( &mutex );
+
+    throw RuntimeError( message );
+}
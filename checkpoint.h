@@ -0,0 +1,178 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+
+/**
+    Scalar state of a \ref Swarm which is stored in a checkpoint. Only fixed
+    size types are used, so the layout does not depend on the compiler.
+*/
+struct SwarmState
+{
+    uint64_t    dimension;
+    uint64_t    count;                      //number of particles
+    uint64_t    iteration_steps;
+    uint64_t    global_best_iterations;
+    uint64_t    abort_criterion_iterations;
+    uint64_t    topology_neighbours;
+    uint64_t    improvements;
+    uint64_t    random_seed;
+    uint32_t    random_run;
+    uint32_t    computation_methode;
+    uint32_t    execution_mode;
+    uint32_t    flags;                      //see the flag_* constants of CheckpointImage
+    double      global_best_previous;
+    double      limit_velocity_max;
+    double      limit_velocity_min;
+    double      parameter_c1;
+    double      parameter_c2;
+    double      parameter_c3;
+    double      parameter_w;
+    double      parameter_neighbour_radius;
+    double      topology_rewiring;
+};
+
+/**
+    Binary image of a checkpoint, either created in memory by \ref create or
+    mapped read only from a file by \ref load. The file consists of a header
+    with a magic number, the version, the byte order, the size, a checksum and
+    the \ref SwarmState, followed by the particle arrays. Each array starts on
+    a multiple of 64 bytes, the vectors are stored without padding:
+
+    - positions, velocities and best positions: count * dimension doubles each
+    - current values and best values: count doubles each
+    - best neighbours: count int64
+    - asynchronous update counts: count uint32
+
+    Files of a newer version or of a different byte order are rejected.
+*/
+class CheckpointImage
+{
+    public:
+        static const uint32_t version = 1;
+
+        static const uint32_t flag_auto_velocity = 1;
+        static const uint32_t flag_check_abort_criterion = 2;
+        static const uint32_t flag_compare_less = 4;
+
+        CheckpointImage();
+        virtual ~CheckpointImage();
+
+        void create( const SwarmState &state_ );
+        void load( const std::string &filename );
+        void save( const std::string &filename );
+
+        const SwarmState &getState() const;
+
+        double *getPositions() const;
+        double *getVelocities() const;
+        double *getBestPositions() const;
+        double *getCurrentValues() const;
+        double *getBestValues() const;
+        int64_t *getBestNeighbours() const;
+        uint32_t *getUpdateCounts() const;
+
+        size_t getSize() const;
+
+    private:
+        CheckpointImage( const CheckpointImage &other ) {}
+        CheckpointImage &operator=( const CheckpointImage &other ) {return *this;}
+
+        struct Header
+        {
+            char        magic[8];
+            uint32_t    version;
+            uint32_t    byte_order;
+            uint64_t    header_size;
+            uint64_t    file_size;
+            uint64_t    checksum;           //FNV-1a of everything behind the header
+            SwarmState  state;
+        };
+
+        static size_t roundUp( size_t size );
+        static size_t getHeaderSize();
+        static size_t getFileSize( const SwarmState &state );
+        static uint64_t checksum( const char *data, size_t size );
+
+        void unmap();
+        char *getArray( size_t index ) const;
+
+        std::vector<uint64_t>   buffer;     //memory of an image created by create
+        void                    *mapping;   //memory of an image loaded by load
+        char                    *data;
+        size_t                  size;
+};
+
+/**
+    Writes checkpoints in a background thread. The optimization thread fills
+    the image returned by \ref beginSnapshot and hands it over with
+    \ref commitSnapshot, which never waits for the disk. There are two images:
+    one is written by the background thread while the other one is filled. If
+    a snapshot is committed before the previous one was written, the previous
+    one is replaced, so only the latest snapshot is written.
+
+    The file is written under a temporary name and renamed afterwards, so the
+    checkpoint on disk is always complete.
+*/
+class CheckpointWriter
+{
+    public:
+        CheckpointWriter( const std::string &filename_ );
+        virtual ~CheckpointWriter();
+
+        CheckpointImage &beginSnapshot();
+        void commitSnapshot();
+        void flush();
+
+        const std::string &getFilename() const;
+        size_t getNumberOfWritten();
+
+    private:
+        CheckpointWriter( const CheckpointWriter &other ) {}
+        CheckpointWriter &operator=( const CheckpointWriter &other ) {return *this;}
+
+        static void *writerEntry( void *arg );
+        void writerLoop();
+        void throwError();
+
+        std::string         filename;
+        CheckpointImage     images[2];
+        int                 filling;        //image filled by the optimization thread or -1
+        int                 writing;        //image written by the background thread or -1
+        int                 pending;        //image which waits for the background thread or -1
+        size_t              written;
+        bool                stop;
+        bool                error_occurred;
+        std::string         error_message;
+
+        pthread_t           thread;
+        pthread_mutex_t     mutex;
+        pthread_cond_t      snapshot_available;
+        pthread_cond_t      snapshot_written;
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,551 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "evaluatorpool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+/**
+    \param[in] command_         shell command of a worker
+    \param[in] dim              dimension of the points
+    \param[in] num_workers      number of worker processes
+    \param[in] max_in_flight    maximum number of requests sent to a worker before it has answered
+    \param[in] batch_size       maximum number of points per request
+    \param[in] timeout_         seconds a worker may take for one request
+    \param[in] max_retries      number of times a request is sent again after its worker failed
+*/
+EvaluatorPool::EvaluatorPool( const std::string &command_, size_t dim, size_t num_workers, size_t max_in_flight_, size_t batch_size_, double timeout_,
+                              size_t max_retries_ ) :
+    command( command_ ), dimension( dim ), max_in_flight( max_in_flight_ ), batch_size( batch_size_ ), timeout( timeout_ ), max_retries( max_retries_ ), next_id( 0 ),
+    num_requests( 0 ), num_restarts( 0 ), num_timeouts( 0 )
+{
+    if( dim == 0 || num_workers == 0 || max_in_flight == 0 || batch_size == 0 )
+    {
+        throw RuntimeError( "Error creating evaluator pool: the dimension, number of workers, requests in flight and batch size must not be zero!" );
+    }
+
+    if( !( timeout > 0. ) )
+    {
+        throw RuntimeError( "Error creating evaluator pool: invalid timeout!" );
+    }
+
+    workers.resize( num_workers );
+
+    for( size_t i = 0; i < workers.size(); i++ )
+    {
+        workers[i].process = NULL;
+    }
+
+    try
+    {
+        for( size_t i = 0; i < workers.size(); i++ )
+        {
+            start( workers[i] );
+        }
+    }
+    catch( ... )
+    {
+        for( size_t i = 0; i < workers.size(); i++ )
+        {
+            stop( workers[i], SIGKILL );
+        }
+
+        throw;
+    }
+
+    pthread_mutex_init( &mutex, NULL );
+}
+
+EvaluatorPool::~EvaluatorPool()
+{
+    for( size_t i = 0; i < workers.size(); i++ )
+    {
+        stop( workers[i], SIGTERM );
+    }
+
+    pthread_mutex_destroy( &mutex );
+}
+
+/**
+    Writes the fitness of the \a count points at \a positions, \a stride
+    doubles apart, to \a out.
+
+    \param[in]  positions
+    \param[in]  count
+    \param[in]  stride
+    \param[in]  dim         must match \ref getDimension
+    \param[out] out         \a count values
+*/
+void EvaluatorPool::evaluate( const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    if( dim != dimension )
+    {
+        throw RuntimeError( "Error evaluating function: the dimension does not match the evaluator pool!" );
+    }
+
+    if( count == 0 ) {return;}
+
+    pthread_mutex_lock( &mutex );
+
+    try
+    {
+        for( size_t first = 0; first < count; first += batch_size )
+        {
+            Request request;
+            request.id = 0;
+            request.first = first;
+            request.count = std::min( batch_size, count - first );
+            request.attempts = 0;
+            queue.push_back( request );
+        }
+
+        run( positions, stride, out );
+    }
+    catch( ... )
+    {
+        //the answers of the remaining requests would arrive in a later call, so their workers start afresh
+        queue.clear();
+
+        for( size_t i = 0; i < workers.size(); i++ )
+        {
+            if( !workers[i].pending.empty() || !workers[i].process )
+            {
+                try
+                {
+                    start( workers[i] );
+                }
+                catch( ... )
+                {
+                }
+            }
+        }
+
+        pthread_mutex_unlock( &mutex );
+        throw;
+    }
+
+    pthread_mutex_unlock( &mutex );
+}
+
+const std::string &EvaluatorPool::getCommand() const
+{
+    return command;
+}
+
+size_t EvaluatorPool::getDimension() const
+{
+    return dimension;
+}
+
+size_t EvaluatorPool::getNumberOfWorkers() const
+{
+    return workers.size();
+}
+
+size_t EvaluatorPool::getMaxInFlight() const
+{
+    return max_in_flight;
+}
+
+size_t EvaluatorPool::getBatchSize() const
+{
+    return batch_size;
+}
+
+double EvaluatorPool::getTimeout() const
+{
+    return timeout;
+}
+
+uint64_t EvaluatorPool::getNumberOfRequests()
+{
+    pthread_mutex_lock( &mutex );
+    uint64_t num = num_requests;
+    pthread_mutex_unlock( &mutex );
+    return num;
+}
+
+/**
+    Returns the number of workers which were killed and started again.
+*/
+uint64_t EvaluatorPool::getNumberOfRestarts()
+{
+    pthread_mutex_lock( &mutex );
+    uint64_t num = num_restarts;
+    pthread_mutex_unlock( &mutex );
+    return num;
+}
+
+uint64_t EvaluatorPool::getNumberOfTimeouts()
+{
+    pthread_mutex_lock( &mutex );
+    uint64_t num = num_timeouts;
+    pthread_mutex_unlock( &mutex );
+    return num;
+}
+
+/**
+    Distributes the queued requests to the workers and collects the answers
+    until all requests are answered.
+*/
+void EvaluatorPool::run( const double *positions, size_t stride, double *out )
+{
+    std::vector<pollfd> fds( 2 * workers.size() );
+
+    while( true )
+    {
+        bool busy = false;
+        double deadline = 0.;
+
+        for( size_t i = 0; i < workers.size(); i++ )
+        {
+            Worker &worker = workers[i];
+
+            try
+            {
+                while( !queue.empty() && worker.pending.size() < max_in_flight )
+                {
+                    Request request = queue.front();
+                    queue.pop_front();
+                    send( worker, request, positions, stride );
+                }
+            }
+            catch( RuntimeError &err )
+            {
+                fail( worker, err.getMessage() );
+
+                //the worker was restarted, the next iteration gives it the requests again
+                i--;
+                continue;
+            }
+
+            pollfd &fd_out = fds[2 * i];
+            pollfd &fd_in = fds[2 * i + 1];
+            fd_out.fd = worker.output_offset < worker.output.size() ? worker.process->getStdinDescriptor() : -1;
+            fd_out.events = POLLOUT;
+            fd_out.revents = 0;
+            fd_in.fd = worker.pending.empty() ? -1 : worker.process->getStdoutDescriptor();
+            fd_in.events = POLLIN;
+            fd_in.revents = 0;
+
+            if( !worker.pending.empty() )
+            {
+                deadline = busy ? std::min( deadline, worker.deadline ) : worker.deadline;
+                busy = true;
+            }
+        }
+
+        if( !busy ) {return;}
+
+        double wait = std::max( deadline - now(), 0. );
+        int result = poll( &fds[0], fds.size(), static_cast<int>( ceil( wait * 1000. ) ) );
+
+        if( result < 0 && errno != EINTR )
+        {
+            throw RuntimeError( std::string( "Error evaluating function: poll failed: " ) + strerror( errno ) );
+        }
+
+        for( size_t i = 0; result > 0 && i < workers.size(); i++ )
+        {
+            Worker &worker = workers[i];
+            std::string error;
+
+            try
+            {
+                if( fds[2 * i].revents )
+                {
+                    writeOutput( worker );
+                }
+
+                if( fds[2 * i + 1].revents && !readInput( worker, out ) )
+                {
+                    error = "closed its output";
+                }
+            }
+            catch( RuntimeError &err )
+            {
+                error = err.getMessage();
+            }
+
+            //outside of the try block, the error of the last retry must reach the caller
+            if( !error.empty() )
+            {
+                fail( worker, error );
+            }
+        }
+
+        double time = now();
+
+        for( size_t i = 0; i < workers.size(); i++ )
+        {
+            if( !workers[i].pending.empty() && workers[i].deadline <= time )
+            {
+                num_timeouts++;
+                fail( workers[i], "timed out" );
+            }
+        }
+    }
+}
+
+/**
+    Appends the frame of \a request to the output of \a worker.
+*/
+void EvaluatorPool::send( Worker &worker, Request request, const double *positions, size_t stride )
+{
+    if( worker.pending.empty() )
+    {
+        worker.deadline = now() + timeout;
+    }
+
+    request.id = next_id++;
+
+    Header header;
+    header.magic = magic;
+    header.id = request.id;
+    header.count = static_cast<uint32_t>( request.count );
+    header.dimension = static_cast<uint32_t>( dimension );
+
+    size_t offset = worker.output.size();
+    worker.output.resize( offset + sizeof( header ) + request.count * dimension * sizeof( double ) );
+    memcpy( &worker.output[offset], &header, sizeof( header ) );
+    offset += sizeof( header );
+
+    for( size_t i = 0; i < request.count; i++ )
+    {
+        memcpy( &worker.output[offset], positions + ( request.first + i ) * stride, dimension * sizeof( double ) );
+        offset += dimension * sizeof( double );
+    }
+
+    worker.pending.push_back( request );
+    num_requests++;
+
+    //tries to write at once, most frames fit into the pipe and poll is only needed for the rest
+    writeOutput( worker );
+}
+
+/**
+    Writes as much of the output of \a worker as the pipe takes without
+    blocking. A worker which has exited must not terminate the program with
+    SIGPIPE, therefore the signal is blocked in the calling thread during the
+    writes and a SIGPIPE raised by them is taken off again. The disposition
+    of the signal and the other threads are not touched.
+*/
+void EvaluatorPool::writeOutput( Worker &worker )
+{
+    sigset_t pipe_signal, old_mask, pending;
+    sigemptyset( &pipe_signal );
+    sigaddset( &pipe_signal, SIGPIPE );
+    pthread_sigmask( SIG_BLOCK, &pipe_signal, &old_mask );
+
+    //a SIGPIPE which was already pending belongs to someone else and is kept
+    sigpending( &pending );
+    bool was_pending = sigismember( &pending, SIGPIPE ) == 1;
+    int error = 0;
+
+    while( worker.output_offset < worker.output.size() )
+    {
+        ssize_t written = write( worker.process->getStdinDescriptor(), &worker.output[worker.output_offset], worker.output.size() - worker.output_offset );
+
+        if( written < 0 )
+        {
+            if( errno == EINTR ) {continue;}
+
+            error = errno;
+            break;
+        }
+
+        worker.output_offset += written;
+    }
+
+    if( error == EPIPE && !was_pending )
+    {
+        struct timespec zero = {0, 0};
+
+        while( sigtimedwait( &pipe_signal, NULL, &zero ) == -1 && errno == EINTR ) {}
+    }
+
+    pthread_sigmask( SIG_SETMASK, &old_mask, NULL );
+
+    if( error == EAGAIN || error == EWOULDBLOCK ) {return;}
+
+    if( error != 0 )
+    {
+        throw RuntimeError( std::string( "write failed: " ) + strerror( error ) );
+    }
+
+    worker.output.clear();
+    worker.output_offset = 0;
+}
+
+/**
+    Reads the available bytes from \a worker and stores the values of all
+    complete responses. Returns false if the worker has closed its stdout.
+*/
+bool EvaluatorPool::readInput( Worker &worker, double *out )
+{
+    char buffer[65536];
+    bool open = true;
+
+    while( true )
+    {
+        ssize_t num = read( worker.process->getStdoutDescriptor(), buffer, sizeof( buffer ) );
+
+        if( num < 0 )
+        {
+            if( errno == EINTR ) {continue;}
+
+            if( errno == EAGAIN || errno == EWOULDBLOCK ) {break;}
+
+            throw RuntimeError( std::string( "read failed: " ) + strerror( errno ) );
+        }
+
+        if( num == 0 )
+        {
+            open = false;
+            break;
+        }
+
+        worker.input.insert( worker.input.end(), buffer, buffer + num );
+    }
+
+    size_t offset = 0;
+
+    while( worker.input.size() - offset >= sizeof( Header ) )
+    {
+        Header header;
+        memcpy( &header, &worker.input[offset], sizeof( header ) );
+
+        if( header.magic != magic || header.dimension != 1 )
+        {
+            throw RuntimeError( "sent an invalid frame" );
+        }
+
+        //the workers may answer in any order
+        std::deque<Request>::iterator request = worker.pending.begin();
+
+        while( request != worker.pending.end() && request->id != header.id )
+        {
+            ++request;
+        }
+
+        if( request == worker.pending.end() || header.count != request->count )
+        {
+            throw RuntimeError( "sent an unexpected response" );
+        }
+
+        size_t size = sizeof( header ) + header.count * sizeof( double );
+
+        if( worker.input.size() - offset < size ) {break;}
+
+        memcpy( out + request->first, &worker.input[offset + sizeof( header )], header.count * sizeof( double ) );
+        offset += size;
+        worker.pending.erase( request );
+        worker.deadline = now() + timeout;
+    }
+
+    worker.input.erase( worker.input.begin(), worker.input.begin() + offset );
+    return open;
+}
+
+/**
+    Restarts \a worker and queues its pending requests again.
+*/
+void EvaluatorPool::fail( Worker &worker, const std::string &reason )
+{
+    bool exhausted = false;
+
+    //in reverse order, so the requests keep their order at the front of the queue
+    while( !worker.pending.empty() )
+    {
+        Request request = worker.pending.back();
+        worker.pending.pop_back();
+        exhausted = exhausted || ++request.attempts > max_retries;
+        queue.push_front( request );
+    }
+
+    start( worker );
+
+    if( exhausted )
+    {
+        throw RuntimeError( std::string( "Error evaluating function: the evaluator \"" ) + command + "\" " + reason + "!" );
+    }
+}
+
+/**
+    Starts the process of \a worker, a running process is killed first.
+*/
+void EvaluatorPool::start( Worker &worker )
+{
+    if( worker.process )
+    {
+        stop( worker, SIGKILL );
+        num_restarts++;
+    }
+
+    worker.output.clear();
+    worker.output_offset = 0;
+    worker.input.clear();
+    worker.pending.clear();
+    worker.deadline = 0.;
+    worker.process = new Subprocess( command );
+
+    int fds[2] = {worker.process->getStdinDescriptor(), worker.process->getStdoutDescriptor()};
+
+    for( size_t i = 0; i < 2; i++ )
+    {
+        int flags = fcntl( fds[i], F_GETFL );
+
+        if( flags == -1 || fcntl( fds[i], F_SETFL, flags | O_NONBLOCK ) == -1 )
+        {
+            stop( worker, SIGKILL );
+            throw RuntimeError( "Error creating evaluator pool: unable to make the pipes non-blocking!" );
+        }
+    }
+}
+
+/**
+    Sends \a signal to the process of \a worker and waits until it has exited.
+*/
+void EvaluatorPool::stop( Worker &worker, int signal )
+{
+    if( !worker.process ) {return;}
+
+    worker.process->kill( signal );
+    delete worker.process;
+    worker.process = NULL;
+}
+
+/**
+    Returns the seconds of a monotonic clock.
+*/
+double EvaluatorPool::now()
+{
+    timespec time;
+    clock_gettime( CLOCK_MONOTONIC, &time );
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
@@ -0,0 +1,185 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVALUATORPOOL_H
+#define EVALUATORPOOL_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "exception.h"
+#include "subprocess.h"
+#include "vectorview.h"
+
+/**
+    Pool of long-lived evaluator processes which compute the fitness outside
+    of the program, for example a simulation. Every worker runs \a command
+    with the shell and stays alive between the calls; it should be started
+    with exec, otherwise a crashed or hung worker is only killed together with
+    the shell.
+
+    The positions are sent to the stdin of a worker in frames of a compact
+    binary protocol, all fields in the native byte order of the machine:
+
+    - request:  header {magic, id, count, dimension} as uint32, followed by
+                count * dimension doubles, the coordinates of one point after
+                the other
+    - response: header {magic, id, count, 1} as uint32, followed by count
+                doubles, the fitness of each point of the request with the
+                same id. A point which cannot be evaluated should be NaN.
+
+    The points of one call of \ref evaluate are split into requests of at most
+    \ref getBatchSize points. Each worker gets up to \ref getMaxInFlight
+    requests before it has answered the first, so it never waits for the next
+    request. The pipes are non-blocking and served with poll, large frames do
+    not deadlock if a worker writes before it has read the whole request.
+
+    A worker which exits, closes its pipes, answers with a broken frame or does
+    not answer its oldest request within the timeout is killed and restarted.
+    Its pending requests are sent again, a request which failed more than the
+    number of retries throws a RuntimeError.
+
+    The calls of \ref evaluate are serialised with a mutex, the parallelism
+    comes from the workers. A large batch per call keeps all workers busy.
+*/
+class EvaluatorPool
+{
+    public:
+        static const uint32_t magic = 0x50534f45;                       //"EOSP" in little endian
+
+        EvaluatorPool( const std::string &command, size_t dim, size_t num_workers = 1, size_t max_in_flight = 2, size_t batch_size = 64, double timeout = 60.,
+                       size_t max_retries = 2 );
+        virtual ~EvaluatorPool();
+
+        void evaluate( const double *positions, size_t count, size_t stride, size_t dim, double *out );
+
+        const std::string &getCommand() const;
+        size_t getDimension() const;
+        size_t getNumberOfWorkers() const;
+        size_t getMaxInFlight() const;
+        size_t getBatchSize() const;
+        double getTimeout() const;
+
+        uint64_t getNumberOfRequests();
+        uint64_t getNumberOfRestarts();
+        uint64_t getNumberOfTimeouts();
+
+    private:
+        EvaluatorPool( const EvaluatorPool &other ) {}
+        EvaluatorPool &operator=( const EvaluatorPool &other ) {return *this;}
+
+        struct Header
+        {
+            uint32_t    magic;
+            uint32_t    id;
+            uint32_t    count;
+            uint32_t    dimension;
+        };
+
+        struct Request
+        {
+            uint32_t    id;
+            size_t      first;                                          //index of the first point in the current call
+            size_t      count;
+            size_t      attempts;
+        };
+
+        struct Worker
+        {
+            Subprocess          *process;
+            std::vector<char>   output;                                 //frames not yet written to the worker
+            size_t              output_offset;
+            std::vector<char>   input;                                  //bytes of incomplete responses
+            std::deque<Request> pending;                                //requests sent and not yet answered
+            double              deadline;                               //time by which the oldest pending request must be answered
+        };
+
+        void run( const double *positions, size_t stride, double *out );
+        void send( Worker &worker, Request request, const double *positions, size_t stride );
+        void writeOutput( Worker &worker );
+        bool readInput( Worker &worker, double *out );
+        void fail( Worker &worker, const std::string &reason );
+        void start( Worker &worker );
+        void stop( Worker &worker, int signal );
+
+        static double now();
+
+        std::string         command;
+        size_t              dimension;
+        size_t              max_in_flight;
+        size_t              batch_size;
+        double              timeout;
+        size_t              max_retries;
+        std::vector<Worker> workers;
+        std::deque<Request> queue;                                      //requests of the current call not assigned to a worker
+        uint32_t            next_id;
+        uint64_t            num_requests;
+        uint64_t            num_restarts;
+        uint64_t            num_timeouts;
+        pthread_mutex_t     mutex;
+};
+
+/**
+    Functor for \ref Swarm which evaluates the fitness with an
+    \ref EvaluatorPool. All copies share the pool, which is owned by the
+    caller and must live longer than the copies.
+*/
+class ExternalFunction
+{
+    public:
+        ExternalFunction() : pool( NULL ) {}
+        explicit ExternalFunction( EvaluatorPool *pool_ ) : pool( pool_ ) {}
+
+        double operator()( const VectorView<double> &x )
+        {
+            double value;
+            evaluateBatch( x.getData(), 1, x.size(), x.size(), &value );
+            return value;
+        }
+
+        void evaluateBatch( const double *positions, size_t count, size_t stride, size_t dim, double *out )
+        {
+            if( !pool )
+            {
+                throw RuntimeError( "Error evaluating function: no evaluator pool!" );
+            }
+
+            pool->evaluate( positions, count, stride, dim, out );
+        }
+
+        EvaluatorPool *getPool() const
+        {
+            return pool;
+        }
+
+    protected:
+        EvaluatorPool *pool;
+};
+
+inline void evaluateBatch( ExternalFunction &func, const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    func.evaluateBatch( positions, count, stride, dim, out );
+}
+
+#endif // EVALUATORPOOL_H
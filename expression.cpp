@@ -0,0 +1,684 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "expression.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <locale>
+#include <sstream>
+
+#include "exception.h"
+
+namespace
+{
+    struct OpcodeInfo
+    {
+        const char *name;
+        size_t      arguments;
+    };
+
+    const OpcodeInfo opcode_info[Expression::NUMBER_OF_OPCODES] =
+    {
+        {"const", 0}, {"var", 0},
+        {"-", 1}, {"+", 2}, {"-", 2}, {"*", 2}, {"/", 2}, {"^", 2},
+        {"<", 2}, {">", 2}, {"<=", 2}, {">=", 2}, {"==", 2}, {"!=", 2},
+        {"&&", 2}, {"||", 2}, {"?:", 3},
+        {"sin", 1}, {"cos", 1}, {"tan", 1}, {"asin", 1}, {"acos", 1}, {"atan", 1}, {"sinh", 1}, {"cosh", 1}, {"tanh", 1},
+        {"asinh", 1}, {"acosh", 1}, {"atanh", 1}, {"exp", 1}, {"ln", 1}, {"log2", 1}, {"log10", 1}, {"sqrt", 1},
+        {"abs", 1}, {"sign", 1}, {"rint", 1}, {"min", 2}, {"max", 2}
+    };
+
+    /**
+        Converts \a value with \a precision significant digits like %g in
+        the C locale. muParser and \ref Expression::parse expect a decimal
+        point, whatever LC_NUMERIC the GUI has set.
+    */
+    std::string formatNumber( double value, int precision )
+    {
+        std::ostringstream sstream;
+        sstream.imbue( std::locale::classic() );
+        sstream.precision( precision );
+        sstream << value;
+        return sstream.str();
+    }
+
+    double readNumber( const std::string &number )
+    {
+        std::istringstream sstream( number );
+        sstream.imbue( std::locale::classic() );
+        double value = 0.;
+        sstream >> value;
+        return value;
+    }
+}
+
+Expression::Expression() : root( 0 ), num_variables( 0 ), position( 0 )
+{
+
+}
+
+/**
+    Parses \a expr and replaces the current content. Throws a RuntimeError
+    if the expression contains something which is not supported, see the
+    description of the class. The expression should have been checked by
+    muParser before, the messages are therefore short.
+
+    \param[in] expr
+*/
+void Expression::parse( const std::string &expr )
+{
+    clear();
+    text = expr;
+    position = 0;
+
+    root = parseTernary();
+    skipSpaces();
+
+    if( position != text.size() )
+    {
+        error( "unexpected character" );
+    }
+
+    text.clear();
+}
+
+void Expression::clear()
+{
+    nodes.clear();
+    root = 0;
+    num_variables = 0;
+}
+
+size_t Expression::getNumberOfNodes() const
+{
+    return nodes.size();
+}
+
+const Expression::Node &Expression::getNode( size_t i ) const
+{
+    return nodes[i];
+}
+
+/**
+    Returns the index of the node whose value is the value of the expression.
+*/
+size_t Expression::getRoot() const
+{
+    return root;
+}
+
+/**
+    Returns the number of variables the expression needs, which is the
+    highest index n of a used variable xn.
+*/
+size_t Expression::getNumberOfVariables() const
+{
+    return num_variables;
+}
+
+/**
+    Returns in \a counts how often each node is used as argument, the root
+    counts as one use. Nodes used more than once are common subexpressions.
+*/
+void Expression::getUseCounts( std::vector<size_t> &counts ) const
+{
+    counts.assign( nodes.size(), 0 );
+
+    for( size_t i = 0; i < nodes.size(); i++ )
+    {
+        for( size_t j = 0; j < getNumberOfArguments( nodes[i].opcode ); j++ )
+        {
+            counts[nodes[i].args[j]]++;
+        }
+    }
+
+    if( !nodes.empty() )
+    {
+        counts[root]++;
+    }
+}
+
+/**
+    Returns the number of operations which contribute to the root, a shared
+    sub-expression counts once. Constants and variables are no operations.
+*/
+size_t Expression::getNumberOfOperations() const
+{
+    if( nodes.empty() ) {return 0;}
+
+    std::vector<bool> used( nodes.size(), false );
+    size_t count = 0;
+    used[root] = true;
+
+    for( size_t i = root + 1; i-- > 0; )
+    {
+        if( !used[i] || getNumberOfArguments( nodes[i].opcode ) == 0 ) {continue;}
+
+        count++;
+
+        for( size_t j = 0; j < getNumberOfArguments( nodes[i].opcode ); j++ )
+        {
+            used[nodes[i].args[j]] = true;
+        }
+    }
+
+    return count;
+}
+
+/**
+    Returns the expression as text in the syntax of muParser, which is used to
+    hand an optimized expression to the parser. Every operation is put in
+    parentheses and common subexpressions are written at each use, because
+    muParser has no variables for intermediate results. Non-finite constants
+    are written as divisions by zero.
+
+    Because of the shared nodes the text can be much longer than the
+    expression it was parsed from, an empty string is returned if it would
+    exceed \a max_length characters.
+
+    \param[in] max_length
+*/
+std::string Expression::toString( size_t max_length ) const
+{
+    std::string result;
+
+    if( !nodes.empty() )
+    {
+        appendNode( result, root, max_length );
+    }
+
+    if( result.size() > max_length )
+    {
+        result.clear();
+    }
+
+    return result;
+}
+
+size_t Expression::getNumberOfArguments( Opcode opcode )
+{
+    return opcode_info[opcode].arguments;
+}
+
+const char *Expression::getName( Opcode opcode )
+{
+    return opcode_info[opcode].name;
+}
+
+void Expression::appendNode( std::string &result, size_t i, size_t max_length ) const
+{
+    const Node &node = nodes[i];
+
+    if( result.size() > max_length )
+    {
+        return;
+    }
+
+    switch( node.opcode )
+    {
+        case OP_CONSTANT:
+        {
+            if( isnan( node.value ) )
+            {
+                result += "(0/0)";
+            }
+            else if( isinf( node.value ) )
+            {
+                result += node.value > 0 ? "(1/0)" : "(-1/0)";
+            }
+            else
+            {
+                //the shortest of the two forms which gives back the same double
+                std::string number = formatNumber( node.value, 15 );
+
+                if( readNumber( number ) != node.value )
+                {
+                    number = formatNumber( node.value, 17 );
+                }
+
+                result += node.value < 0 ? "(" + number + ")" : number;
+            }
+
+            break;
+        }
+        case OP_VARIABLE:
+        {
+            char buffer[32];
+            snprintf( buffer, sizeof( buffer ), "x%lu", static_cast<unsigned long>( node.variable + 1 ) );
+            result += buffer;
+            break;
+        }
+        case OP_NEGATE:
+            result += "(-";
+            appendNode( result, node.args[0], max_length );
+            result += ")";
+            break;
+        case OP_IF:
+            result += "(";
+            appendNode( result, node.args[0], max_length );
+            result += "?";
+            appendNode( result, node.args[1], max_length );
+            result += ":";
+            appendNode( result, node.args[2], max_length );
+            result += ")";
+            break;
+        default:
+            if( node.opcode >= OP_ADD && node.opcode <= OP_OR )
+            {
+                result += "(";
+                appendNode( result, node.args[0], max_length );
+                result += getName( node.opcode );
+                appendNode( result, node.args[1], max_length );
+                result += ")";
+            }
+            else
+            {
+                result += getName( node.opcode );
+                result += "(";
+
+                for( size_t j = 0; j < getNumberOfArguments( node.opcode ); j++ )
+                {
+                    if( j > 0 ) {result += ",";}
+
+                    appendNode( result, node.args[j], max_length );
+                }
+
+                result += ")";
+            }
+    }
+}
+
+size_t Expression::addNode( Opcode opcode, size_t a, size_t b, size_t c )
+{
+    Node node;
+    node.opcode = opcode;
+    node.value = 0.;
+    node.variable = 0;
+    node.args[0] = a;
+    node.args[1] = b;
+    node.args[2] = c;
+    nodes.push_back( node );
+    return nodes.size() - 1;
+}
+
+size_t Expression::addConstant( double value )
+{
+    size_t i = addNode( OP_CONSTANT );
+    nodes[i].value = value;
+    return i;
+}
+
+size_t Expression::addVariable( size_t variable )
+{
+    size_t i = addNode( OP_VARIABLE );
+    nodes[i].variable = variable;
+    num_variables = std::max( num_variables, variable + 1 );
+    return i;
+}
+
+size_t Expression::parseTernary()
+{
+    size_t condition = parseOr();
+
+    if( accept( "?" ) )
+    {
+        size_t a = parseTernary();
+        expect( ":" );
+        size_t b = parseTernary();
+        return addNode( OP_IF, condition, a, b );
+    }
+
+    return condition;
+}
+
+size_t Expression::parseOr()
+{
+    size_t left = parseAnd();
+
+    while( accept( "||" ) )
+    {
+        left = addNode( OP_OR, left, parseAnd() );
+    }
+
+    return left;
+}
+
+size_t Expression::parseAnd()
+{
+    size_t left = parseComparison();
+
+    while( accept( "&&" ) )
+    {
+        left = addNode( OP_AND, left, parseComparison() );
+    }
+
+    return left;
+}
+
+size_t Expression::parseComparison()
+{
+    size_t left = parseSum();
+
+    while( true )
+    {
+        Opcode opcode;
+
+        //the two character operators have to be tested first
+        if( accept( "<=" ) ) {opcode = OP_LESS_EQUAL;}
+        else if( accept( ">=" ) ) {opcode = OP_GREATER_EQUAL;}
+        else if( accept( "==" ) ) {opcode = OP_EQUAL;}
+        else if( accept( "!=" ) ) {opcode = OP_NOT_EQUAL;}
+        else if( accept( "<" ) ) {opcode = OP_LESS;}
+        else if( accept( ">" ) ) {opcode = OP_GREATER;}
+        else {return left;}
+
+        left = addNode( opcode, left, parseSum() );
+    }
+}
+
+size_t Expression::parseSum()
+{
+    size_t left = parseProduct();
+
+    while( true )
+    {
+        if( accept( "+" ) )
+        {
+            left = addNode( OP_ADD, left, parseProduct() );
+        }
+        else if( accept( "-" ) )
+        {
+            left = addNode( OP_SUBTRACT, left, parseProduct() );
+        }
+        else
+        {
+            return left;
+        }
+    }
+}
+
+size_t Expression::parseProduct()
+{
+    size_t left = parseUnary();
+
+    while( true )
+    {
+        if( accept( "*" ) )
+        {
+            left = addNode( OP_MULTIPLY, left, parseUnary() );
+        }
+        else if( accept( "/" ) )
+        {
+            left = addNode( OP_DIVIDE, left, parseUnary() );
+        }
+        else
+        {
+            return left;
+        }
+    }
+}
+
+/**
+    Like in muParser the unary minus binds weaker than ^, -x^2 is -(x^2).
+*/
+size_t Expression::parseUnary()
+{
+    if( accept( "-" ) )
+    {
+        return addNode( OP_NEGATE, parseUnary() );
+    }
+
+    if( accept( "+" ) )
+    {
+        return parseUnary();
+    }
+
+    return parsePower();
+}
+
+/**
+    The power operator is right associative, x^2^3 is x^(2^3).
+*/
+size_t Expression::parsePower()
+{
+    size_t base = parsePrimary();
+
+    if( accept( "^" ) )
+    {
+        return addNode( OP_POWER, base, parseUnary() );
+    }
+
+    return base;
+}
+
+size_t Expression::parsePrimary()
+{
+    skipSpaces();
+
+    if( position >= text.size() )
+    {
+        error( "unexpected end of expression" );
+    }
+
+    char c = text[position];
+
+    if( accept( "(" ) )
+    {
+        size_t inner = parseTernary();
+        expect( ")" );
+        return inner;
+    }
+
+    if( isdigit( c ) || c == '.' )
+    {
+        //digits, an optional fraction and an optional exponent, read independent of the locale
+        size_t end = text.find_first_not_of( "0123456789", position );
+        end = std::min( end, text.size() );
+
+        if( end < text.size() && text[end] == '.' )
+        {
+            end = std::min( text.find_first_not_of( "0123456789", end + 1 ), text.size() );
+        }
+
+        if( end < text.size() && ( text[end] == 'e' || text[end] == 'E' ) )
+        {
+            size_t digits = end + 1;
+
+            if( digits < text.size() && ( text[digits] == '+' || text[digits] == '-' ) )
+            {
+                digits++;
+            }
+
+            if( digits < text.size() && isdigit( text[digits] ) )
+            {
+                end = std::min( text.find_first_not_of( "0123456789", digits ), text.size() );
+            }
+        }
+
+        std::string number = text.substr( position, end - position );
+
+        if( number == "." )
+        {
+            error( "invalid number" );
+        }
+
+        position = end;
+        return addConstant( readNumber( number ) );
+    }
+
+    if( isalpha( c ) || c == '_' )
+    {
+        size_t begin = position;
+
+        while( position < text.size() && ( isalnum( text[position] ) || text[position] == '_' ) )
+        {
+            position++;
+        }
+
+        std::string name = text.substr( begin, position - begin );
+
+        if( accept( "(" ) )
+        {
+            return parseFunction( name );
+        }
+
+        if( name == "_pi" )
+        {
+            return addConstant( M_PI );
+        }
+
+        if( name == "_e" )
+        {
+            return addConstant( M_E );
+        }
+
+        if( name.size() > 1 && name[0] == 'x' && name.find_first_not_of( "0123456789", 1 ) == std::string::npos && name[1] != '0' )
+        {
+            return addVariable( strtoul( name.c_str() + 1, NULL, 10 ) - 1 );
+        }
+
+        error( "unknown name " + name );
+    }
+
+    error( std::string( "unexpected character " ) + c );
+    return 0;
+}
+
+/**
+    Parses the arguments of the function \a name, the opening parenthesis
+    has already been read.
+*/
+size_t Expression::parseFunction( const std::string &name )
+{
+    std::vector<size_t> args;
+
+    if( !accept( ")" ) )
+    {
+        do
+        {
+            args.push_back( parseTernary() );
+        }
+        while( accept( "," ) );
+
+        expect( ")" );
+    }
+
+    if( name == "pow" )
+    {
+        if( args.size() != 2 ) {error( "pow needs two arguments" );}
+
+        return addNode( OP_POWER, args[0], args[1] );
+    }
+
+    if( name == "min" || name == "max" || name == "sum" || name == "avg" )
+    {
+        if( args.empty() ) {error( name + " needs at least one argument" );}
+
+        Opcode opcode = name == "min" ? OP_MIN : ( name == "max" ? OP_MAX : OP_ADD );
+        size_t result = args[0];
+
+        for( size_t i = 1; i < args.size(); i++ )
+        {
+            result = addNode( opcode, result, args[i] );
+        }
+
+        if( name == "avg" )
+        {
+            result = addNode( OP_DIVIDE, result, addConstant( static_cast<double>( args.size() ) ) );
+        }
+
+        return result;
+    }
+
+    //muParser defines log as the natural logarithm, like ln
+    std::string lookup = ( name == "log" ? "ln" : name );
+
+    for( int i = OP_SIN; i < NUMBER_OF_OPCODES; i++ )
+    {
+        if( lookup == opcode_info[i].name )
+        {
+            if( args.size() != opcode_info[i].arguments )
+            {
+                error( "wrong number of arguments for " + name );
+            }
+
+            return addNode( static_cast<Opcode>( i ), args[0], args.size() > 1 ? args[1] : 0 );
+        }
+    }
+
+    error( "unknown function " + name );
+    return 0;
+}
+
+void Expression::skipSpaces()
+{
+    while( position < text.size() && isspace( text[position] ) )
+    {
+        position++;
+    }
+}
+
+/**
+    Reads \a token if it is the next token. A single character operator
+    is not accepted if it is the beginning of a two character operator.
+*/
+bool Expression::accept( const char *token )
+{
+    skipSpaces();
+    size_t length = strlen( token );
+
+    if( text.compare( position, length, token ) != 0 )
+    {
+        return false;
+    }
+
+    if( length == 1 && position + 1 < text.size() )
+    {
+        char next = text[position + 1];
+
+        if( ( token[0] == '<' || token[0] == '>' ) && next == '=' )
+        {
+            return false;
+        }
+    }
+
+    position += length;
+    return true;
+}
+
+void Expression::expect( const char *token )
+{
+    if( !accept( token ) )
+    {
+        error( std::string( "expected " ) + token );
+    }
+}
+
+void Expression::error( const std::string &message ) const
+{
+    std::stringstream sstream;
+    sstream << "Error parsing expression at position " << position << ": " << message;
+    throw RuntimeError( sstream.str() );
+}
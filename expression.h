@@ -0,0 +1,116 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+/**
+    Syntax tree of an expression in the notation of muParser with the
+    variables x1, x2, x3, ... It is the common input of the evaluation
+    backends of \ref Function which do not use the parser, for example
+    \ref NativeExpression.
+
+    The nodes are stored in a flat array in which the arguments of a node
+    always precede the node itself, therefore the array can be evaluated
+    from the front to the back. A node may be the argument of several
+    other nodes, which makes the tree a directed acyclic graph.
+
+    Supported are the operators + - * / ^, the comparisons, && || and the
+    ternary operator ?:, the constants _pi and _e and the functions of
+    muParser plus pow. The functions min, max, sum and avg with more than
+    two arguments are expanded into binary operations. Everything else is
+    rejected with a RuntimeError.
+*/
+class Expression
+{
+    public:
+        enum Opcode {OP_CONSTANT, OP_VARIABLE,
+                     OP_NEGATE, OP_ADD, OP_SUBTRACT, OP_MULTIPLY, OP_DIVIDE, OP_POWER,
+                     OP_LESS, OP_GREATER, OP_LESS_EQUAL, OP_GREATER_EQUAL, OP_EQUAL, OP_NOT_EQUAL,
+                     OP_AND, OP_OR, OP_IF,
+                     OP_SIN, OP_COS, OP_TAN, OP_ASIN, OP_ACOS, OP_ATAN, OP_SINH, OP_COSH, OP_TANH,
+                     OP_ASINH, OP_ACOSH, OP_ATANH, OP_EXP, OP_LOG, OP_LOG2, OP_LOG10, OP_SQRT,
+                     OP_ABS, OP_SIGN, OP_RINT, OP_MIN, OP_MAX, NUMBER_OF_OPCODES
+                    };
+
+        struct Node
+        {
+            Opcode  opcode;
+            double  value;          //OP_CONSTANT
+            size_t  variable;       //OP_VARIABLE, zero based: x1 is variable 0
+            size_t  args[3];        //indices of the arguments, see getNumberOfArguments
+        };
+
+        Expression();
+
+        void parse( const std::string &expr );
+        void clear();
+
+        size_t getNumberOfNodes() const;
+        const Node &getNode( size_t i ) const;
+        size_t getRoot() const;
+        size_t getNumberOfVariables() const;
+
+        void getUseCounts( std::vector<size_t> &counts ) const;
+        size_t getNumberOfOperations() const;
+
+        std::string toString( size_t max_length = std::string::npos ) const;
+
+        static size_t getNumberOfArguments( Opcode opcode );
+        static const char *getName( Opcode opcode );
+
+    protected:
+        friend class ExpressionOptimizer;
+
+        void appendNode( std::string &result, size_t i, size_t max_length ) const;
+
+        size_t addNode( Opcode opcode, size_t a = 0, size_t b = 0, size_t c = 0 );
+        size_t addConstant( double value );
+        size_t addVariable( size_t variable );
+
+        size_t parseTernary();
+        size_t parseOr();
+        size_t parseAnd();
+        size_t parseComparison();
+        size_t parseSum();
+        size_t parseProduct();
+        size_t parseUnary();
+        size_t parsePower();
+        size_t parsePrimary();
+        size_t parseFunction( const std::string &name );
+
+        void skipSpaces();
+        bool accept( const char *token );
+        void expect( const char *token );
+        void error( const std::string &message ) const;
+
+        std::vector<Node>   nodes;
+        size_t              root;
+        size_t              num_variables;
+
+        std::string         text;           //only used while parsing
+        size_t              position;
+};
+
+#endif // EXPRESSION_H
@@ -0,0 +1,374 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "expressionoptimizer.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+ExpressionOptimizer::ExpressionOptimizer() : operations_before( 0 ), operations_after( 0 )
+{
+
+}
+
+/**
+    Writes the optimized form of \a input to \a output. The output uses the
+    same variables as the input, even if some of them are no longer needed.
+
+    \param[in]  input
+    \param[out] output
+*/
+void ExpressionOptimizer::optimize( const Expression &input, Expression &output )
+{
+    nodes.clear();
+    node_index.clear();
+    output.clear();
+    output.num_variables = input.getNumberOfVariables();
+    operations_before = input.getNumberOfOperations();
+    operations_after = 0;
+
+    if( input.getNumberOfNodes() == 0 ) {return;}
+
+    //the arguments precede each node, so they are already mapped when a node is reached
+    std::vector<size_t> mapping( input.getNumberOfNodes() );
+
+    for( size_t i = 0; i < input.getNumberOfNodes(); i++ )
+    {
+        const Expression::Node &node = input.getNode( i );
+
+        if( node.opcode == Expression::OP_CONSTANT || node.opcode == Expression::OP_VARIABLE )
+        {
+            mapping[i] = addNode( node );
+            continue;
+        }
+
+        size_t args[3] = {0, 0, 0};
+
+        for( size_t j = 0; j < Expression::getNumberOfArguments( node.opcode ); j++ )
+        {
+            args[j] = mapping[node.args[j]];
+        }
+
+        mapping[i] = addOperation( node.opcode, args[0], args[1], args[2] );
+    }
+
+    //copies the nodes which contribute to the root, the order is kept
+    size_t root = mapping[input.getRoot()];
+    std::vector<bool> used( root + 1, false );
+    std::vector<size_t> position( root + 1 );
+    used[root] = true;
+
+    for( size_t i = root + 1; i-- > 0; )
+    {
+        for( size_t j = 0; used[i] && j < Expression::getNumberOfArguments( nodes[i].opcode ); j++ )
+        {
+            used[nodes[i].args[j]] = true;
+        }
+    }
+
+    for( size_t i = 0; i <= root; i++ )
+    {
+        if( !used[i] ) {continue;}
+
+        Expression::Node node = nodes[i];
+
+        for( size_t j = 0; j < Expression::getNumberOfArguments( node.opcode ); j++ )
+        {
+            node.args[j] = position[node.args[j]];
+        }
+
+        position[i] = output.nodes.size();
+        output.nodes.push_back( node );
+    }
+
+    output.root = position[root];
+    operations_after = output.getNumberOfOperations();
+}
+
+/**
+    Returns the number of operations of the input of the last \ref optimize.
+*/
+size_t ExpressionOptimizer::getNumberOfOperationsBefore() const
+{
+    return operations_before;
+}
+
+/**
+    Returns the number of operations of the output of the last \ref optimize,
+    each shared sub-expression counts once.
+*/
+size_t ExpressionOptimizer::getNumberOfOperationsAfter() const
+{
+    return operations_after;
+}
+
+/**
+    Evaluates a single operation with the same definitions as the backends
+    of \ref Function.
+*/
+double ExpressionOptimizer::evaluate( Expression::Opcode opcode, double a, double b, double c )
+{
+    switch( opcode )
+    {
+        case Expression::OP_NEGATE:         return -a;
+        case Expression::OP_ADD:            return a + b;
+        case Expression::OP_SUBTRACT:       return a - b;
+        case Expression::OP_MULTIPLY:       return a * b;
+        case Expression::OP_DIVIDE:         return a / b;
+        case Expression::OP_POWER:          return pow( a, b );
+        case Expression::OP_LESS:           return a < b ? 1. : 0.;
+        case Expression::OP_GREATER:        return a > b ? 1. : 0.;
+        case Expression::OP_LESS_EQUAL:     return a <= b ? 1. : 0.;
+        case Expression::OP_GREATER_EQUAL:  return a >= b ? 1. : 0.;
+        case Expression::OP_EQUAL:          return a == b ? 1. : 0.;
+        case Expression::OP_NOT_EQUAL:      return a != b ? 1. : 0.;
+        case Expression::OP_AND:            return a != 0. && b != 0. ? 1. : 0.;
+        case Expression::OP_OR:             return a != 0. || b != 0. ? 1. : 0.;
+        case Expression::OP_IF:             return a != 0. ? b : c;
+        case Expression::OP_SIN:            return sin( a );
+        case Expression::OP_COS:            return cos( a );
+        case Expression::OP_TAN:            return tan( a );
+        case Expression::OP_ASIN:           return asin( a );
+        case Expression::OP_ACOS:           return acos( a );
+        case Expression::OP_ATAN:           return atan( a );
+        case Expression::OP_SINH:           return sinh( a );
+        case Expression::OP_COSH:           return cosh( a );
+        case Expression::OP_TANH:           return tanh( a );
+        case Expression::OP_ASINH:          return asinh( a );
+        case Expression::OP_ACOSH:          return acosh( a );
+        case Expression::OP_ATANH:          return atanh( a );
+        case Expression::OP_EXP:            return exp( a );
+        case Expression::OP_LOG:            return log( a );
+        case Expression::OP_LOG2:           return log2( a );
+        case Expression::OP_LOG10:          return log10( a );
+        case Expression::OP_SQRT:           return sqrt( a );
+        case Expression::OP_ABS:            return fabs( a );
+        case Expression::OP_SIGN:           return a > 0. ? 1. : ( a < 0. ? -1. : 0. );
+        case Expression::OP_RINT:           return floor( a + 0.5 );
+        case Expression::OP_MIN:            return b < a ? b : a;
+        case Expression::OP_MAX:            return a < b ? b : a;
+        default:                            return a;
+    }
+}
+
+bool ExpressionOptimizer::NodeKey::operator<( const NodeKey &other ) const
+{
+    if( opcode != other.opcode ) {return opcode < other.opcode;}
+
+    if( value != other.value ) {return value < other.value;}
+
+    if( variable != other.variable ) {return variable < other.variable;}
+
+    for( size_t i = 0; i < 3; i++ )
+    {
+        if( args[i] != other.args[i] ) {return args[i] < other.args[i];}
+    }
+
+    return false;
+}
+
+/**
+    Returns the index of a node equal to \a node, which is appended if it
+    does not exist yet.
+*/
+size_t ExpressionOptimizer::addNode( const Expression::Node &node )
+{
+    NodeKey key;
+    key.opcode = node.opcode;
+    key.value = 0;
+    key.variable = node.opcode == Expression::OP_VARIABLE ? node.variable : 0;
+
+    //constants are compared by their bit pattern, this keeps 0 and -0 apart and matches NaN
+    if( node.opcode == Expression::OP_CONSTANT )
+    {
+        memcpy( &key.value, &node.value, sizeof( key.value ) );
+    }
+
+    for( size_t i = 0; i < 3; i++ )
+    {
+        key.args[i] = i < Expression::getNumberOfArguments( node.opcode ) ? node.args[i] : 0;
+    }
+
+    std::map<NodeKey, size_t>::iterator it = node_index.find( key );
+
+    if( it != node_index.end() )
+    {
+        return it->second;
+    }
+
+    Expression::Node copy = node;
+
+    for( size_t i = 0; i < 3; i++ )
+    {
+        copy.args[i] = key.args[i];
+    }
+
+    nodes.push_back( copy );
+    node_index[key] = nodes.size() - 1;
+    return nodes.size() - 1;
+}
+
+size_t ExpressionOptimizer::addConstant( double value )
+{
+    Expression::Node node;
+    node.opcode = Expression::OP_CONSTANT;
+    node.value = value;
+    node.variable = 0;
+    node.args[0] = node.args[1] = node.args[2] = 0;
+    return addNode( node );
+}
+
+/**
+    Adds the operation \a opcode of the already optimized nodes \a a, \a b
+    and \a c after folding and simplifying it.
+*/
+size_t ExpressionOptimizer::addOperation( Expression::Opcode opcode, size_t a, size_t b, size_t c )
+{
+    size_t num_args = Expression::getNumberOfArguments( opcode );
+    bool constant = true;
+    size_t args[3] = {a, b, c};
+
+    for( size_t i = 0; i < num_args; i++ )
+    {
+        constant = constant && nodes[args[i]].opcode == Expression::OP_CONSTANT;
+    }
+
+    if( constant )
+    {
+        return addConstant( evaluate( opcode, nodes[a].value, num_args > 1 ? nodes[b].value : 0., num_args > 2 ? nodes[c].value : 0. ) );
+    }
+
+    //copies, the references would be invalidated by adding nodes
+    Expression::Node node_a = nodes[a];
+    Expression::Node node_b = nodes[num_args > 1 ? b : a];
+
+    switch( opcode )
+    {
+        case Expression::OP_NEGATE:
+            if( node_a.opcode == Expression::OP_NEGATE ) {return node_a.args[0];}
+
+            break;
+
+        case Expression::OP_ADD:
+            if( isConstant( a, 0. ) ) {return b;}
+
+            if( isConstant( b, 0. ) ) {return a;}
+
+            if( node_b.opcode == Expression::OP_NEGATE ) {return addOperation( Expression::OP_SUBTRACT, a, node_b.args[0] );}
+
+            if( node_a.opcode == Expression::OP_NEGATE ) {return addOperation( Expression::OP_SUBTRACT, b, node_a.args[0] );}
+
+            break;
+
+        case Expression::OP_SUBTRACT:
+            if( isConstant( b, 0. ) ) {return a;}
+
+            if( isConstant( a, 0. ) ) {return addOperation( Expression::OP_NEGATE, b );}
+
+            if( node_b.opcode == Expression::OP_NEGATE ) {return addOperation( Expression::OP_ADD, a, node_b.args[0] );}
+
+            break;
+
+        case Expression::OP_MULTIPLY:
+            if( isConstant( a, 1. ) ) {return b;}
+
+            if( isConstant( b, 1. ) ) {return a;}
+
+            if( isConstant( a, -1. ) ) {return addOperation( Expression::OP_NEGATE, b );}
+
+            if( isConstant( b, -1. ) ) {return addOperation( Expression::OP_NEGATE, a );}
+
+            break;
+
+        case Expression::OP_DIVIDE:
+            if( isConstant( b, 1. ) ) {return a;}
+
+            if( isConstant( b, -1. ) ) {return addOperation( Expression::OP_NEGATE, a );}
+
+            //the reciprocal of a power of two is exact
+            if( node_b.opcode == Expression::OP_CONSTANT && node_b.value != 0. && isfinite( node_b.value ) )
+            {
+                int exponent;
+                double reciprocal = 1. / node_b.value;
+
+                if( fabs( frexp( node_b.value, &exponent ) ) == 0.5 && isnormal( reciprocal ) )
+                {
+                    return addOperation( Expression::OP_MULTIPLY, a, addConstant( reciprocal ) );
+                }
+            }
+
+            break;
+
+        case Expression::OP_POWER:
+            if( isConstant( b, 0. ) ) {return addConstant( 1. );}
+
+            if( isConstant( b, 1. ) ) {return a;}
+
+            if( isConstant( b, 2. ) ) {return addOperation( Expression::OP_MULTIPLY, a, a );}
+
+            if( isConstant( b, -1. ) ) {return addOperation( Expression::OP_DIVIDE, addConstant( 1. ), a );}
+
+            //differs from pow only for -0 and -inf
+            if( isConstant( b, 0.5 ) ) {return addOperation( Expression::OP_SQRT, a );}
+
+            break;
+
+        case Expression::OP_IF:
+            if( node_a.opcode == Expression::OP_CONSTANT ) {return node_a.value != 0. ? b : c;}
+
+            if( b == c ) {return b;}
+
+            break;
+
+        default:
+            break;
+    }
+
+    switch( opcode )
+    {
+        case Expression::OP_ADD:
+        case Expression::OP_MULTIPLY:
+        case Expression::OP_EQUAL:
+        case Expression::OP_NOT_EQUAL:
+        case Expression::OP_AND:
+        case Expression::OP_OR:
+            if( a > b ) {std::swap( a, b );}
+
+            break;
+
+        default:
+            break;
+    }
+
+    Expression::Node node;
+    node.opcode = opcode;
+    node.value = 0.;
+    node.variable = 0;
+    node.args[0] = a;
+    node.args[1] = b;
+    node.args[2] = c;
+    return addNode( node );
+}
+
+bool ExpressionOptimizer::isConstant( size_t i, double value ) const
+{
+    return nodes[i].opcode == Expression::OP_CONSTANT && nodes[i].value == value;
+}
@@ -0,0 +1,80 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXPRESSIONOPTIMIZER_H
+#define EXPRESSIONOPTIMIZER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <map>
+#include <vector>
+
+#include "expression.h"
+
+/**
+    Rewrites an \ref Expression into an equivalent one with fewer operations:
+
+    - constant sub-expressions are folded into one constant
+    - identical sub-expressions are stored once and shared (hash consing), so
+      the evaluators compute them only once and keep the value as temporary.
+      The arguments of + * == != && || are ordered, so x1*x2 and x2*x1 match.
+    - algebraic simplifications which keep the result for all finite
+      arguments, for example x^2 to x*x, x^0.5 to sqrt(x), x*1 and x+0 to x,
+      x/4 to x*0.25, --x to x, a+(-b) to a-b and ?: with a constant condition
+
+    The number of operations before and after the optimization is reported
+    by \ref getNumberOfOperationsBefore and \ref getNumberOfOperationsAfter.
+*/
+class ExpressionOptimizer
+{
+    public:
+        ExpressionOptimizer();
+
+        void optimize( const Expression &input, Expression &output );
+
+        size_t getNumberOfOperationsBefore() const;
+        size_t getNumberOfOperationsAfter() const;
+
+        static double evaluate( Expression::Opcode opcode, double a, double b = 0., double c = 0. );
+
+    protected:
+        struct NodeKey
+        {
+            int         opcode;
+            uint64_t    value;          //bit pattern of the constant
+            size_t      variable;
+            size_t      args[3];
+
+            bool operator<( const NodeKey &other ) const;
+        };
+
+        size_t addNode( const Expression::Node &node );
+        size_t addConstant( double value );
+        size_t addOperation( Expression::Opcode opcode, size_t a, size_t b = 0, size_t c = 0 );
+
+        bool isConstant( size_t i, double value ) const;
+
+        std::vector<Expression::Node>   nodes;          //nodes of the optimized expression including unused ones
+        std::map<NodeKey, size_t>       node_index;
+        size_t                          operations_before;
+        size_t                          operations_after;
+};
+
+#endif // EXPRESSIONOPTIMIZER_H
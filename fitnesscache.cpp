@@ -0,0 +1,375 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fitnesscache.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace
+{
+    const size_t max_stripes = 64;
+
+    inline uint64_t mix( uint64_t h )
+    {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+}
+
+/**
+    \param[in] dim
+    \param[in] tolerance_   grid spacing of the quantized positions, zero for exact positions
+    \param[in] max_memory   upper bound of the memory of the table in bytes, at least one set is allocated
+*/
+FitnessCache::FitnessCache( size_t dim, double tolerance_, size_t max_memory ) : dimension( dim ), tolerance( 0. ), inverse_tolerance( 0. ), num_sets( 1 )
+{
+    if( dim == 0 )
+    {
+        throw RuntimeError( "Error creating fitness cache: the dimension must not be zero!" );
+    }
+
+    if( !( tolerance_ >= 0. ) || isinf( tolerance_ ) )
+    {
+        throw RuntimeError( "Error creating fitness cache: invalid tolerance!" );
+    }
+
+    if( tolerance_ > 0. )
+    {
+        tolerance = tolerance_;
+        inverse_tolerance = 1. / tolerance_;
+    }
+
+    size_t slot_size = dimension * sizeof( int64_t ) + sizeof( double ) + sizeof( uint64_t ) + sizeof( uint8_t );
+    size_t max_sets = max_memory / ( slot_size * ways );
+
+    while( num_sets * 2 <= max_sets )
+    {
+        num_sets *= 2;
+    }
+
+    keys.resize( num_sets * ways * dimension );
+    values.resize( num_sets * ways );
+    tags.resize( num_sets * ways );
+    referenced.resize( num_sets * ways );
+    hands.resize( num_sets );
+    stripes.resize( std::min( num_sets, max_stripes ) );
+
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_init( &stripes[i].mutex, NULL );
+    }
+
+    clear();
+}
+
+FitnessCache::~FitnessCache()
+{
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_destroy( &stripes[i].mutex );
+    }
+}
+
+/**
+    Returns true and the cached fitness in \a value if the quantized position
+    of \a x is in the cache.
+
+    \param[in]  x       \ref getDimension coordinates
+    \param[out] value
+*/
+bool FitnessCache::lookup( const double *x, double &value )
+{
+    uint64_t tag = hash( x );
+    size_t set = tag & ( num_sets - 1 );
+    Stripe &stripe = getStripe( set );
+
+    pthread_mutex_lock( &stripe.mutex );
+
+    for( size_t slot = set * ways; slot < ( set + 1 ) * ways; slot++ )
+    {
+        if( tags[slot] == tag && matches( slot, x ) )
+        {
+            value = values[slot];
+            referenced[slot] = 1;
+            stripe.hits++;
+            pthread_mutex_unlock( &stripe.mutex );
+            return true;
+        }
+    }
+
+    stripe.misses++;
+    pthread_mutex_unlock( &stripe.mutex );
+    return false;
+}
+
+/**
+    Stores the fitness of the quantized position of \a x. An existing entry
+    is overwritten, otherwise an empty slot of the set is used or an entry
+    evicted.
+
+    \param[in] x       \ref getDimension coordinates
+    \param[in] value
+*/
+void FitnessCache::insert( const double *x, double value )
+{
+    uint64_t tag = hash( x );
+    size_t set = tag & ( num_sets - 1 );
+    size_t first = set * ways;
+    size_t victim = first + ways;
+    Stripe &stripe = getStripe( set );
+
+    pthread_mutex_lock( &stripe.mutex );
+
+    for( size_t slot = first; slot < first + ways; slot++ )
+    {
+        if( tags[slot] == tag && matches( slot, x ) )
+        {
+            values[slot] = value;
+            pthread_mutex_unlock( &stripe.mutex );
+            return;
+        }
+
+        if( tags[slot] == 0 && victim == first + ways )
+        {
+            victim = slot;
+        }
+    }
+
+    if( victim == first + ways )
+    {
+        uint8_t &hand = hands[set];
+
+        while( referenced[first + hand] )
+        {
+            referenced[first + hand] = 0;
+            hand = ( hand + 1 ) % ways;
+        }
+
+        victim = first + hand;
+        hand = ( hand + 1 ) % ways;
+        stripe.evictions++;
+    }
+
+    for( size_t i = 0; i < dimension; i++ )
+    {
+        keys[victim * dimension + i] = quantize( x[i] );
+    }
+
+    values[victim] = value;
+    tags[victim] = tag;
+    referenced[victim] = 0;
+
+    pthread_mutex_unlock( &stripe.mutex );
+}
+
+/**
+    Removes all entries, the counters are kept.
+*/
+void FitnessCache::clear()
+{
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_lock( &stripes[i].mutex );
+    }
+
+    std::fill( tags.begin(), tags.end(), 0 );
+    std::fill( referenced.begin(), referenced.end(), 0 );
+    std::fill( hands.begin(), hands.end(), 0 );
+
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_unlock( &stripes[i].mutex );
+    }
+}
+
+void FitnessCache::resetCounters()
+{
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_lock( &stripes[i].mutex );
+        stripes[i].hits = 0;
+        stripes[i].misses = 0;
+        stripes[i].evictions = 0;
+        pthread_mutex_unlock( &stripes[i].mutex );
+    }
+}
+
+size_t FitnessCache::getDimension() const
+{
+    return dimension;
+}
+
+double FitnessCache::getTolerance() const
+{
+    return tolerance;
+}
+
+/**
+    Returns the maximum number of entries.
+*/
+size_t FitnessCache::getCapacity() const
+{
+    return num_sets * ways;
+}
+
+/**
+    Returns the number of entries.
+*/
+size_t FitnessCache::getSize()
+{
+    size_t size = 0;
+
+    for( size_t s = 0; s < stripes.size(); s++ )
+    {
+        pthread_mutex_lock( &stripes[s].mutex );
+
+        //the sets s, s + number of stripes, ... belong to stripe s
+        for( size_t set = s; set < num_sets; set += stripes.size() )
+        {
+            for( size_t slot = set * ways; slot < ( set + 1 ) * ways; slot++ )
+            {
+                size += tags[slot] != 0;
+            }
+        }
+
+        pthread_mutex_unlock( &stripes[s].mutex );
+    }
+
+    return size;
+}
+
+/**
+    Returns the memory of the table in bytes.
+*/
+size_t FitnessCache::getMemoryUsage() const
+{
+    return keys.size() * sizeof( int64_t ) + values.size() * sizeof( double ) + tags.size() * sizeof( uint64_t ) + referenced.size() + hands.size() +
+           stripes.size() * sizeof( Stripe );
+}
+
+uint64_t FitnessCache::getNumberOfHits()
+{
+    uint64_t num = 0;
+
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_lock( &stripes[i].mutex );
+        num += stripes[i].hits;
+        pthread_mutex_unlock( &stripes[i].mutex );
+    }
+
+    return num;
+}
+
+uint64_t FitnessCache::getNumberOfMisses()
+{
+    uint64_t num = 0;
+
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_lock( &stripes[i].mutex );
+        num += stripes[i].misses;
+        pthread_mutex_unlock( &stripes[i].mutex );
+    }
+
+    return num;
+}
+
+/**
+    Returns the number of entries which were replaced by a new position.
+*/
+uint64_t FitnessCache::getNumberOfEvictions()
+{
+    uint64_t num = 0;
+
+    for( size_t i = 0; i < stripes.size(); i++ )
+    {
+        pthread_mutex_lock( &stripes[i].mutex );
+        num += stripes[i].evictions;
+        pthread_mutex_unlock( &stripes[i].mutex );
+    }
+
+    return num;
+}
+
+/**
+    Rounds \a x to the nearest multiple of the tolerance. Coordinates which
+    do not fit into the grid, like infinite values, NaN or all coordinates
+    with a tolerance of zero, are represented by their bit pattern.
+*/
+int64_t FitnessCache::quantize( double x ) const
+{
+    if( tolerance > 0. )
+    {
+        double q = floor( x * inverse_tolerance + 0.5 );
+
+        if( q > -9.2e18 && q < 9.2e18 )
+        {
+            return static_cast<int64_t>( q );
+        }
+    }
+
+    if( x == 0. )
+    {
+        x = 0.;     //-0 and 0 share one entry
+    }
+
+    int64_t bits;
+    memcpy( &bits, &x, sizeof( bits ) );
+    return bits;
+}
+
+/**
+    Returns the hash of the quantized position of \a x, never zero.
+*/
+uint64_t FitnessCache::hash( const double *x ) const
+{
+    uint64_t h = dimension;
+
+    for( size_t i = 0; i < dimension; i++ )
+    {
+        h = mix( h ^ static_cast<uint64_t>( quantize( x[i] ) ) ) + i;
+    }
+
+    return h ? h : 1;
+}
+
+bool FitnessCache::matches( size_t slot, const double *x ) const
+{
+    const int64_t *key = &keys[slot * dimension];
+
+    for( size_t i = 0; i < dimension; i++ )
+    {
+        if( key[i] != quantize( x[i] ) ) {return false;}
+    }
+
+    return true;
+}
+
+FitnessCache::Stripe &FitnessCache::getStripe( size_t set )
+{
+    return stripes[set % stripes.size()];
+}
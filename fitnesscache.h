@@ -0,0 +1,217 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FITNESSCACHE_H
+#define FITNESSCACHE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "exception.h"
+#include "swarm.h"
+#include "vectorview.h"
+
+/**
+    Bounded cache of fitness values keyed by the position. Each coordinate is
+    rounded to a multiple of the tolerance, so positions which differ by less
+    than about half the tolerance share one entry. A tolerance of zero only
+    matches identical positions.
+
+    The table uses open addressing: the hash of a position selects a set of
+    \ref ways consecutive slots which are probed in order. If the set is full,
+    the CLOCK hand of the set evicts the first entry which was not hit since
+    the hand passed it last. New entries start unreferenced, so positions which
+    are seen only once are evicted before the ones that are hit again.
+
+    All functions are thread safe. The sets are protected by a fixed number of
+    striped locks, threads working on different sets rarely wait for each
+    other. The fitness itself is computed outside of the locks.
+*/
+class FitnessCache
+{
+    public:
+        static const size_t ways = 8;                                   //slots probed per lookup
+
+        FitnessCache( size_t dim, double tolerance_ = 0., size_t max_memory = 64 << 20 );
+        virtual ~FitnessCache();
+
+        bool lookup( const double *x, double &value );
+        void insert( const double *x, double value );
+        void clear();
+        void resetCounters();
+
+        size_t getDimension() const;
+        double getTolerance() const;
+        size_t getCapacity() const;
+        size_t getSize();
+        size_t getMemoryUsage() const;
+
+        uint64_t getNumberOfHits();
+        uint64_t getNumberOfMisses();
+        uint64_t getNumberOfEvictions();
+
+    private:
+        FitnessCache( const FitnessCache &other ) {}
+        FitnessCache &operator=( const FitnessCache &other ) {return *this;}
+
+        struct Stripe
+        {
+            pthread_mutex_t mutex;
+            uint64_t        hits;
+            uint64_t        misses;
+            uint64_t        evictions;
+            char            padding[64];                                //keeps the counters of two stripes on different cache lines
+        };
+
+        int64_t quantize( double x ) const;
+        uint64_t hash( const double *x ) const;
+        bool matches( size_t slot, const double *x ) const;
+        Stripe &getStripe( size_t set );
+
+        size_t                  dimension;
+        double                  tolerance;
+        double                  inverse_tolerance;
+        size_t                  num_sets;                               //power of two
+        std::vector<int64_t>    keys;                                   //quantized position of slot i at i * dimension
+        std::vector<double>     values;
+        std::vector<uint64_t>   tags;                                   //hash of the slot, zero if the slot is empty
+        std::vector<uint8_t>    referenced;                             //CLOCK bit of each slot
+        std::vector<uint8_t>    hands;                                  //CLOCK hand of each set
+        std::vector<Stripe>     stripes;
+};
+
+/**
+    Calls the evaluateBatch of \a func. Unlike a qualified call inside
+    \ref CachedFunction, the overloads of the wrapped Functor are found by
+    argument dependent lookup.
+*/
+template<typename Functor>
+inline void evaluateWrappedBatch( Functor &func, const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    evaluateBatch( func, positions, count, stride, dim, out );
+}
+
+/**
+    Functor for \ref Swarm which looks up the fitness in a \ref FitnessCache
+    before it evaluates the wrapped Functor. All copies share the cache, which
+    is owned by the caller and must live longer than the copies. Without a
+    cache every call is forwarded to the wrapped Functor.
+*/
+template<typename Functor>
+class CachedFunction
+{
+    public:
+        CachedFunction() : cache( NULL ) {}
+        CachedFunction( const Functor &func, FitnessCache *cache_ ) : function( func ), cache( cache_ ) {}
+
+        double operator()( const VectorView<double> &x )
+        {
+            if( !cache ) {return function( x );}
+
+            checkDimension( x.size() );
+
+            double value;
+
+            if( cache->lookup( x.getData(), value ) ) {return value;}
+
+            value = function( x );
+            cache->insert( x.getData(), value );
+            return value;
+        }
+
+        /**
+            Looks up all points and evaluates the misses with one call of the
+            evaluateBatch of the wrapped Functor.
+        */
+        void evaluateBatch( const double *positions, size_t count, size_t stride, size_t dim, double *out )
+        {
+            if( !cache )
+            {
+                evaluateWrappedBatch( function, positions, count, stride, dim, out );
+                return;
+            }
+
+            checkDimension( dim );
+            misses.clear();
+
+            for( size_t i = 0; i < count; i++ )
+            {
+                if( !cache->lookup( positions + i * stride, out[i] ) )
+                {
+                    misses.push_back( i );
+                }
+            }
+
+            if( misses.empty() ) {return;}
+
+            miss_positions.resize( misses.size() * dim );
+            miss_values.resize( misses.size() );
+
+            for( size_t i = 0; i < misses.size(); i++ )
+            {
+                const double *x = positions + misses[i] * stride;
+                std::copy( x, x + dim, &miss_positions[i * dim] );
+            }
+
+            evaluateWrappedBatch( function, &miss_positions[0], misses.size(), dim, dim, &miss_values[0] );
+
+            for( size_t i = 0; i < misses.size(); i++ )
+            {
+                out[misses[i]] = miss_values[i];
+                cache->insert( &miss_positions[i * dim], miss_values[i] );
+            }
+        }
+
+        Functor &getFunction()
+        {
+            return function;
+        }
+
+        FitnessCache *getCache() const
+        {
+            return cache;
+        }
+
+    protected:
+        void checkDimension( size_t dim )
+        {
+            if( dim != cache->getDimension() )
+            {
+                throw RuntimeError( "Error evaluating function: the dimension does not match the fitness cache!" );
+            }
+        }
+
+        Functor             function;
+        FitnessCache        *cache;
+        std::vector<size_t> misses;                 //scratch buffers of the batch evaluation
+        std::vector<double> miss_positions;
+        std::vector<double> miss_values;
+};
+
+template<typename Functor>
+inline void evaluateBatch( CachedFunction<Functor> &func, const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    func.evaluateBatch( positions, count, stride, dim, out );
+}
+
+#endif // FITNESSCACHE_H
@@ -17,35 +17,97 @@ You should have received a copy of the GNU General Public License
 along with pso. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
 #include "muParser.h"
+#include "benchmarkfunction.h"
+#include "bytecodevm.h"
+#include "expression.h"
+#include "expressionoptimizer.h"
 #include "function.h"
+#include "nativeexpression.h"
+
+/**
+    Immutable result of \ref Function::setExpression or \ref Function::setBenchmark,
+    shared by all copies of a Function. The reference count is changed with
+    atomic operations, therefore copies may be created and destroyed in
+    different threads. The evaluators stored here are only used as templates
+    for the evaluation context of each Function, except the NativeExpression
+    which has no state and is called directly.
+*/
+class Function::Program
+{
+    public:
+        Program() : num_variables( 0 ), backend( BACKEND_PARSER ), benchmark( NULL ), native( NULL ), vm( NULL ), num_operations_parsed( 0 ),
+            num_operations( 0 ), references( 1 ) {}
+
+        ~Program()
+        {
+            delete benchmark;
+            delete native;
+            delete vm;
+        }
+
+        void acquire()
+        {
+            __sync_add_and_fetch( &references, 1 );
+        }
+
+        void release()
+        {
+            if( __sync_sub_and_fetch( &references, 1 ) == 0 )
+            {
+                delete this;
+            }
+        }
 
-Function::Function() : parser( new mu::Parser )
+        std::string         expression;
+        std::string         parser_expression;      //optimized expression evaluated by muParser
+        size_t              num_variables;          //variables used by the expression
+        Backend             backend;                //backend the expression was compiled for
+        BenchmarkFunction   *benchmark;             //NULL if the expression is used
+        NativeExpression    *native;                //NULL if not compiled
+        BytecodeVM          *vm;                    //NULL if not lowered to bytecode
+        size_t              num_operations_parsed;
+        size_t              num_operations;         //after the optimization
+
+    private:
+        Program( const Program &other ) {}
+        Program &operator=( const Program &other ) {return *this;}
+
+        int                 references;
+};
+
+Function::Function() : program( NULL ), backend( BACKEND_PARSER ), parser( NULL ), vm( NULL ), benchmark( NULL ), bulk_size( 1 )
 {
 
 }
 
 /**
-    To copy the object it is enougth to use the same expression
-    then the object \a other.
+    The copy shares the compiled expression of \a other, only the evaluation
+    context is created again when the copy is evaluated the first time.
 
     \param[in] other
 */
-Function::Function( const Function &other ) : parser( new mu::Parser )
+Function::Function( const Function &other ) : program( NULL ), backend( other.backend ), parser( NULL ), vm( NULL ), benchmark( NULL ), bulk_size( 1 )
 {
-    setExpression( other.getExpression() );
+    setProgram( other.program );
 }
 
 Function &Function::operator=( const Function &other )
 {
-    delete parser;
-    parser = new mu::Parser;
-    setExpression( other.getExpression() );
+    if( this != &other )
+    {
+        backend = other.backend;
+        setProgram( other.program );
+    }
+
+    return *this;
 }
 
 Function::~Function()
 {
-    delete parser;
+    setProgram( NULL );
 }
 
 /**
@@ -58,15 +120,15 @@ Function::~Function()
 */
 void Function::setExpression( const std::string &expr )
 {
+    mu::Parser *checker = new mu::Parser;
+
     try
     {
-        clear();
-
-        parser->DefineFun<double( * )( double, double ) >( "pow", std::pow );
+        checker->DefineFun<double( * )( double, double ) >( "pow", std::pow );
 
-        parser->SetExpr( expr );
+        checker->SetExpr( expr );
 
-        mu::varmap_type used_variables = parser->GetUsedVar();
+        mu::varmap_type used_variables = checker->GetUsedVar();
 
         //Check if the variable names are correct set to x1, x2, x3, ...
         for( unsigned int i = 0; i < used_variables.size(); ++i )
@@ -90,27 +152,241 @@ void Function::setExpression( const std::string &expr )
             }
         }
 
-        variables.resize( used_variables.size() );
+        Program *compiled = new Program;
 
-        //map variables to the vector<double> variables
-        for( unsigned int i = 0; i < used_variables.size(); ++i )
+        try
         {
-            std::stringstream sstream;
-            sstream << "x" << i + 1;
+            compiled->expression = expr;
+            compiled->num_variables = used_variables.size();
+            compileExpression( *compiled );
+            setProgram( compiled );
+        }
+        catch( ... )
+        {
+            compiled->release();
+            throw;
+        }
 
-            std::string var_name( sstream.str() );
-            parser->DefineVar( var_name, &variables[i] );
+        compiled->release();
+
+        //the parser which checked the expression becomes the parser of this instance
+        if( compiled->parser_expression != expr )
+        {
+            checker->SetExpr( compiled->parser_expression );
         }
+
+        parser = checker;
+        checker = NULL;
+        defineVariables( 1 );
     }
     catch( mu::Parser::exception_type &e )
     {
+        delete checker;
         throw RuntimeError( e.GetMsg() );
     }
+    catch( ... )
+    {
+        delete checker;
+        throw;
+    }
+}
+
+/**
+    Maps the variables x1, x2, ... to the vector \a variables. Each variable gets
+    \a bulk_size_ consecutive elements, which is the layout expected by the bulk
+    mode of muParser. The single point evaluation uses the first element.
+
+    \param[in] bulk_size_
+*/
+void Function::defineVariables( size_t bulk_size_ )
+{
+    bulk_size = bulk_size_;
+    variables.assign( program->num_variables * bulk_size, 0. );
+
+    for( unsigned int i = 0; i < program->num_variables; ++i )
+    {
+        std::stringstream sstream;
+        sstream << "x" << i + 1;
+
+        std::string var_name( sstream.str() );
+        parser->DefineVar( var_name, &variables[i * bulk_size] );
+    }
 }
 
+/**
+    Parses the expression of \a program_, optimizes it with \ref ExpressionOptimizer
+    and translates the optimized form for the requested backend. If the backend
+    is not able to handle it, for example because no compiler is installed,
+    muParser is used without notice. muParser gets the optimized form as text,
+    or the original expression if the text would be much longer or muParser
+    rejects it.
+
+    \param[in,out] program_
+*/
+void Function::compileExpression( Program &program_ ) const
+{
+    program_.backend = backend;
+    program_.parser_expression = program_.expression;
+
+    try
+    {
+        Expression parsed, expression;
+        ExpressionOptimizer optimizer;
+        parsed.parse( program_.expression );
+        optimizer.optimize( parsed, expression );
+        program_.num_operations_parsed = optimizer.getNumberOfOperationsBefore();
+        program_.num_operations = optimizer.getNumberOfOperationsAfter();
+
+        if( expression.getNumberOfVariables() > program_.num_variables )
+        {
+            return;
+        }
+
+        //muParser gets the optimized form too, unless the shared nodes make the text too long
+        std::string text = expression.toString( 4 * program_.expression.size() + 64 );
+
+        if( !text.empty() && text != program_.expression )
+        {
+            //muParser parses on the first evaluation, a rewrite it rejects must be noticed here
+            try
+            {
+                mu::Parser checker;
+                checker.DefineFun<double( * )( double, double ) >( "pow", std::pow );
+                checker.SetExpr( text );
+                checker.GetUsedVar();
+                program_.parser_expression = text;
+            }
+            catch( mu::Parser::exception_type &e )
+            {
+            }
+        }
+
+        if( backend == BACKEND_PARSER )
+        {
+            return;
+        }
+
+        if( backend == BACKEND_NATIVE )
+        {
+            program_.native = new NativeExpression( expression );
+        }
+        else
+        {
+            program_.vm = new BytecodeVM( expression );
+        }
+    }
+    catch( Exception &err )
+    {
+        program_.native = NULL;
+        program_.vm = NULL;
+    }
+}
+
+/**
+    Replaces the shared program by \a program_, which may be NULL, and drops
+    the evaluation context of the old one.
+
+    \param[in] program_
+*/
+void Function::setProgram( Program *program_ )
+{
+    if( program_ )
+    {
+        program_->acquire();
+    }
+
+    if( program )
+    {
+        program->release();
+    }
+
+    program = program_;
+    resetContext();
+}
+
+void Function::resetContext()
+{
+    delete parser;
+    parser = NULL;
+    delete vm;
+    vm = NULL;
+    delete benchmark;
+    benchmark = NULL;
+    variables.clear();
+    bulk_size = 1;
+}
+
+/**
+    Returns the parser of this instance, which is created with the
+    expression of the program on the first call. The expression is parsed
+    again for each instance, because muParser can not share its parsed form
+    between different variable bindings.
+*/
+mu::Parser &Function::getParser()
+{
+    if( !parser )
+    {
+        try
+        {
+            parser = new mu::Parser;
+            parser->DefineFun<double( * )( double, double ) >( "pow", std::pow );
+            parser->SetExpr( program->parser_expression );
+            defineVariables( 1 );
+        }
+        catch( mu::Parser::exception_type &e )
+        {
+            throw RuntimeError( e.GetMsg() );
+        }
+    }
+
+    return *parser;
+}
+
+/**
+    Returns the bytecode of this instance, a copy of the one of the program
+    with its own registers.
+*/
+BytecodeVM &Function::getBytecodeVM()
+{
+    if( !vm )
+    {
+        vm = new BytecodeVM( *program->vm );
+    }
+
+    return *vm;
+}
+
+/**
+    Returns the copy of the benchmark function of this instance, the
+    benchmark function keeps the transformed point between two calls.
+*/
+BenchmarkFunction &Function::getBenchmarkFunction()
+{
+    if( !benchmark )
+    {
+        benchmark = new BenchmarkFunction( *program->benchmark );
+    }
+
+    return *benchmark;
+}
+
+/**
+    Returns the expression or the name of the benchmark function, see
+    \ref BenchmarkFunction::getName.
+*/
 std::string Function::getExpression() const
 {
-    return parser->GetExpr();
+    if( !program )
+    {
+        return std::string();
+    }
+
+    if( program->benchmark )
+    {
+        return program->benchmark->getName();
+    }
+
+    return program->expression;
 }
 
 /**
@@ -118,17 +394,128 @@ std::string Function::getExpression() const
 */
 std::size_t Function::getNumberOfVariablesInExpression() const
 {
-    return parser->GetUsedVar().size();
+    if( !program )
+    {
+        return 0;
+    }
+
+    if( program->benchmark )
+    {
+        return program->benchmark->getDimension();
+    }
+
+    return program->num_variables;
+}
+
+/**
+    Replaces the expression by a copy of the natively compiled function
+    \a bench, all evaluations are forwarded to it. A following call of
+    \ref setExpression switches back to the parser.
+
+    \param[in] bench
+*/
+void Function::setBenchmark( const BenchmarkFunction &bench )
+{
+    Program *compiled = new Program;
+    compiled->benchmark = new BenchmarkFunction( bench );
+    compiled->num_variables = bench.getDimension();
+    compiled->backend = backend;
+
+    setProgram( compiled );
+    compiled->release();
+}
+
+/**
+    Returns the benchmark function set by \ref setBenchmark or NULL if the
+    expression is used.
+*/
+const BenchmarkFunction *Function::getBenchmark() const
+{
+    return program ? program->benchmark : NULL;
 }
 
+/**
+    Selects the backend which evaluates the expression, the current
+    expression is translated again. Copies made before keep their backend.
+
+    \param[in] backend_
+*/
+void Function::setBackend( Backend backend_ )
+{
+    backend = backend_;
+
+    if( program && !program->benchmark && program->backend != backend )
+    {
+        Program *compiled = new Program;
+
+        try
+        {
+            compiled->expression = program->expression;
+            compiled->num_variables = program->num_variables;
+            compileExpression( *compiled );
+            setProgram( compiled );
+        }
+        catch( ... )
+        {
+            compiled->release();
+            throw;
+        }
+
+        compiled->release();
+    }
+}
+
+/**
+    Returns the number of operations of the parsed expression, zero for a
+    benchmark function or an expression which is only supported by muParser.
+*/
+size_t Function::getNumberOfParsedOperations() const
+{
+    return program ? program->num_operations_parsed : 0;
+}
+
+/**
+    Returns the number of operations after the optimization, which the
+    native and the bytecode backend evaluate.
+*/
+size_t Function::getNumberOfOperations() const
+{
+    return program ? program->num_operations : 0;
+}
+
+/**
+    Returns the backend selected by \ref setBackend.
+*/
+Function::Backend Function::getBackend() const
+{
+    return backend;
+}
+
+/**
+    Returns the backend which actually evaluates the expression, this is
+    BACKEND_PARSER if the selected backend was not able to translate it.
+*/
+Function::Backend Function::getActiveBackend() const
+{
+    if( program && program->native )
+    {
+        return BACKEND_NATIVE;
+    }
+
+    return program && program->vm ? BACKEND_VM : BACKEND_PARSER;
+}
+
+/**
+    Removes the expression, copies of this Function keep it.
+*/
 void Function::clear()
 {
-    parser->ClearVar();
+    setProgram( NULL );
 }
 
 bool Function::isEmpty()
 {
-    return parser->GetExpr().empty();
+    return !program;
 }
 
 /**
@@ -138,14 +525,54 @@ bool Function::isEmpty()
 */
 double Function::operator()( VectorN< double > &x )
 {
-    if( x.size() >= variables.size() )
+    return this->operator()( VectorView<double>( x.size() ? &x[0] : NULL, x.size() ) );
+}
+
+/**
+    Same as \ref operator()(VectorN<double>&) but evaluates the function at a
+    position provided as view, for example a row of the \ref ParticleStore.
+
+    \param[in] x
+*/
+double Function::operator()( const VectorView<double> &x )
+{
+    if( !program )
+    {
+        throw RuntimeError( "Error evaluating function: no expression is set!" );
+    }
+
+    if( program->benchmark )
     {
-        for( unsigned int i = 0; i < variables.size(); ++i )
+        return getBenchmarkFunction()( x );
+    }
+
+    if( x.size() >= program->num_variables )
+    {
+        if( program->native )
+        {
+            return program->native->evaluate( x.getData() );
+        }
+
+        if( program->vm )
+        {
+            return getBytecodeVM().evaluate( x.getData() );
+        }
+
+        mu::Parser &p = getParser();
+
+        for( unsigned int i = 0; i < program->num_variables; ++i )
         {
-            variables[i] = x[i];
+            variables[i * bulk_size] = x[i];
         }
 
-        return parser->Eval();
+        try
+        {
+            return p.Eval();
+        }
+        catch( mu::Parser::exception_type &e )
+        {
+            throw RuntimeError( e.GetMsg() );
+        }
     }
     else
     {
@@ -177,6 +604,79 @@ double Function::operator()( double x, double y, double z )
     return this->operator()( tmp_x );
 }
 
+/**
+    Evaluates the function at \a count points with one call of the muParser
+    bulk mode per \ref max_bulk_size points. The coordinates of point i start
+    at positions[i * stride], its result is written to out[i].
+
+    \param[in]  positions
+    \param[in]  count
+    \param[in]  stride    distance between two points, at least the number of variables
+    \param[out] out
+*/
+void Function::evaluateBatch( const double *positions, size_t count, size_t stride, double *out )
+{
+    if( !program )
+    {
+        throw RuntimeError( "Error evaluating function: no expression is set!" );
+    }
+
+    if( program->benchmark )
+    {
+        getBenchmarkFunction().evaluateBatch( positions, count, stride, out );
+        return;
+    }
+
+    if( stride < program->num_variables )
+    {
+        throw RuntimeError( "Error evaluating function: to few variables given in x!" );
+    }
+
+    if( program->native )
+    {
+        program->native->evaluateBatch( positions, count, stride, out );
+        return;
+    }
+
+    if( program->vm )
+    {
+        getBytecodeVM().evaluateBatch( positions, count, stride, out );
+        return;
+    }
+
+    try
+    {
+        getParser();
+
+        if( count > bulk_size )
+        {
+            defineVariables( max_bulk_size );
+        }
+
+        for( size_t offset = 0; offset < count; offset += bulk_size )
+        {
+            size_t n = std::min( bulk_size, count - offset );
+
+            //muParser expects one array per variable
+            for( size_t i = 0; i < program->num_variables; ++i )
+            {
+                double *variable = &variables[i * bulk_size];
+
+                for( size_t j = 0; j < n; ++j )
+                {
+                    variable[j] = positions[( offset + j ) * stride + i];
+                }
+            }
+
+            parser->Eval( out + offset, static_cast<int>( n ) );
+        }
+    }
+    catch( mu::Parser::exception_type &e )
+    {
+        throw RuntimeError( e.GetMsg() );
+    }
+}
+
 std::vector< std::string > split_string( const std::string &str, const std::string &split )
 {
     std::vector<std::string> result;
@@ -27,9 +27,28 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 #include <cmath>
 
 #include "vectorn.h"
+#include "vectorview.h"
 
 /**
-    This is a simple wrapper for the muParser library
+    This is a simple wrapper for the muParser library. Instead of an expression
+    a natively compiled \ref BenchmarkFunction can be set, which allows to use
+    it wherever a Function is expected, for example in the GUI.
+
+    The expression is always checked by muParser. With \ref setBackend it can
+    be evaluated by another backend instead, if this backend is not able to
+    handle the expression muParser is used, see \ref getActiveBackend. Every
+    backend evaluates the form optimized by \ref ExpressionOptimizer, muParser
+    gets it written back as text. muParser has no temporaries, therefore it
+    still computes a common subexpression at each use.
+
+    The checked and compiled expression is an immutable \ref Program which is
+    shared by all copies of a Function, so copying costs O(1). Each Function
+    only keeps the evaluation state which must not be shared between threads,
+    the parser with its variable bindings, the registers of the bytecode and
+    a copy of the benchmark function. This state is created on the first
+    evaluation. The native code and the bytecode are shared, muParser binds
+    the variables into its parsed form, so a copy evaluated by muParser
+    parses the expression again on its first evaluation.
 */
 
 namespace mu
@@ -37,9 +56,15 @@ namespace mu
     class Parser;
 }
 
+class BenchmarkFunction;
+class NativeExpression;
+class BytecodeVM;
+
 class Function
 {
     public:
+        enum Backend {BACKEND_PARSER, BACKEND_NATIVE, BACKEND_VM};
+
         Function();
         Function( const Function &other );
         virtual ~Function();
@@ -50,20 +75,68 @@ class Function
         std::string getExpression() const;
         std::size_t getNumberOfVariablesInExpression() const;
 
+        void setBenchmark( const BenchmarkFunction &bench );
+        const BenchmarkFunction *getBenchmark() const;
+
+        void setBackend( Backend backend_ );
+        Backend getBackend() const;
+        Backend getActiveBackend() const;
+
+        size_t getNumberOfParsedOperations() const;
+        size_t getNumberOfOperations() const;
+
         void clear();
         bool isEmpty();
 
         double operator()( VectorN<double> &x );
+        double operator()( const VectorView<double> &x );
         double operator()( double x );
         double operator()( double x, double y );
         double operator()( double x, double y, double z );
 
+        void evaluateBatch( const double *positions, size_t count, size_t stride, double *out );
+
         static std::string reduceListingToExpression( std::string listing );
+
+        static const size_t max_bulk_size = 1024; //number of points evaluated by one call of the muParser bulk mode
+
     protected:
+        class Program;
+
+        void setProgram( Program *program_ );
+        void resetContext();
+        void defineVariables( size_t bulk_size_ );
+        void compileExpression( Program &program_ ) const;
+
+        mu::Parser &getParser();
+        BytecodeVM &getBytecodeVM();
+        BenchmarkFunction &getBenchmarkFunction();
+
+        Program              *program;      //shared with the copies, NULL if empty
+        Backend              backend;       //requested backend
+
+        //evaluation context of this instance, created on demand from the program
         mu::Parser           *parser;
-        std::vector<double>  variables;
+        BytecodeVM           *vm;
+        BenchmarkFunction    *benchmark;
+        std::vector<double>  variables;     //variable i of point j is stored at variables[i * bulk_size + j]
+        size_t               bulk_size;
 };
 
+/**
+    Overload of the generic batch evaluation of \ref Swarm which uses the
+    bulk mode of \ref Function::evaluateBatch.
+*/
+inline void evaluateBatch( Function &func, const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    if( dim < func.getNumberOfVariablesInExpression() )
+    {
+        throw RuntimeError( "Error evaluating function: to few variables given in x!" );
+    }
+
+    func.evaluateBatch( positions, count, stride, out );
+}
+
 void FunctionTest();
 
 #endif // FUNCTION_H
@@ -18,6 +18,7 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "functionoptionswidget.h"
+#include "benchmarkfunction.h"
 
 FunctionOptionsWidget::FunctionOptionsWidget( MainWindow *mw, QWidget *parent, Qt::WindowFlags f ): QWidget( parent, f ), ui_mainwindow( mw )
 {
@@ -50,6 +51,44 @@ FunctionOptionsWidget::FunctionOptionsWidget( MainWindow *mw, QWidget *parent, Q
     ui_show_function_manager->setMaximumSize( 25, 25 );
     gridlayout_function->addWidget( ui_show_function_manager, 0, 3 );
 
+    gridlayout_function->addWidget( new QLabel( "Benchmark: " ), 1, 0 );
+    ui_benchmark_function = new QComboBox( this );
+    ui_benchmark_function->addItem( "Expression" );
+
+    for( int i = 0; i < BenchmarkFunction::NUMBER_OF_TYPES; i++ )
+    {
+        ui_benchmark_function->addItem( QString::fromStdString( BenchmarkFunction::getName( static_cast<BenchmarkFunction::Type>( i ) ) ) );
+    }
+
+    connect( ui_benchmark_function, SIGNAL( currentIndexChanged( int ) ), this, SLOT( changeBenchmarkFunction( int ) ) );
+    gridlayout_function->addWidget( ui_benchmark_function, 1, 1, 1, 3 );
+
+    {
+        QHBoxLayout *hlayout = new QHBoxLayout();
+        hlayout->addWidget( new QLabel( "Dimension: " ) );
+
+        ui_benchmark_dimension = new QSpinBox( this );
+        ui_benchmark_dimension->setRange( 1, 1000 );
+        ui_benchmark_dimension->setValue( 2 );
+        hlayout->addWidget( ui_benchmark_dimension );
+
+        ui_benchmark_shifted = new QCheckBox( "shifted", this );
+        hlayout->addWidget( ui_benchmark_shifted );
+
+        ui_benchmark_rotated = new QCheckBox( "rotated", this );
+        hlayout->addWidget( ui_benchmark_rotated );
+
+        gridlayout_function->addLayout( hlayout, 2, 1, 1, 3 );
+    }
+
+    gridlayout_function->addWidget( new QLabel( "Evaluation: " ), 3, 0 );
+    ui_backend = new QComboBox( this );
+    ui_backend->addItem( "Parser" );
+    ui_backend->addItem( "Native (compiled)" );
+    ui_backend->addItem( "Bytecode VM" );
+    ui_backend->setToolTip( "Compiles the expression with the system compiler, without compiler the parser is used" );
+    gridlayout_function->addWidget( ui_backend, 3, 1, 1, 3 );
+
     layout->addLayout( gridlayout_function );
 
     {
@@ -135,6 +174,8 @@ FunctionOptionsWidget::FunctionOptionsWidget( MainWindow *mw, QWidget *parent, Q
     ui_high_dim_range_view->setVisible( false );
     layout->addWidget( ui_high_dim_range_view );
 
+    changeBenchmarkFunction( 0 );
+
     ui_set_function = new QPushButton( "Set Function" );
     connect( ui_set_function, SIGNAL( clicked() ), this, SLOT( setFunction() ) );
     layout->addWidget( ui_set_function );
@@ -181,17 +222,74 @@ void FunctionOptionsWidget::changeFunctionRange()
     gl->updateGL();
 }
 
+/**
+    Enables the widgets of the expression or of the benchmark functions.
+    For a benchmark function the range is set to its usual search domain.
+
+    \param[in] index  zero for the expression, otherwise the \ref BenchmarkFunction::Type plus one
+*/
+void FunctionOptionsWidget::changeBenchmarkFunction( int index )
+{
+    bool expression = ( index <= 0 );
+
+    ui_current_expression->setEnabled( expression );
+    ui_show_function_editor->setEnabled( expression );
+    ui_show_function_manager->setEnabled( expression );
+    ui_benchmark_dimension->setEnabled( !expression && ui_mainwindow->getCurrentApplicationMode() != PSOMode3DView );
+    ui_benchmark_shifted->setEnabled( !expression );
+    ui_benchmark_rotated->setEnabled( !expression );
+    ui_backend->setEnabled( expression );
+
+    if( !expression )
+    {
+        double min, max;
+        BenchmarkFunction::getDomain( static_cast<BenchmarkFunction::Type>( index - 1 ), min, max );
+
+        ui_low_dim_range_xmin->setValue( min );
+        ui_low_dim_range_xmax->setValue( max );
+        ui_low_dim_range_xstep->setValue( ( max - min ) / 100. );
+        ui_low_dim_range_ymin->setValue( min );
+        ui_low_dim_range_ymax->setValue( max );
+        ui_low_dim_range_ystep->setValue( ( max - min ) / 100. );
+    }
+}
+
 /**
     The expression (function) is set corresponding to the application mode. In the case that the
     varriation mode is active it is possible to set function which depend on more more than 2 variables.
+    The benchmark functions are plotted with two variables in the 3D view.
 */
 void FunctionOptionsWidget::setFunction()
 {
     try
     {
         Function function;
+        int index = ui_benchmark_function->currentIndex();
+
+        if( index > 0 )
+        {
+            size_t dim = ui_mainwindow->getCurrentApplicationMode() == PSOMode3DView ? 2 : ui_benchmark_dimension->value();
+            BenchmarkFunction benchmark( static_cast<BenchmarkFunction::Type>( index - 1 ), dim );
+
+            if( ui_benchmark_shifted->isChecked() )
+            {
+                benchmark.setShift( 0 );
+            }
+
+            if( ui_benchmark_rotated->isChecked() )
+            {
+                benchmark.setRotation( 0 );
+            }
+
+            function.setBenchmark( benchmark );
+        }
+        else
+        {
 //         std::cout << Function::reduceListingToExpression( ui_current_expression->text().toStdString()) << std::endl;
-        function.setExpression( Function::reduceListingToExpression( ui_current_expression->text().toStdString() ) );
+            function.setBackend( static_cast<Function::Backend>( ui_backend->currentIndex() ) );
+            function.setExpression( Function::reduceListingToExpression( ui_current_expression->text().toStdString() ) );
+        }
+
         ui_mainwindow->getSwarm()->clear();
         ui_mainwindow->getSwarm()->setDimension( function.getNumberOfVariablesInExpression() );
         ui_mainwindow->getSwarm()->setFunction( function );
@@ -202,6 +300,12 @@ void FunctionOptionsWidget::setFunction()
             ui_mainwindow->getGLWidget()->setFunction( function );
             ui_mainwindow->getGLWidget()->updateGL();
         }
+        else if( index > 0 )
+        {
+            double min, max;
+            BenchmarkFunction::getDomain( static_cast<BenchmarkFunction::Type>( index - 1 ), min, max );
+            fillRangeTable( function.getNumberOfVariablesInExpression(), min, max );
+        }
         else
         {
             fillRangeTable( function.getNumberOfVariablesInExpression() );
@@ -267,6 +371,8 @@ void FunctionOptionsWidget::changeApplicationMode( PSOMode mode )
         ui_container_groupbox->setVisible( false );
         ui_high_dim_range_view->setVisible( true );
     }
+
+    ui_benchmark_dimension->setEnabled( ui_benchmark_function->currentIndex() > 0 && mode != PSOMode3DView );
 }
 
 void FunctionOptionsWidget::modelitemChanged( QStandardItem *item )
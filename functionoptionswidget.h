@@ -28,7 +28,8 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 /**
     Widget to edit/manage/load expressions (functions). It is also possible
     to change the range in which the function is plotted. The selected expression
-    is also used for the swarm optimization.
+    is also used for the swarm optimization. Instead of an expression one of
+    the natively compiled \ref BenchmarkFunction can be selected.
 */
 class FunctionOptionsWidget : public QWidget
 {
@@ -45,6 +46,7 @@ class FunctionOptionsWidget : public QWidget
         void showFunctionManagerDialog();
         void changeFunctionRange();
         void setFunction();
+        void changeBenchmarkFunction( int index );
 
         void modelitemChanged( QStandardItem *item );
         void fillRangeTable( size_t num, double dmin = -5.0, double dmax = 5.0 );
@@ -56,6 +58,11 @@ class FunctionOptionsWidget : public QWidget
 
         QPushButton         *ui_set_function;
         QLineEdit           *ui_current_expression;
+        QComboBox           *ui_benchmark_function;     //first item selects the expression
+        QSpinBox            *ui_benchmark_dimension;
+        QCheckBox           *ui_benchmark_shifted;
+        QCheckBox           *ui_benchmark_rotated;
+        QComboBox           *ui_backend;                //index is the Function::Backend
         QTableView          *ui_high_dim_range_view;
         QStandardItemModel  *ui_high_dim_range_itemmodel;
         QGroupBox           *ui_container_groupbox;
@@ -288,23 +288,23 @@ void FunctionViewer::drawMiniMap()
         //show best global particle on minimap
         if( mini_map_mark_global_best && ( swarm && swarm_show ) )
         {
-            Particle *p = swarm->getBestParticle();
+            Particle p = swarm->getBestParticle();
 
-            if( p )
+            if( p.isValid() )
             {
                 glBegin( GL_LINES );
                 glColor3f( 1, 1, 1 );
 
-                if( p->getBestPosition()[1] >= function_plot_range_y[0] &&  p->getBestPosition()[1] <= function_plot_range_y[1] )
+                if( p.getBestPosition()[1] >= function_plot_range_y[0] &&  p.getBestPosition()[1] <= function_plot_range_y[1] )
                 {
-                    glVertex2f( 0. + x_min, p->getBestPosition()[1] );
-                    glVertex2f( x_length + x_min, p->getBestPosition()[1] );
+                    glVertex2f( 0. + x_min, p.getBestPosition()[1] );
+                    glVertex2f( x_length + x_min, p.getBestPosition()[1] );
                 }
 
-                if( p->getBestPosition()[0] >= function_plot_range_x[0] &&  p->getBestPosition()[0] <= function_plot_range_x[1] )
+                if( p.getBestPosition()[0] >= function_plot_range_x[0] &&  p.getBestPosition()[0] <= function_plot_range_x[1] )
                 {
-                    glVertex2f( p->getBestPosition()[0], y_length + y_min );
-                    glVertex2f( p->getBestPosition()[0], 0. + y_min );
+                    glVertex2f( p.getBestPosition()[0], y_length + y_min );
+                    glVertex2f( p.getBestPosition()[0], 0. + y_min );
                 }
 
                 glEnd();
@@ -614,38 +614,73 @@ void FunctionViewer::regenerateFunction()
 }
 
 /**
-    Evaluates \a function at the position \a x and \a y. It is
-    a simple wrapper for the operator() of \a function.
-
-    \param[in] x
-    \param[in] y
+    Evaluates \a function on the whole plot grid with one call of
+    \ref Function::evaluateBatch and updates the min and max function values.
+    The grid contains one additional point behind the plot range in each
+    direction, because the quads of the OpenGL lists use the next grid point.
+    Returns false if the evaluation failed, in that case all samples are zero.
 */
-double FunctionViewer::evaluate( double x, double y )
+bool FunctionViewer::sampleFunction()
 {
-    double result;
+    sample_x.clear();
+    sample_y.clear();
 
-    if( !function.isEmpty() )
+    //the coordinates are accumulated in the same way as in the loops of genereateOpenglLists
+    double x = function_plot_range_x[0], y = function_plot_range_y[0];
+
+    for( ; x < function_plot_range_x[1]; x += function_plot_range_x[2] )
     {
-        try
-        {
-            result = function( x, y );
-        }
-        catch( RuntimeError &err )
+        sample_x.push_back( x );
+    }
+
+    for( ; y < function_plot_range_y[1]; y += function_plot_range_y[2] )
+    {
+        sample_y.push_back( y );
+    }
+
+    sample_x.push_back( x );
+    sample_y.push_back( y );
+
+    std::vector<double> points( sample_x.size() * sample_y.size() * 2 );
+
+    for( size_t i = 0; i < sample_x.size(); i++ )
+    {
+        for( size_t j = 0; j < sample_y.size(); j++ )
         {
-            QString line;
-            line.setNum( err.getLine() );
-            QMessageBox::warning( this, QString( "Error" ), QString::fromStdString( err.getFile() ) + QString( ":" ) + line + QString( "\n" ) + QString::fromStdString( err.getMessage() ) );
-            function.clear();
+            points[( i * sample_y.size() + j ) * 2] = sample_x[i];
+            points[( i * sample_y.size() + j ) * 2 + 1] = sample_y[j];
         }
+    }
+
+    sample_values.assign( sample_x.size() * sample_y.size(), 0. );
 
-        if( function_min_value > result ) {function_min_value = result;}
+    try
+    {
+        function.evaluateBatch( &points[0], sample_values.size(), 2, &sample_values[0] );
+    }
+    catch( RuntimeError &err )
+    {
+        QString line;
+        line.setNum( err.getLine() );
+        QMessageBox::warning( this, QString( "Error" ), QString::fromStdString( err.getFile() ) + QString( ":" ) + line + QString( "\n" ) + QString::fromStdString( err.getMessage() ) );
+        function.clear();
+        sample_values.assign( sample_values.size(), 0. );
+        return false;
+    }
 
-        if( function_max_value < result ) {function_max_value = result;}
+    for( size_t i = 0; i < sample_values.size(); i++ )
+    {
+        if( function_min_value > sample_values[i] ) {function_min_value = sample_values[i];}
 
-        return result;
+        if( function_max_value < sample_values[i] ) {function_max_value = sample_values[i];}
     }
 
-    return 0.0;
+    return true;
+}
+
+inline double FunctionViewer::getSample( size_t i, size_t j ) const
+{
+    return sample_values[i * sample_y.size() + j];
 }
 
 /**
@@ -739,12 +774,14 @@ void FunctionViewer::drawSwarm( bool draw_on_minimap )
         {
             if( mark_global_best_3d )
             {
-                if( swarm->getBestParticle() )
+                Particle best = swarm->getBestParticle();
+
+                if( best.isValid() )
                 {
                     static GLUquadricObj *quadratic = gluNewQuadric();
 
                     glPushMatrix();
-                    glTranslated( swarm->getBestParticle()->getBestPosition()[0], swarm->getBestParticle()->getBestPosition()[1], swarm->getBestParticle()->getBestValue() + 1.0 );
+                    glTranslated( best.getBestPosition()[0], best.getBestPosition()[1], best.getBestValue() + 1.0 );
                     gluCylinder( quadratic, 0.0, 0.15, 0.4, 32, 32 );
                     glTranslated( 0.0, 0.0, 0.4 );
                     gluCylinder( quadratic, 0.075, 0.075, 0.7, 32, 32 );
@@ -772,22 +809,25 @@ void FunctionViewer::drawSwarm( bool draw_on_minimap )
 
         glBegin( GL_POINTS );
 
-        Swarm<Function>::particle_container::iterator begin = swarm->m_swarm.begin(), end = swarm->m_swarm.end();
+        Swarm<Function>::particle_container &particles = swarm->m_swarm;
+        const double *current_values = particles.getCurrentValues();
 
-        for( Swarm<Function>::particle_container::iterator it( begin ); it != end; it++ )
+        for( size_t i = 0; i < particles.size(); i++ )
         {
+            const double *position = particles.getPosition( i );
+
             if( draw_on_minimap )
             {
                 glColor3f( swarm_point_color[0], swarm_point_color[1], swarm_point_color[2] );
 
-                if( ( *it )->getPosition()[0] >= function_plot_range_x[0] && ( *it )->getPosition()[0] <= function_plot_range_x[1] && ( *it )->getPosition()[1] >= function_plot_range_y[0] && ( *it )->getPosition()[1] <= function_plot_range_y[1] )
+                if( position[0] >= function_plot_range_x[0] && position[0] <= function_plot_range_x[1] && position[1] >= function_plot_range_y[0] && position[1] <= function_plot_range_y[1] )
                 {
-                    glVertex2f( ( *it )->getPosition()[0], ( *it )->getPosition()[1] );
+                    glVertex2f( position[0], position[1] );
                 }
             }
             else
             {
-                glVertex3f( ( *it )->getPosition()[0], ( *it )->getPosition()[1], ( *it )->getCurrentValue() + 0.2 );
+                glVertex3f( position[0], position[1], current_values[i] + 0.2 );
             }
         }
 
@@ -811,56 +851,39 @@ void FunctionViewer::genereateOpenglLists()
         opengl_lists.second = glGenLists( 2 );
 
         /*
-            For finding the min and max function value see evaluate(x,y) for more information. The min and max value
+            For finding the min and max function value see sampleFunction() for more information. The min and max value
             is needed to scale the actual function value to a number between zero and one. This is neede to compute
             the right color for a specific point.
         */
-        for( double x = function_plot_range_x[0]; x < function_plot_range_x[1]; x += function_plot_range_x[2] )
-        {
-            for( double y = function_plot_range_y[0]; y < function_plot_range_y[1]; y += function_plot_range_y[2] )
-            {
-                evaluate( x, y );
-            }
-        }
+        sampleFunction();
+
+        size_t nx = 0, ny = 0;
+
+        while( nx + 1 < sample_x.size() && sample_x[nx] < ( function_plot_range_x[1] - function_plot_range_x[2] ) ) {nx++;}
+
+        while( ny + 1 < sample_y.size() && sample_y[ny] < ( function_plot_range_y[1] - function_plot_range_y[2] ) ) {ny++;}
 
         //generates list for the function
         glNewList( opengl_lists.second, GL_COMPILE );
         {
+            //corners of a quad in the order of drawing
+            const size_t corner_x[4] = {0, 1, 1, 0}, corner_y[4] = {0, 0, 1, 1};
             double r, g, b, functionvalue;
-            double x_tmp, y_tmp;
 
-            for( double x = function_plot_range_x[0]; x < ( function_plot_range_x[1] - function_plot_range_x[2] ); x += function_plot_range_x[2] )
+            for( size_t i = 0; i < nx; i++ )
             {
-                for( double y = function_plot_range_y[0]; y < ( function_plot_range_y[1] - function_plot_range_y[2] ); y += function_plot_range_y[2] )
+                for( size_t j = 0; j < ny; j++ )
                 {
                     glBegin( GL_QUADS );
-                    x_tmp = x;
-                    y_tmp = y;
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex3f( x_tmp, y_tmp, functionvalue );
-
-                    x_tmp = x + function_plot_range_x[2];
-                    y_tmp = y;
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex3f( x_tmp, y_tmp, functionvalue );
-
-                    x_tmp = x + function_plot_range_x[2];
-                    y_tmp = y + function_plot_range_y[2];
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex3f( x_tmp, y_tmp, functionvalue );
-
-                    x_tmp = x;
-                    y_tmp = y + function_plot_range_y[2];
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex3f( x_tmp, y_tmp, functionvalue );
+
+                    for( size_t k = 0; k < 4; k++ )
+                    {
+                        size_t di = corner_x[k], dj = corner_y[k];
+                        functionvalue = getSample( i + di, j + dj );
+                        calculateColor( functionvalue, r, g, b );
+                        glColor3f( r, g, b );
+                        glVertex3f( sample_x[i + di], sample_y[j + dj], functionvalue );
+                    }
 
                     glEnd();
                 }
@@ -871,47 +894,31 @@ void FunctionViewer::genereateOpenglLists()
         //generates list for the minimap
         glNewList( opengl_lists.second + 1, GL_COMPILE );
         {
+            //corners of a quad in the order of drawing
+            const size_t corner_x[4] = {0, 1, 1, 0}, corner_y[4] = {0, 0, 1, 1};
             double r, g, b, functionvalue;
-            double x_tmp, y_tmp;
 
-            for( double x = function_plot_range_x[0]; x < ( function_plot_range_x[1] - function_plot_range_x[2] ); x += function_plot_range_x[2] )
+            for( size_t i = 0; i < nx; i++ )
             {
-                for( double y = function_plot_range_y[0]; y < ( function_plot_range_y[1] - function_plot_range_y[2] ); y += function_plot_range_y[2] )
+                for( size_t j = 0; j < ny; j++ )
                 {
                     glBegin( GL_QUADS );
-                    x_tmp = x;
-                    y_tmp = y;
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex2f( x_tmp, y_tmp );
-
-                    x_tmp = x + function_plot_range_x[2];
-                    y_tmp = y;
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex2f( x_tmp, y_tmp );
-
-                    x_tmp = x + function_plot_range_x[2];
-                    y_tmp = y + function_plot_range_y[2];
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex2f( x_tmp, y_tmp );
-
-                    x_tmp = x;
-                    y_tmp = y + function_plot_range_y[2];
-                    functionvalue = evaluate( x_tmp, y_tmp );
-                    calculateColor( functionvalue, r, g, b );
-                    glColor3f( r, g, b );
-                    glVertex2f( x_tmp, y_tmp );
+
+                    for( size_t k = 0; k < 4; k++ )
+                    {
+                        size_t di = corner_x[k], dj = corner_y[k];
+                        functionvalue = getSample( i + di, j + dj );
+                        calculateColor( functionvalue, r, g, b );
+                        glColor3f( r, g, b );
+                        glVertex2f( sample_x[i + di], sample_y[j + dj] );
+                    }
 
                     glEnd();
                 }
             }
         }
         glEndList();
+
         opengl_lists.first = GLLIST_DEFINED;
     }
 }
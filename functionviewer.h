@@ -120,7 +120,8 @@ class FunctionViewer : public QGLWidget
         void mouseReleaseEvent( QMouseEvent *event );
 
         void calculateColor( double value, double &r, double &g, double &b );
-        double evaluate( double x, double y );
+        bool sampleFunction();
+        double getSample( size_t i, size_t j ) const;
         void calculateMiniMapLengths( double &x_length_, double &y_length_ );
 
         Vector<double>              viewport_translate;
@@ -151,6 +152,10 @@ class FunctionViewer : public QGLWidget
         Function                    function;
         std::pair<TListsState, GLuint>   opengl_lists;
 
+        std::vector<double>         sample_x;                       //grid on which the function is sampled for the OpenGL lists
+        std::vector<double>         sample_y;
+        std::vector<double>         sample_values;                  //value at (sample_x[i], sample_y[j]) is stored at [i * sample_y.size() + j]
+
         bool                        swarm_show;
         Swarm<Function>             *swarm;
 
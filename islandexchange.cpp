@@ -0,0 +1,357 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "islandexchange.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+IslandExchange::IslandExchange( size_t num_islands_, size_t dim, size_t capacity_ ) :
+    num_islands( num_islands_ ),
+    dimension( dim ),
+    capacity( capacity_ ),
+    best_size( roundUp( sizeof( BestRecord ) ) + roundUp( dim * sizeof( double ) ) ),
+    result_size( roundUp( sizeof( Result ) ) ),
+    mailbox_size( 2 * cache_line + roundUp( capacity_ * ( dim + 1 ) * sizeof( double ) ) ),
+    memory( best_size + num_islands_ * result_size + num_islands_ * num_islands_ * mailbox_size )
+{
+    reset();
+}
+
+/**
+    Removes all migrants, the global best and the results. Must only be called
+    while no worker process is running.
+*/
+void IslandExchange::reset()
+{
+    memset( memory.getData(), 0, memory.getSize() );
+    getBestRecord()->island = -1;
+}
+
+/**
+    Appends a migrant to the mailbox from island \a from to island \a to.
+    Returns false and drops the migrant if the mailbox is full. Must only be
+    called by the process of island \a from.
+*/
+bool IslandExchange::send( size_t from, size_t to, const double *position, double value )
+{
+    char *mailbox = getMailbox( from, to );
+    uint64_t *read_count = reinterpret_cast<uint64_t *>( mailbox );
+    uint64_t *write_count = reinterpret_cast<uint64_t *>( mailbox + cache_line );
+    double *slots = reinterpret_cast<double *>( mailbox + 2 * cache_line );
+
+    uint64_t write = *write_count;
+    uint64_t read = __atomic_load_n( read_count, __ATOMIC_ACQUIRE );
+
+    if( capacity == 0 || write - read >= capacity )
+    {
+        return false;
+    }
+
+    double *slot = slots + ( write % capacity ) * ( dimension + 1 );
+    memcpy( slot, position, dimension * sizeof( double ) );
+    slot[dimension] = value;
+
+    __atomic_store_n( write_count, write + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+    Takes the oldest migrant from the mailbox from island \a from to island
+    \a to. Returns false if the mailbox is empty. Must only be called by the
+    process of island \a to.
+*/
+bool IslandExchange::receive( size_t from, size_t to, double *position, double &value )
+{
+    char *mailbox = getMailbox( from, to );
+    uint64_t *read_count = reinterpret_cast<uint64_t *>( mailbox );
+    uint64_t *write_count = reinterpret_cast<uint64_t *>( mailbox + cache_line );
+    const double *slots = reinterpret_cast<const double *>( mailbox + 2 * cache_line );
+
+    uint64_t read = *read_count;
+    uint64_t write = __atomic_load_n( write_count, __ATOMIC_ACQUIRE );
+
+    if( read == write )
+    {
+        return false;
+    }
+
+    const double *slot = slots + ( read % capacity ) * ( dimension + 1 );
+    memcpy( position, slot, dimension * sizeof( double ) );
+    value = slot[dimension];
+
+    __atomic_store_n( read_count, read + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+    Replaces the global best record if \a value is better with respect to
+    \a compare or if no record was published yet. Returns true if the record
+    was replaced.
+
+    \param[in] island
+    \param[in] position    \ref getDimension values
+    \param[in] value
+    \param[in] compare
+*/
+bool IslandExchange::publishBest( size_t island, const double *position, double value, bool ( *compare )( double, double ) )
+{
+    BestRecord *record = getBestRecord();
+    double *best_position = getBestPosition();
+    uint32_t sequence = lockBest();
+
+    bool replace = record->island < 0 || ( *compare )( value, record->value );
+
+    if( replace )
+    {
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            __atomic_store( best_position + i, const_cast<double *>( position + i ), __ATOMIC_RELAXED );
+        }
+
+        __atomic_store( &record->value, &value, __ATOMIC_RELAXED );
+        __atomic_store_n( &record->island, static_cast<int32_t>( island ), __ATOMIC_RELAXED );
+    }
+
+    //releases the write lock: odd -> even
+    __atomic_store_n( &record->sequence, sequence + 1, __ATOMIC_RELEASE );
+    __atomic_store_n( &record->owner, 0, __ATOMIC_RELEASE );
+    return replace;
+}
+
+/**
+    Copies the global best record. Returns false if no island has published
+    a record yet. Can be called by any process at any time.
+
+    \param[out] position   \ref getDimension values
+    \param[out] value
+    \param[out] island     island which has published the record
+*/
+bool IslandExchange::readBest( double *position, double &value, long &island ) const
+{
+    BestRecord *record = getBestRecord();
+    const double *best_position = getBestPosition();
+    uint32_t begin, end;
+    int32_t record_island;
+    size_t spins = 0;
+
+    do
+    {
+        begin = __atomic_load_n( &record->sequence, __ATOMIC_ACQUIRE );
+
+        if( begin % 2 != 0 )
+        {
+            //the owner may have died while it was writing
+            if( ++spins % recovery_spins == 0 )
+            {
+                recoverBest( __atomic_load_n( &record->owner, __ATOMIC_ACQUIRE ) );
+                sched_yield();
+            }
+
+            end = begin + 1;
+            continue;
+        }
+
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            __atomic_load( const_cast<double *>( best_position + i ), position + i, __ATOMIC_RELAXED );
+        }
+
+        __atomic_load( &record->value, &value, __ATOMIC_RELAXED );
+        record_island = __atomic_load_n( &record->island, __ATOMIC_RELAXED );
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        end = __atomic_load_n( &record->sequence, __ATOMIC_RELAXED );
+    }
+    while( begin != end );
+
+    island = record_island;
+    return record_island >= 0;
+}
+
+/**
+    Stores the result of an island, called by the island before its process
+    exits. The result is only reported by \ref getResult if this function was
+    called, so a crashed island can be detected.
+*/
+void IslandExchange::setResult( size_t island, size_t iterations, size_t migrants_accepted )
+{
+    Result *result = getResult( island );
+    result->iterations = iterations;
+    result->migrants_accepted = migrants_accepted;
+    __atomic_store_n( &result->finished, 1, __ATOMIC_RELEASE );
+}
+
+bool IslandExchange::getResult( size_t island, size_t &iterations, size_t &migrants_accepted ) const
+{
+    Result *result = getResult( island );
+
+    if( !__atomic_load_n( &result->finished, __ATOMIC_ACQUIRE ) )
+    {
+        return false;
+    }
+
+    iterations = result->iterations;
+    migrants_accepted = result->migrants_accepted;
+    return true;
+}
+
+size_t IslandExchange::getNumberOfIslands() const
+{
+    return num_islands;
+}
+
+size_t IslandExchange::getDimension() const
+{
+    return dimension;
+}
+
+size_t IslandExchange::getCapacity() const
+{
+    return capacity;
+}
+
+/**
+    Takes the write lock of the global best and returns the odd sequence
+    number of the write. If the previous owner died while it was writing,
+    the record is marked as empty.
+*/
+uint32_t IslandExchange::lockBest() const
+{
+    BestRecord *record = getBestRecord();
+    int32_t self = static_cast<int32_t>( getpid() );
+
+    for( size_t spins = 1; ; spins++ )
+    {
+        int32_t owner = 0;
+
+        if( __atomic_compare_exchange_n( &record->owner, &owner, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+        {
+            break;
+        }
+
+        if( spins % recovery_spins == 0 )
+        {
+            recoverBest( owner );
+            sched_yield();
+        }
+    }
+
+    uint32_t sequence = __atomic_load_n( &record->sequence, __ATOMIC_RELAXED );
+
+    //an odd number is only left by a dead owner, the write continues with it
+    if( sequence % 2 == 0 )
+    {
+        sequence++;
+        __atomic_store_n( &record->sequence, sequence, __ATOMIC_RELAXED );
+    }
+    else
+    {
+        __atomic_store_n( &record->island, -1, __ATOMIC_RELAXED );
+    }
+
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    return sequence;
+}
+
+/**
+    Releases the write lock of the global best if it is still held by the
+    dead process \a owner. A record which was only partly written is marked
+    as empty. Returns true if the lock was released.
+*/
+bool IslandExchange::recoverBest( int32_t owner ) const
+{
+    if( owner == 0 || isProcessAlive( owner ) ) {return false;}
+
+    BestRecord *record = getBestRecord();
+    int32_t self = static_cast<int32_t>( getpid() );
+
+    if( !__atomic_compare_exchange_n( &record->owner, &owner, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) )
+    {
+        return false;
+    }
+
+    uint32_t sequence = __atomic_load_n( &record->sequence, __ATOMIC_RELAXED );
+
+    if( sequence % 2 != 0 )
+    {
+        __atomic_store_n( &record->island, -1, __ATOMIC_RELAXED );
+        __atomic_store_n( &record->sequence, sequence + 1, __ATOMIC_RELEASE );
+    }
+
+    __atomic_store_n( &record->owner, 0, __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+    Returns false if the process \a pid does not exist or is a zombie, which
+    has exited but was not waited for by its parent yet.
+*/
+bool IslandExchange::isProcessAlive( int32_t pid )
+{
+    if( kill( pid, 0 ) != 0 && errno == ESRCH ) {return false;}
+
+    char filename[64];
+    snprintf( filename, sizeof( filename ), "/proc/%d/stat", static_cast<int>( pid ) );
+    FILE *file = fopen( filename, "r" );
+
+    if( !file ) {return true;}
+
+    //the state follows the command name in parentheses, which may contain spaces
+    char line[512];
+    bool alive = true;
+
+    if( fgets( line, sizeof( line ), file ) )
+    {
+        const char *state = strrchr( line, ')' );
+        alive = !( state && state[1] == ' ' && ( state[2] == 'Z' || state[2] == 'X' ) );
+    }
+
+    fclose( file );
+    return alive;
+}
+
+size_t IslandExchange::roundUp( size_t size )
+{
+    return ( size + cache_line - 1 ) / cache_line * cache_line;
+}
+
+char *IslandExchange::getMailbox( size_t from, size_t to ) const
+{
+    return static_cast<char *>( memory.getData() ) + best_size + num_islands * result_size + ( from * num_islands + to ) * mailbox_size;
+}
+
+IslandExchange::BestRecord *IslandExchange::getBestRecord() const
+{
+    return static_cast<BestRecord *>( memory.getData() );
+}
+
+double *IslandExchange::getBestPosition() const
+{
+    return reinterpret_cast<double *>( static_cast<char *>( memory.getData() ) + roundUp( sizeof( BestRecord ) ) );
+}
+
+IslandExchange::Result *IslandExchange::getResult( size_t island ) const
+{
+    return reinterpret_cast<Result *>( static_cast<char *>( memory.getData() ) + best_size + island * result_size );
+}
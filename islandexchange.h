@@ -0,0 +1,114 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ISLANDEXCHANGE_H
+#define ISLANDEXCHANGE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "sharedmemory.h"
+
+/**
+    Data shared between the processes of a \ref ProcessIslandSwarm. Everything
+    lives in one \ref SharedMemory segment which is created before the worker
+    processes are forked, therefore no pointers are stored in the segment.
+
+    The segment contains
+    - a mailbox for each ordered pair of islands: a lock free single producer
+      single consumer queue like \ref Mailbox, the read and write counters are
+      published with acquire/release atomics,
+    - the global best record of all islands, protected by a seqlock: a writer
+      stores its pid in the owner field with a compare and swap, so several
+      processes may publish, and takes the sequence number from even to odd
+      while it copies the record. Readers retry until they have seen the same
+      even sequence number before and after copying the record,
+    - a result record for each island which is written by the island before its
+      process exits.
+
+    No lock is held across anything but the copy of the global best, and a
+    migrant for a dead island is simply dropped when its mailbox is full. A
+    process which dies while it owns the global best is detected by the
+    processes waiting for it: after a while they check whether the owner is
+    still alive and take over the lock. A record which was only partly written
+    is dropped, the islands publish their best again at the next migration.
+*/
+class IslandExchange
+{
+    public:
+        IslandExchange( size_t num_islands_, size_t dim, size_t capacity_ );
+
+        void reset();
+
+        bool send( size_t from, size_t to, const double *position, double value );
+        bool receive( size_t from, size_t to, double *position, double &value );
+
+        bool publishBest( size_t island, const double *position, double value, bool ( *compare )( double, double ) );
+        bool readBest( double *position, double &value, long &island ) const;
+
+        void setResult( size_t island, size_t iterations, size_t migrants_accepted );
+        bool getResult( size_t island, size_t &iterations, size_t &migrants_accepted ) const;
+
+        size_t getNumberOfIslands() const;
+        size_t getDimension() const;
+        size_t getCapacity() const;
+
+    protected:
+        static const size_t cache_line = 64;
+
+        static const size_t recovery_spins = 1024;      //failed attempts before the owner of the global best is checked
+
+        struct BestRecord
+        {
+            uint32_t    sequence;           //odd while a process writes the record
+            int32_t     island;             //-1 until the first record is published
+            int32_t     owner;              //pid of the process which writes the record, zero if none
+            double      value;
+        };
+
+        struct Result
+        {
+            uint64_t    iterations;
+            uint64_t    migrants_accepted;
+            uint32_t    finished;
+        };
+
+        static size_t roundUp( size_t size );
+        static bool isProcessAlive( int32_t pid );
+
+        uint32_t lockBest() const;
+        bool recoverBest( int32_t owner ) const;
+
+        char *getMailbox( size_t from, size_t to ) const;
+        BestRecord *getBestRecord() const;
+        double *getBestPosition() const;
+        Result *getResult( size_t island ) const;
+
+        size_t          num_islands;
+        size_t          dimension;
+        size_t          capacity;
+
+        size_t          best_size;          //record and position
+        size_t          result_size;
+        size_t          mailbox_size;       //read counter, write counter and slots
+
+        SharedMemory    memory;
+};
+
+#endif // ISLANDEXCHANGE_H
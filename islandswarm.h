@@ -0,0 +1,378 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ISLANDSWARM_H
+#define ISLANDSWARM_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mailbox.h"
+#include "philoxrandom.h"
+#include "swarm.h"
+#include "threadpool.h"
+
+/**
+    Island model: several independent swarms (islands) are optimized at the
+    same time, each one in its own thread. Every \ref setMigrationInterval
+    iterations an island sends a copy of its global best particle to the
+    islands given by the migration topology and takes the particles it
+    received in the meantime, each of them replaces the worst particle of the
+    island if it is better, see \ref Swarm::insertMigrant.
+
+    Each pair of islands has its own lock free \ref Mailbox, therefore the
+    islands never wait for each other. A migrant is dropped if the mailbox
+    of the receiving island is full.
+*/
+template<typename Functor, size_t Dim = Dynamic>
+class IslandSwarm
+{
+    public:
+        typedef Swarm<Functor, Dim> island_type;
+        enum MigrationTopology {MIGRATION_RING, MIGRATION_FULL, MIGRATION_RANDOM};
+
+        /**
+            \param[in] num_islands  number of islands and threads, zero for the number of online processors
+            \param[in] dim
+        */
+        IslandSwarm( size_t num_islands = 0, size_t dim = ( Dim == Dynamic ? 2 : Dim ) ) : dimension( dim ), thread_pool( NULL )
+        {
+            if( num_islands == 0 )
+            {
+                num_islands = ThreadPool::getNumberOfCPUs();
+            }
+
+            for( size_t i = 0; i < num_islands; i++ )
+            {
+                islands.push_back( new island_type( dim ) );
+            }
+
+            migration_interval = 10;
+            migration_topology = MIGRATION_RING;
+            mailboxes.resize( num_islands * num_islands );
+            setMailboxCapacity( 4 );
+            setRandomSeed( 0 );
+
+            thread_pool = new ThreadPool( num_islands );
+        }
+
+        virtual ~IslandSwarm()
+        {
+            delete thread_pool;
+
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                delete islands[i];
+            }
+        }
+
+        size_t getNumberOfIslands()
+        {
+            return islands.size();
+        }
+
+        /**
+            Gives access to a single island, for example to set parameters
+            which are not forwarded by the IslandSwarm. Must not be used while
+            \ref optimize is running.
+        */
+        island_type &getIsland( size_t i )
+        {
+            return *islands[i];
+        }
+
+        void setFunction( const Functor &func )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setFunction( func );
+            }
+        }
+
+        void setCompare( bool comp )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setCompare( comp );
+            }
+        }
+
+        void setCheckAbortCriterion( bool c )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setCheckAbortCriterion( c );
+            }
+        }
+
+        /**
+            Each island gets its own seed derived from \a seed.
+
+            \param[in] seed
+        */
+        void setRandomSeed( uint64_t seed )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setRandomSeed( seed + i * 0x9E3779B97F4A7C15ULL );
+            }
+
+            random_generator.setSeed( seed );
+        }
+
+        /**
+            Sets the number of iterations between two migrations, zero disables the migration.
+        */
+        void setMigrationInterval( size_t interval )
+        {
+            migration_interval = interval;
+        }
+
+        size_t getMigrationInterval()
+        {
+            return migration_interval;
+        }
+
+        /**
+            MIGRATION_RING sends the migrant to the next island, MIGRATION_FULL
+            to all other islands and MIGRATION_RANDOM to one randomly chosen island.
+        */
+        void setMigrationTopology( MigrationTopology topology )
+        {
+            migration_topology = topology;
+        }
+
+        MigrationTopology getMigrationTopology()
+        {
+            return migration_topology;
+        }
+
+        /**
+            Sets the number of migrants which can wait in the mailbox of one pair
+            of islands. All waiting migrants are removed.
+        */
+        void setMailboxCapacity( size_t capacity )
+        {
+            for( size_t i = 0; i < mailboxes.size(); i++ )
+            {
+                mailboxes[i].resize( capacity, dimension );
+            }
+        }
+
+        /**
+            Creates \a num particles on each island, see \ref Swarm::createSwarm.
+        */
+        void createSwarm( int num, const VectorN<double> &min, const VectorN<double> &max, bool random = true )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->createSwarm( num, min, max, random );
+            }
+
+            setMailboxCapacity( mailboxes.empty() ? 0 : mailboxes[0].getCapacity() );
+        }
+
+        /**
+            Runs all islands in parallel until each island has reached \a max_iterations
+            or its abort criterion. Returns the largest number of iterations of an island.
+
+            \param[in] max_iterations
+        */
+        size_t optimize( size_t max_iterations = 10000 )
+        {
+            jobs.resize( islands.size() );
+
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                jobs[i].island_swarm = this;
+                jobs[i].island = i;
+                jobs[i].max_iterations = max_iterations;
+                jobs[i].iterations = 0;
+                jobs[i].migrants_accepted = 0;
+                thread_pool->enqueue( &jobs[i] );
+            }
+
+            thread_pool->wait();
+
+            size_t iterations = 0;
+
+            for( size_t i = 0; i < jobs.size(); i++ )
+            {
+                iterations = std::max( iterations, jobs[i].iterations );
+            }
+
+            return iterations;
+        }
+
+        /**
+            Returns the island with the best global best.
+        */
+        size_t getBestIsland()
+        {
+            size_t best = 0;
+
+            for( size_t i = 1; i < islands.size(); i++ )
+            {
+                if( islands[i]->getBestParticle().isValid() &&
+                        ( !islands[best]->getBestParticle().isValid() || islands[i]->isBetter( islands[i]->getBestFitness(), islands[best]->getBestFitness() ) ) )
+                {
+                    best = i;
+                }
+            }
+
+            return best;
+        }
+
+        double getBestFitness()
+        {
+            return islands.empty() ? 0. : islands[getBestIsland()]->getBestFitness();
+        }
+
+        Particle getBestParticle()
+        {
+            return islands.empty() ? Particle() : islands[getBestIsland()]->getBestParticle();
+        }
+
+        /**
+            Returns the number of migrants which replaced a particle during the last \ref optimize.
+        */
+        size_t getNumberOfMigrations()
+        {
+            size_t num = 0;
+
+            for( size_t i = 0; i < jobs.size(); i++ )
+            {
+                num += jobs[i].migrants_accepted;
+            }
+
+            return num;
+        }
+
+    protected:
+        class IslandJob : public ThreadPool::Job
+        {
+            public:
+                IslandJob() : island_swarm( NULL ), island( 0 ), max_iterations( 0 ), iterations( 0 ), migrants_accepted( 0 ) {}
+
+                void run( size_t thread_id )
+                {
+                    island_swarm->runIsland( *this );
+                }
+
+                IslandSwarm *island_swarm;
+                size_t      island;
+                size_t      max_iterations;
+                size_t      iterations;
+                size_t      migrants_accepted;
+        };
+
+        /**
+            Optimization loop of one island. Only the island itself and the
+            mailboxes from and to this island are accessed.
+        */
+        void runIsland( IslandJob &job )
+        {
+            island_type &island = *islands[job.island];
+            std::vector<double> position( dimension );
+            double value;
+
+            while( job.iterations < job.max_iterations )
+            {
+                if( island.getCheckAbortCriterion() && island.checkAbortCriterion() )
+                {
+                    break;
+                }
+
+                island.computeNextStep();
+                job.iterations++;
+
+                if( migration_interval == 0 || job.iterations % migration_interval != 0 )
+                {
+                    continue;
+                }
+
+                sendMigrant( job.island, job.iterations / migration_interval );
+
+                for( size_t from = 0; from < islands.size(); from++ )
+                {
+                    while( from != job.island && getMailbox( from, job.island ).receive( &position[0], value ) )
+                    {
+                        if( island.insertMigrant( &position[0], value ) )
+                        {
+                            job.migrants_accepted++;
+                        }
+                    }
+                }
+            }
+        }
+
+        void sendMigrant( size_t from, size_t migration )
+        {
+            Particle best = islands[from]->getBestParticle();
+            size_t num = islands.size();
+
+            if( !best.isValid() || num < 2 ) {return;}
+
+            const double *position = best.getBestPosition().getData();
+
+            switch( migration_topology )
+            {
+                case MIGRATION_RING:
+                    getMailbox( from, ( from + 1 ) % num ).send( position, best.getBestValue() );
+                    break;
+
+                case MIGRATION_FULL:
+                    for( size_t to = 0; to < num; to++ )
+                    {
+                        if( to != from )
+                        {
+                            getMailbox( from, to ).send( position, best.getBestValue() );
+                        }
+                    }
+
+                    break;
+
+                case MIGRATION_RANDOM:
+                {
+                    double r = random_generator.getRandomNumber( from, migration, PhiloxRandom::STREAM_TOPOLOGY, 0 );
+                    size_t to = ( from + 1 + static_cast<size_t>( r * ( num - 1 ) ) ) % num;
+                    getMailbox( from, to ).send( position, best.getBestValue() );
+                }
+                break;
+            }
+        }
+
+        Mailbox &getMailbox( size_t from, size_t to )
+        {
+            return mailboxes[from * islands.size() + to];
+        }
+
+        size_t                      dimension;
+        std::vector<island_type *>  islands;
+        std::vector<Mailbox>        mailboxes;          //mailbox from island i to island j at i * number of islands + j
+        std::vector<IslandJob>      jobs;
+        ThreadPool                  *thread_pool;
+        PhiloxRandom                random_generator;
+        size_t                      migration_interval;
+        MigrationTopology           migration_topology;
+};
+
+#endif // ISLANDSWARM_H
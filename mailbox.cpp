@@ -0,0 +1,117 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mailbox.h"
+
+#include <string.h>
+
+Mailbox::Mailbox( size_t capacity_, size_t dim ) : capacity( 0 ), dimension( 0 ), dropped( 0 ), read_count( 0 ), write_count( 0 )
+{
+    resize( capacity_, dim );
+}
+
+/**
+    Sets the number of messages the mailbox can hold and the dimension of the
+    positions. All queued messages are removed. This function is not thread
+    safe, it must only be called while no thread uses the mailbox.
+
+    \param[in] capacity_
+    \param[in] dim
+*/
+void Mailbox::resize( size_t capacity_, size_t dim )
+{
+    capacity = capacity_;
+    dimension = dim;
+    slots.assign( capacity * ( dimension + 1 ), 0. );
+    dropped = 0;
+    read_count = 0;
+    write_count = 0;
+}
+
+/**
+    Appends a message. Returns false and drops the message if the mailbox is full.
+    Must only be called by the producer thread.
+
+    \param[in] position    \ref getDimension values
+    \param[in] value
+*/
+bool Mailbox::send( const double *position, double value )
+{
+    size_t write = write_count;
+    size_t read = __atomic_load_n( &read_count, __ATOMIC_ACQUIRE );
+
+    if( capacity == 0 || write - read >= capacity )
+    {
+        dropped++;
+        return false;
+    }
+
+    double *slot = &slots[( write % capacity ) * ( dimension + 1 )];
+    memcpy( slot, position, dimension * sizeof( double ) );
+    slot[dimension] = value;
+
+    //publishes the slot to the consumer
+    __atomic_store_n( &write_count, write + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+    Takes the oldest message. Returns false if the mailbox is empty. Must only
+    be called by the consumer thread.
+
+    \param[out] position   \ref getDimension values
+    \param[out] value
+*/
+bool Mailbox::receive( double *position, double &value )
+{
+    size_t read = read_count;
+    size_t write = __atomic_load_n( &write_count, __ATOMIC_ACQUIRE );
+
+    if( read == write )
+    {
+        return false;
+    }
+
+    const double *slot = &slots[( read % capacity ) * ( dimension + 1 )];
+    memcpy( position, slot, dimension * sizeof( double ) );
+    value = slot[dimension];
+
+    //releases the slot to the producer
+    __atomic_store_n( &read_count, read + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+size_t Mailbox::getCapacity() const
+{
+    return capacity;
+}
+
+size_t Mailbox::getDimension() const
+{
+    return dimension;
+}
+
+/**
+    Returns the number of messages dropped because the mailbox was full.
+    Only reliable in the producer thread or after the threads have finished.
+*/
+size_t Mailbox::getNumberOfDropped() const
+{
+    return dropped;
+}
@@ -0,0 +1,66 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stdlib.h>
+
+#include <vector>
+
+/**
+    Lock free single producer single consumer queue for migrating particles
+    between islands, see \ref IslandSwarm. A message consists of a position
+    and its fitness value. Exactly one thread may call \ref send and exactly
+    one thread may call \ref receive, neither of them ever blocks: if the
+    queue is full the message is dropped.
+
+    The read and write counters are kept on separate cache lines, so the
+    producer and the consumer do not invalidate each others cache line.
+*/
+class Mailbox
+{
+    public:
+        Mailbox( size_t capacity_ = 4, size_t dim = 0 );
+
+        void resize( size_t capacity_, size_t dim );
+
+        bool send( const double *position, double value );
+        bool receive( double *position, double &value );
+
+        size_t getCapacity() const;
+        size_t getDimension() const;
+        size_t getNumberOfDropped() const;
+
+    protected:
+        static const size_t cache_line = 64;
+
+        std::vector<double> slots;          //capacity * ( dimension + 1 ), the value is stored behind the position
+        size_t              capacity;
+        size_t              dimension;
+        size_t              dropped;        //only written by the producer
+
+        char                padding_read[cache_line];
+        size_t              read_count;     //only written by the consumer
+        char                padding_write[cache_line];
+        size_t              write_count;    //only written by the producer
+        char                padding_end[cache_line];
+};
+
+#endif // MAILBOX_H
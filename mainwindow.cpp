@@ -248,10 +248,12 @@ void  MainWindow::timerTimeOut()
 
                     ui_swarm_control->showUsedIterations( swarm.getIterationStep() );
 
-                    if( swarm.getBestParticle() )
+                    Particle best = swarm.getBestParticle();
+
+                    if( best.isValid() )
                     {
-                        ui_swarm_control->showBestPartileFitness( swarm.getBestParticle()->getBestValue() );
-                        ui_swarm_control->showCurrentBestFoundPosition( swarm.getBestParticle()->getBestPosition()[0], swarm.getBestParticle()->getBestPosition()[1] );
+                        ui_swarm_control->showBestPartileFitness( best.getBestValue() );
+                        ui_swarm_control->showCurrentBestFoundPosition( best.getBestPosition()[0], best.getBestPosition()[1] );
                     }
 
                     if( ui_swarm_control->isAutoVelocityUsed() )
@@ -571,12 +573,12 @@ void MainWindow::computeNextStep()
                 trace_particle_container.resize( swarm.m_swarm.size() );
             }
 
-            unsigned int i = 0;
-            Swarm<Function>::particle_container::iterator begin = swarm.m_swarm.begin(), end = swarm.m_swarm.end();
+            const double *current_values = swarm.m_swarm.getCurrentValues();
 
-            for( Swarm<Function>::particle_container::iterator it( begin ); it != end; it++, i++ )
+            for( size_t i = 0; i < swarm.m_swarm.size(); i++ )
             {
-                trace_particle_container[i].push_back( Vector<double>( ( *it )->getPosition()[0], ( *it )->getPosition()[1], ( *it )->getCurrentValue() + 0.2 ) );
+                const double *position = swarm.m_swarm.getPosition( i );
+                trace_particle_container[i].push_back( Vector<double>( position[0], position[1], current_values[i] + 0.2 ) );
             }
         }
     }
@@ -591,12 +593,12 @@ void MainWindow::computeNextStep()
             trace_particle_container.resize( swarm.m_swarm.size() );
         }
 
-        unsigned int i = 0;
-        Swarm<Function>::particle_container::iterator begin = swarm.m_swarm.begin(), end = swarm.m_swarm.end();
+        const double *current_values = swarm.m_swarm.getCurrentValues();
 
-        for( Swarm<Function>::particle_container::iterator it( begin ); it != end; it++, i++ )
+        for( size_t i = 0; i < swarm.m_swarm.size(); i++ )
         {
-            trace_particle_container[i].push_back( Vector<double>( ( *it )->getPosition()[0], ( *it )->getPosition()[1], ( *it )->getCurrentValue() + 0.2 ) );
+            const double *position = swarm.m_swarm.getPosition( i );
+            trace_particle_container[i].push_back( Vector<double>( position[0], position[1], current_values[i] + 0.2 ) );
         }
     }
 }
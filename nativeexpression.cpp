@@ -0,0 +1,463 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "nativeexpression.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <fstream>
+#include <locale>
+#include <sstream>
+#include <vector>
+
+#include "exception.h"
+#include "subprocess.h"
+
+namespace
+{
+    const char *compiler_flags = "-O2 -fPIC -shared";
+
+    uint64_t hashString( const std::string &str )
+    {
+        uint64_t hash = 14695981039346656037ULL;
+
+        for( size_t i = 0; i < str.size(); i++ )
+        {
+            hash ^= static_cast<unsigned char>( str[i] );
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    std::string formatConstant( double value )
+    {
+        if( isnan( value ) )
+        {
+            return "NAN";
+        }
+
+        if( isinf( value ) )
+        {
+            return value > 0. ? "HUGE_VAL" : "(-HUGE_VAL)";
+        }
+
+        //the C compiler needs a decimal point, whatever LC_NUMERIC the GUI has set
+        std::ostringstream sstream;
+        sstream.imbue( std::locale::classic() );
+        sstream.precision( 17 );
+        sstream << value;
+        std::string str = sstream.str();
+
+        //otherwise 5/2 would be an integer division
+        if( str.find_first_of( ".e" ) == std::string::npos )
+        {
+            str += ".0";
+        }
+
+        return value < 0. ? "(" + str + ")" : str;
+    }
+
+    std::string quote( const std::string &str )
+    {
+        std::string result = "'";
+
+        for( size_t i = 0; i < str.size(); i++ )
+        {
+            result += ( str[i] == '\'' ? std::string( "'\\''" ) : std::string( 1, str[i] ) );
+        }
+
+        return result + "'";
+    }
+
+    void makeDirectories( const std::string &path )
+    {
+        for( size_t pos = path.find( '/', 1 ); ; pos = path.find( '/', pos + 1 ) )
+        {
+            std::string directory = path.substr( 0, pos );
+
+            if( mkdir( directory.c_str(), 0700 ) != 0 && errno != EEXIST )
+            {
+                throw RuntimeError( "Unable to create the directory " + directory + ": " + strerror( errno ) );
+            }
+
+            if( pos == std::string::npos ) {break;}
+        }
+    }
+}
+
+/**
+    Compiles \a expr or loads it from the cache.
+
+    \param[in] expr
+*/
+NativeExpression::NativeExpression( const Expression &expr ) : handle( NULL ), evaluate_function( NULL ), batch_function( NULL ), num_variables( expr.getNumberOfVariables() )
+{
+    std::string body = generateBody( expr );
+    std::string source = generateSource( expr );
+    std::string compiler = getCompiler();
+    std::string command = compiler + " " + compiler_flags;
+    std::string version = getCompilerVersion( compiler );
+
+    char name[64];
+    snprintf( name, sizeof( name ), "/pso-%016llx.so", static_cast<unsigned long long>( hashString( command + "\n" + version + "\n" + source ) ) );
+
+    std::string directory = getCacheDirectory();
+    library_path = directory + name;
+
+    //the libraries in the directory are executed, so nobody else must be able to place one there
+    makeDirectories( directory );
+    checkOwnership( directory, true );
+
+    if( !load( library_path, body ) )
+    {
+        compile( source, command, library_path );
+
+        if( !load( library_path, body ) )
+        {
+            throw RuntimeError( "Unable to load the compiled expression " + library_path );
+        }
+    }
+}
+
+NativeExpression::~NativeExpression()
+{
+    if( handle )
+    {
+        dlclose( handle );
+    }
+}
+
+size_t NativeExpression::getNumberOfVariables() const
+{
+    return num_variables;
+}
+
+/**
+    Returns the shared object which contains the compiled expression.
+*/
+const std::string &NativeExpression::getLibraryPath() const
+{
+    return library_path;
+}
+
+/**
+    Returns the C source of \a expr. It defines the functions pso_evaluate,
+    which evaluates one point x, and pso_evaluate_batch with the arguments
+    of \ref evaluateBatch.
+*/
+std::string NativeExpression::generateSource( const Expression &expr )
+{
+    std::string body = generateBody( expr );
+    std::stringstream source;
+
+    source << "#include <math.h>\n\n"
+           << "const char pso_expression[] = \"";
+
+    for( size_t i = 0; i < body.size(); i++ )
+    {
+        source << ( body[i] == '\n' ? std::string( "\\n" ) : std::string( 1, body[i] ) );
+    }
+
+    source << "\";\n\n"
+           << "static double pso_sign( double v ) {return v > 0.0 ? 1.0 : ( v < 0.0 ? -1.0 : 0.0 );}\n\n"
+           << "static double pso_point( const double *x )\n{\n" << body << "}\n\n"
+           << "double pso_evaluate( const double *x )\n{\n    return pso_point( x );\n}\n\n"
+           << "void pso_evaluate_batch( const double *positions, unsigned long count, unsigned long stride, double *out )\n{\n"
+           << "    unsigned long i;\n\n"
+           << "    for( i = 0; i < count; i++ )\n    {\n        out[i] = pso_point( positions + i * stride );\n    }\n}\n";
+
+    return source.str();
+}
+
+/**
+    Returns the compiler command, the environment variable PSO_CC or cc.
+*/
+std::string NativeExpression::getCompiler()
+{
+    const char *cc = getenv( "PSO_CC" );
+    return cc && *cc ? cc : "cc";
+}
+
+std::string NativeExpression::getCacheDirectory()
+{
+    const char *dir = getenv( "PSO_JIT_CACHE" );
+
+    if( dir && *dir )
+    {
+        return dir;
+    }
+
+    if( ( dir = getenv( "XDG_CACHE_HOME" ) ) && *dir )
+    {
+        return std::string( dir ) + "/pso-jit";
+    }
+
+    if( ( dir = getenv( "HOME" ) ) && *dir )
+    {
+        return std::string( dir ) + "/.cache/pso-jit";
+    }
+
+    std::stringstream sstream;
+    sstream << "/tmp/pso-jit-" << getuid();
+    return sstream.str();
+}
+
+/**
+    Returns the output of \a compiler --version, which identifies the compiler
+    in the name of the cached libraries. The output is only requested once
+    per compiler and process.
+*/
+std::string NativeExpression::getCompilerVersion( const std::string &compiler )
+{
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    static std::string cached_compiler;
+    static std::string cached_version;
+
+    pthread_mutex_lock( &mutex );
+
+    if( cached_compiler != compiler || cached_version.empty() )
+    {
+        try
+        {
+            cached_version = Subprocess::execute( compiler + " --version 2>&1" );
+            cached_compiler = compiler;
+        }
+        catch( ... )
+        {
+            pthread_mutex_unlock( &mutex );
+            throw;
+        }
+    }
+
+    std::string version = cached_version;
+    pthread_mutex_unlock( &mutex );
+    return version;
+}
+
+/**
+    Throws a RuntimeError unless \a path is a directory, respectively a
+    regular file, which is not a symbolic link, is owned by the user and can
+    not be written by the group or others.
+*/
+void NativeExpression::checkOwnership( const std::string &path, bool directory )
+{
+    struct stat info;
+
+    if( lstat( path.c_str(), &info ) != 0 )
+    {
+        throw RuntimeError( "Unable to check " + path + ": " + strerror( errno ) );
+    }
+
+    if( directory ? !S_ISDIR( info.st_mode ) : !S_ISREG( info.st_mode ) )
+    {
+        throw RuntimeError( "Refusing to use " + path + ": not a " + ( directory ? "directory" : "regular file" ) );
+    }
+
+    if( info.st_uid != geteuid() || ( info.st_mode & ( S_IWGRP | S_IWOTH ) ) != 0 )
+    {
+        throw RuntimeError( "Refusing to use " + path + ": it is owned or writable by another user" );
+    }
+}
+
+/**
+    Returns the statements of the function pso_point: every node except the
+    constants and variables gets a temporary, the compiler removes the ones
+    which are not needed. Only nodes which contribute to the root are emitted.
+*/
+std::string NativeExpression::generateBody( const Expression &expr )
+{
+    size_t num = expr.getNumberOfNodes();
+    std::vector<std::string> names( num );
+    std::vector<bool> used( num, false );
+    std::stringstream body;
+
+    if( num == 0 )
+    {
+        throw RuntimeError( "Unable to compile an empty expression" );
+    }
+
+    used[expr.getRoot()] = true;
+
+    for( size_t i = num; i-- > 0; )
+    {
+        if( !used[i] ) {continue;}
+
+        const Expression::Node &node = expr.getNode( i );
+
+        for( size_t j = 0; j < Expression::getNumberOfArguments( node.opcode ); j++ )
+        {
+            used[node.args[j]] = true;
+        }
+    }
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        if( !used[i] ) {continue;}
+
+        const Expression::Node &node = expr.getNode( i );
+        std::stringstream name;
+
+        if( node.opcode == Expression::OP_CONSTANT )
+        {
+            names[i] = formatConstant( node.value );
+            continue;
+        }
+
+        if( node.opcode == Expression::OP_VARIABLE )
+        {
+            name << "x[" << node.variable << "]";
+            names[i] = name.str();
+            continue;
+        }
+
+        const std::string &a = names[node.args[0]];
+        const std::string &b = names[node.args[1]];
+        const std::string &c = names[node.args[2]];
+        std::string value;
+
+        switch( node.opcode )
+        {
+            case Expression::OP_NEGATE:         value = "-" + a; break;
+            case Expression::OP_ADD:            value = a + " + " + b; break;
+            case Expression::OP_SUBTRACT:       value = a + " - " + b; break;
+            case Expression::OP_MULTIPLY:       value = a + " * " + b; break;
+            case Expression::OP_DIVIDE:         value = a + " / " + b; break;
+            case Expression::OP_POWER:          value = "pow( " + a + ", " + b + " )"; break;
+            case Expression::OP_LESS:           value = a + " < " + b + " ? 1.0 : 0.0"; break;
+            case Expression::OP_GREATER:        value = a + " > " + b + " ? 1.0 : 0.0"; break;
+            case Expression::OP_LESS_EQUAL:     value = a + " <= " + b + " ? 1.0 : 0.0"; break;
+            case Expression::OP_GREATER_EQUAL:  value = a + " >= " + b + " ? 1.0 : 0.0"; break;
+            case Expression::OP_EQUAL:          value = a + " == " + b + " ? 1.0 : 0.0"; break;
+            case Expression::OP_NOT_EQUAL:      value = a + " != " + b + " ? 1.0 : 0.0"; break;
+            case Expression::OP_AND:            value = a + " != 0.0 && " + b + " != 0.0 ? 1.0 : 0.0"; break;
+            case Expression::OP_OR:             value = a + " != 0.0 || " + b + " != 0.0 ? 1.0 : 0.0"; break;
+            case Expression::OP_IF:             value = a + " != 0.0 ? " + b + " : " + c; break;
+            case Expression::OP_LOG:            value = "log( " + a + " )"; break;
+            case Expression::OP_ABS:            value = "fabs( " + a + " )"; break;
+            case Expression::OP_SIGN:           value = "pso_sign( " + a + " )"; break;
+            case Expression::OP_RINT:           value = "floor( " + a + " + 0.5 )"; break;
+            case Expression::OP_MIN:            value = b + " < " + a + " ? " + b + " : " + a; break;
+            case Expression::OP_MAX:            value = a + " < " + b + " ? " + b + " : " + a; break;
+            default:                            value = std::string( Expression::getName( node.opcode ) ) + "( " + a + " )"; break;
+        }
+
+        name << "t" << i;
+        names[i] = name.str();
+        body << "    const double " << names[i] << " = " << value << ";\n";
+    }
+
+    body << "    return " << names[expr.getRoot()] << ";\n";
+    return body.str();
+}
+
+/**
+    Loads the shared object \a path and checks that it contains \a body.
+    Returns false if the file does not exist or belongs to another source.
+    Throws a RuntimeError if the file could have been placed by another
+    user, because dlopen already runs its constructors.
+*/
+bool NativeExpression::load( const std::string &path, const std::string &body )
+{
+    if( access( path.c_str(), F_OK ) != 0 )
+    {
+        return false;
+    }
+
+    checkOwnership( path, false );
+
+    void *library = dlopen( path.c_str(), RTLD_NOW | RTLD_LOCAL );
+
+    if( !library )
+    {
+        return false;
+    }
+
+    const char *stored = static_cast<const char *>( dlsym( library, "pso_expression" ) );
+    void *evaluate_symbol = dlsym( library, "pso_evaluate" );
+    void *batch_symbol = dlsym( library, "pso_evaluate_batch" );
+
+    if( !stored || !evaluate_symbol || !batch_symbol || body != stored )
+    {
+        dlclose( library );
+        return false;
+    }
+
+    if( handle )
+    {
+        dlclose( handle );
+    }
+
+    handle = library;
+    evaluate_function = reinterpret_cast<EvaluateFunction>( evaluate_symbol );
+    batch_function = reinterpret_cast<BatchFunction>( batch_symbol );
+    return true;
+}
+
+/**
+    Writes \a source next to \a path and compiles it. The shared object is
+    built under a temporary name and renamed afterwards, therefore several
+    processes can compile the same expression at the same time.
+*/
+void NativeExpression::compile( const std::string &source, const std::string &command, const std::string &path )
+{
+    static int counter = 0;
+
+    std::stringstream tmp;
+    tmp << path << "." << getpid() << "." << __sync_fetch_and_add( &counter, 1 );
+    std::string source_path = tmp.str() + ".c";
+    std::string library_tmp = tmp.str() + ".so";
+
+    {
+        std::ofstream file( source_path.c_str() );
+        file << source;
+
+        if( !file )
+        {
+            throw RuntimeError( "Unable to write " + source_path );
+        }
+    }
+
+    std::string output = Subprocess::execute( command + " -o " + quote( library_tmp ) + " " + quote( source_path ) + " -lm 2>&1" );
+    unlink( source_path.c_str() );
+
+    if( access( library_tmp.c_str(), R_OK ) != 0 )
+    {
+        throw RuntimeError( "Unable to compile the expression: " + output );
+    }
+
+    //independent of the umask, the library must pass checkOwnership when it is loaded
+    chmod( library_tmp.c_str(), 0700 );
+
+    if( rename( library_tmp.c_str(), path.c_str() ) != 0 )
+    {
+        unlink( library_tmp.c_str() );
+        throw RuntimeError( "Unable to rename " + library_tmp + ": " + strerror( errno ) );
+    }
+}
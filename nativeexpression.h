@@ -0,0 +1,97 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NATIVEEXPRESSION_H
+#define NATIVEEXPRESSION_H
+
+#include <stdlib.h>
+
+#include <string>
+
+#include "expression.h"
+
+/**
+    Evaluation backend of \ref Function which translates an \ref Expression
+    into C, builds it with the system compiler into a shared object and
+    loads it with dlopen. The shared objects are cached on disk, the name of
+    the file is the hash of the generated source, the compiler command and
+    the version output of the compiler, so an expression is only compiled
+    once per compiler. The source is also stored in the shared object and
+    compared after loading, which protects against hash collisions and
+    incomplete files.
+
+    The compiler is taken from the environment variable PSO_CC and defaults
+    to cc. The cache directory is PSO_JIT_CACHE, $XDG_CACHE_HOME/pso-jit,
+    $HOME/.cache/pso-jit or /tmp/pso-jit-<uid> in this order. Loading a
+    library runs its code, so the directory is created with mode 0700 and
+    is only used if it is a real directory owned by the user which nobody
+    else can write to. A cached library is only loaded if it is a regular
+    file owned by the user which nobody else can write to.
+
+    The constructor throws a RuntimeError if no compiler is available or
+    the compilation fails, in this case \ref Function keeps using muParser.
+*/
+class NativeExpression
+{
+    public:
+        NativeExpression( const Expression &expr );
+        ~NativeExpression();
+
+        double evaluate( const double *x ) const;
+        void evaluateBatch( const double *positions, size_t count, size_t stride, double *out ) const;
+
+        size_t getNumberOfVariables() const;
+        const std::string &getLibraryPath() const;
+
+        static std::string generateSource( const Expression &expr );
+        static std::string getCompiler();
+        static std::string getCacheDirectory();
+
+    private:
+        typedef double ( *EvaluateFunction )( const double *x );
+        typedef void ( *BatchFunction )( const double *positions, unsigned long count, unsigned long stride, double *out );
+
+        NativeExpression( const NativeExpression &other ) {}
+        NativeExpression &operator=( const NativeExpression &other ) {return *this;}
+
+        static std::string generateBody( const Expression &expr );
+        static std::string getCompilerVersion( const std::string &compiler );
+        static void checkOwnership( const std::string &path, bool directory );
+
+        bool load( const std::string &path, const std::string &body );
+        void compile( const std::string &source, const std::string &command, const std::string &path );
+
+        void                *handle;
+        EvaluateFunction    evaluate_function;
+        BatchFunction       batch_function;
+        size_t              num_variables;
+        std::string         library_path;
+};
+
+inline double NativeExpression::evaluate( const double *x ) const
+{
+    return ( *evaluate_function )( x );
+}
+
+inline void NativeExpression::evaluateBatch( const double *positions, size_t count, size_t stride, double *out ) const
+{
+    ( *batch_function )( positions, count, stride, out );
+}
+
+#endif // NATIVEEXPRESSION_H
@@ -0,0 +1,440 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "neighbourindex.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+
+static const double search_margin = 1e-6; //relative enlargement of the radius for the grid cells and the tree pruning
+
+/**
+    Orders particle ids by one coordinate, used to split the k-d tree nodes.
+*/
+class CoordinateLess
+{
+    public:
+        CoordinateLess( const double *positions_, size_t stride_, size_t dim ) : positions( positions_ ), stride( stride_ ), dimension( dim ) {}
+
+        bool operator()( size_t a, size_t b ) const
+        {
+            return positions[a * stride + dimension] < positions[b * stride + dimension];
+        }
+
+    private:
+        const double    *positions;
+        size_t          stride;
+        size_t          dimension;
+};
+
+NeighbourIndex::NeighbourIndex() : method( AUTOMATIC ), active_method( BRUTE_FORCE ), positions( NULL ), stride( 0 ), count( 0 ), dimension( 0 ),
+    radius( 0. ), squared_radius( 0. ), search_radius( 0. )
+{
+
+}
+
+void NeighbourIndex::setMethod( Method m )
+{
+    method = m;
+}
+
+NeighbourIndex::Method NeighbourIndex::getMethod() const
+{
+    return method;
+}
+
+/**
+    Returns the method used by the last \ref build. This differs from \ref getMethod
+    if the method is AUTOMATIC or if the requested structure can not be used for
+    the current positions.
+*/
+NeighbourIndex::Method NeighbourIndex::getActiveMethod() const
+{
+    return active_method;
+}
+
+/**
+    Returns the smallest number t with sqrt( t ) >= \a radius. For every distance d
+    the test d < t is then equal to sqrt( d ) < radius, also in floating point
+    arithmetic because the square root is correctly rounded and monotone.
+
+    \param[in] radius
+*/
+double NeighbourIndex::getSquaredRadius( double radius )
+{
+    if( !( radius > 0. ) )
+    {
+        return radius == radius ? 0. : radius;
+    }
+
+    double t = radius * radius;
+
+    while( t > 0. && sqrt( nextafter( t, 0. ) ) >= radius )
+    {
+        t = nextafter( t, 0. );
+    }
+
+    while( sqrt( t ) < radius )
+    {
+        t = nextafter( t, std::numeric_limits<double>::infinity() );
+    }
+
+    return t;
+}
+
+/**
+    Builds the index over \a count_ positions with the row distance \a stride_.
+    The positions are not copied, they must not change until the last \ref query.
+
+    \param[in] positions_
+    \param[in] stride_
+    \param[in] count_
+    \param[in] dim
+    \param[in] radius_
+*/
+void NeighbourIndex::build( const double *positions_, size_t stride_, size_t count_, size_t dim, double radius_ )
+{
+    positions = positions_;
+    stride = stride_;
+    count = count_;
+    dimension = dim;
+    radius = radius_;
+    squared_radius = getSquaredRadius( radius );
+    search_radius = radius * ( 1. + search_margin );
+
+    active_method = method;
+
+    if( active_method == AUTOMATIC )
+    {
+        if( count < min_particles )
+        {
+            active_method = BRUTE_FORCE;
+        }
+        else if( dimension <= max_grid_dimension )
+        {
+            active_method = HASH_GRID;
+        }
+        else if( dimension <= max_tree_dimension )
+        {
+            active_method = KD_TREE;
+        }
+        else
+        {
+            active_method = BRUTE_FORCE;
+        }
+    }
+
+    //the spatial structures need a finite positive radius and finite positions
+    bool finite = radius > 0. && radius < std::numeric_limits<double>::infinity();
+
+    for( size_t i = 0; i < count && finite; i++ )
+    {
+        for( size_t k = 0; k < dimension; k++ )
+        {
+            double x = positions[i * stride + k];
+
+            if( !( x - x == 0. ) )
+            {
+                finite = false;
+                break;
+            }
+        }
+    }
+
+    if( !finite || dimension == 0 )
+    {
+        active_method = BRUTE_FORCE;
+    }
+
+    if( active_method == HASH_GRID && !buildGrid() )
+    {
+        active_method = KD_TREE;
+    }
+
+    if( active_method == KD_TREE )
+    {
+        buildTree();
+    }
+}
+
+/**
+    Writes the ids of all particles within the radius of particle \a id to
+    \a result in ascending order. The particle itself is not included.
+
+    \param[in] id
+    \param[out] result
+*/
+void NeighbourIndex::query( size_t id, std::vector<size_t> &result ) const
+{
+    result.clear();
+
+    switch( active_method )
+    {
+        case HASH_GRID:
+            queryGrid( id, result );
+            break;
+
+        case KD_TREE:
+            if( !tree_nodes.empty() )
+            {
+                queryTree( id, 0, result );
+            }
+
+            std::sort( result.begin(), result.end() );
+            break;
+
+        default:
+            queryBruteForce( id, result );
+            break;
+    }
+}
+
+/**
+    Computes the cell of each particle and sorts the particles by the hash of
+    their cell. Returns false if the positions spread over too many cells, in
+    that case the rounding of the cell coordinates could miss neighbours.
+*/
+bool NeighbourIndex::buildGrid()
+{
+    std::vector<double> origin( dimension, std::numeric_limits<double>::max() ), extent( dimension, -std::numeric_limits<double>::max() );
+
+    for( size_t i = 0; i < count; i++ )
+    {
+        for( size_t k = 0; k < dimension; k++ )
+        {
+            origin[k] = std::min( origin[k], positions[i * stride + k] );
+            extent[k] = std::max( extent[k], positions[i * stride + k] );
+        }
+    }
+
+    for( size_t k = 0; k < dimension; k++ )
+    {
+        if( !( ( extent[k] - origin[k] ) / search_radius < max_cells_per_dimension ) )
+        {
+            return false;
+        }
+    }
+
+    cells.resize( count * dimension );
+    grid.resize( count );
+
+    for( size_t i = 0; i < count; i++ )
+    {
+        long *cell = &cells[i * dimension];
+
+        for( size_t k = 0; k < dimension; k++ )
+        {
+            cell[k] = static_cast<long>( floor( ( positions[i * stride + k] - origin[k] ) / search_radius ) );
+        }
+
+        grid[i] = std::make_pair( getCellHash( cell ), i );
+    }
+
+    std::sort( grid.begin(), grid.end() );
+    return true;
+}
+
+void NeighbourIndex::buildTree()
+{
+    tree_indices.resize( count );
+    tree_nodes.clear();
+
+    for( size_t i = 0; i < count; i++ )
+    {
+        tree_indices[i] = i;
+    }
+
+    if( count > 0 )
+    {
+        buildTreeNode( 0, count );
+    }
+}
+
+/**
+    Splits the particles tree_indices[begin, end) at the median of the
+    coordinate with the largest spread. Returns the index of the new node.
+*/
+long NeighbourIndex::buildTreeNode( size_t begin, size_t end )
+{
+    long node = static_cast<long>( tree_nodes.size() );
+    TreeNode current;
+    current.begin = begin;
+    current.end = end;
+    current.split_dimension = 0;
+    current.split_value = 0.;
+    current.left = -1;
+    current.right = -1;
+    tree_nodes.push_back( current );
+
+    if( end - begin <= tree_leaf_size )
+    {
+        return node;
+    }
+
+    double max_spread = -1.;
+
+    for( size_t k = 0; k < dimension; k++ )
+    {
+        double min = std::numeric_limits<double>::max(), max = -std::numeric_limits<double>::max();
+
+        for( size_t i = begin; i < end; i++ )
+        {
+            min = std::min( min, positions[tree_indices[i] * stride + k] );
+            max = std::max( max, positions[tree_indices[i] * stride + k] );
+        }
+
+        if( max - min > max_spread )
+        {
+            max_spread = max - min;
+            current.split_dimension = k;
+        }
+    }
+
+    size_t middle = begin + ( end - begin ) / 2;
+    std::nth_element( tree_indices.begin() + begin, tree_indices.begin() + middle, tree_indices.begin() + end,
+                      CoordinateLess( positions, stride, current.split_dimension ) );
+    current.split_value = positions[tree_indices[middle] * stride + current.split_dimension];
+
+    //the children are appended behind this node, therefore the vector may reallocate
+    current.left = buildTreeNode( begin, middle );
+    current.right = buildTreeNode( middle, end );
+    tree_nodes[node] = current;
+
+    return node;
+}
+
+void NeighbourIndex::queryBruteForce( size_t id, std::vector<size_t> &result ) const
+{
+    for( size_t j = 0; j < count; j++ )
+    {
+        if( j != id && isWithinRadius( id, j ) )
+        {
+            result.push_back( j );
+        }
+    }
+}
+
+/**
+    Visits the 3^dimension cells around the cell of particle \a id. Different
+    cells may share a hash, therefore the candidates are made unique at the end.
+*/
+void NeighbourIndex::queryGrid( size_t id, std::vector<size_t> &result ) const
+{
+    const long *own_cell = &cells[id * dimension];
+    long cell[max_grid_dimension];
+    long offset[max_grid_dimension];
+
+    for( size_t k = 0; k < dimension; k++ )
+    {
+        offset[k] = -1;
+    }
+
+    while( true )
+    {
+        for( size_t k = 0; k < dimension; k++ )
+        {
+            cell[k] = own_cell[k] + offset[k];
+        }
+
+        std::pair<uint64_t, size_t> key( getCellHash( cell ), 0 );
+        std::vector<std::pair<uint64_t, size_t> >::const_iterator it = std::lower_bound( grid.begin(), grid.end(), key );
+
+        for( ; it != grid.end() && it->first == key.first; ++it )
+        {
+            if( it->second != id && isWithinRadius( id, it->second ) )
+            {
+                result.push_back( it->second );
+            }
+        }
+
+        size_t k = 0;
+
+        for( ; k < dimension; k++ )
+        {
+            if( offset[k] < 1 )
+            {
+                offset[k]++;
+                break;
+            }
+
+            offset[k] = -1;
+        }
+
+        if( k == dimension )
+        {
+            break;
+        }
+    }
+
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
+}
+
+/**
+    A subtree is skipped only if the distance to the split plane exceeds the
+    enlarged search radius, so rounding in the plane distance can not drop a
+    neighbour.
+*/
+void NeighbourIndex::queryTree( size_t id, long node, std::vector<size_t> &result ) const
+{
+    const TreeNode &current = tree_nodes[node];
+
+    if( current.left < 0 )
+    {
+        for( size_t i = current.begin; i < current.end; i++ )
+        {
+            size_t other = tree_indices[i];
+
+            if( other != id && isWithinRadius( id, other ) )
+            {
+                result.push_back( other );
+            }
+        }
+
+        return;
+    }
+
+    double x = positions[id * stride + current.split_dimension];
+
+    if( !( x - current.split_value > search_radius ) )
+    {
+        queryTree( id, current.left, result );
+    }
+
+    if( !( current.split_value - x > search_radius ) )
+    {
+        queryTree( id, current.right, result );
+    }
+}
+
+uint64_t NeighbourIndex::getCellHash( const long *cell ) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for( size_t k = 0; k < dimension; k++ )
+    {
+        hash ^= static_cast<uint64_t>( cell[k] );
+        hash *= 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
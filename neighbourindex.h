@@ -0,0 +1,124 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NEIGHBOURINDEX_H
+#define NEIGHBOURINDEX_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+/**
+    Spatial index for the radius queries of the GLOBAL_LOCAL_BEST mode. The
+    index is built over the positions of all particles once per iteration and
+    returns for a particle all other particles whose distance is smaller than
+    the radius.
+
+    For low dimensions a uniform hash grid with the radius as cell size is used,
+    for moderate dimensions a k-d tree and for high dimensions the brute force
+    scan. The grid and the tree only select candidates, the final decision is
+    always made by the same squared distance test as in the brute force scan.
+    The squared radius is chosen so that this test gives exactly the same result
+    as comparing the square root of the distance with the radius. Therefore all
+    methods return identical results.
+*/
+class NeighbourIndex
+{
+    public:
+        enum Method {AUTOMATIC, BRUTE_FORCE, HASH_GRID, KD_TREE};
+
+        static const size_t max_grid_dimension = 3;
+        static const size_t max_tree_dimension = 16;
+        static const size_t min_particles = 64; //below this number the brute force scan is used
+
+        NeighbourIndex();
+
+        void setMethod( Method m );
+        Method getMethod() const;
+        Method getActiveMethod() const;
+
+        void build( const double *positions_, size_t stride_, size_t count_, size_t dim, double radius_ );
+        void query( size_t id, std::vector<size_t> &result ) const;
+
+        static double getSquaredRadius( double radius );
+        static double getSquaredDistance( const double *a, const double *b, size_t dim );
+
+    protected:
+        struct TreeNode
+        {
+            size_t  begin;
+            size_t  end;
+            size_t  split_dimension;
+            double  split_value;
+            long    left;   //-1 for leafs
+            long    right;
+        };
+
+        static const size_t tree_leaf_size = 8;
+        static const long max_cells_per_dimension = 1L << 20;
+
+        bool buildGrid();
+        void buildTree();
+        long buildTreeNode( size_t begin, size_t end );
+
+        void queryBruteForce( size_t id, std::vector<size_t> &result ) const;
+        void queryGrid( size_t id, std::vector<size_t> &result ) const;
+        void queryTree( size_t id, long node, std::vector<size_t> &result ) const;
+
+        uint64_t getCellHash( const long *cell ) const;
+        bool isWithinRadius( size_t id, size_t other ) const;
+
+        Method          method;
+        Method          active_method;
+
+        const double    *positions;
+        size_t          stride;
+        size_t          count;
+        size_t          dimension;
+        double          radius;
+        double          squared_radius;
+        double          search_radius;  //radius with a safety margin for the candidate selection
+
+        std::vector<long>                           cells;          //count * dimension cell coordinates
+        std::vector<std::pair<uint64_t, size_t> >   grid;           //(cell hash, particle id) sorted by the hash
+
+        std::vector<size_t>     tree_indices;
+        std::vector<TreeNode>   tree_nodes;
+};
+
+inline double NeighbourIndex::getSquaredDistance( const double *a, const double *b, size_t dim )
+{
+    double distance = 0.;
+
+    for( size_t k = 0; k < dim; k++ )
+    {
+        distance += ( a[k] - b[k] ) * ( a[k] - b[k] );
+    }
+
+    return distance;
+}
+
+inline bool NeighbourIndex::isWithinRadius( size_t id, size_t other ) const
+{
+    return getSquaredDistance( positions + id * stride, positions + other * stride, dimension ) < squared_radius;
+}
+
+#endif // NEIGHBOURINDEX_H
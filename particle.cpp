@@ -18,97 +18,116 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "particle.h"
+#include "psokernel.h"
 
-Particle::Particle( size_t dim ) : position( dim ), velocity( dim ), best_position( dim )
+Particle::Particle() : store( NULL ), id( 0 )
 {
-    current_value = 0.;
-    best_value = 0.0;//numeric_limits<double>::min();
-    best_position = position;
-    best_neighbour = NULL;
+
 }
 
-Particle::~Particle()
+Particle::Particle( ParticleStore *store_, size_t id_ ) : store( store_ ), id( id_ )
 {
 
 }
 
-void Particle::calcNewGlobal( double max_velocity, double c1, double c2, double w, VectorN<double> &global_best )
-{
-    velocity = velocity * w + ( best_position - position ) * c1 * getRandomNumber() + ( global_best - position ) * c2 * getRandomNumber();
+/**
+    Computes the new velocity and position.
 
-    if( velocity.length() >= max_velocity )
-    {
-        velocity.normalize();
-        velocity = velocity * max_velocity;
-    }
+    \param[in] random  the uniform random numbers r1 and r2 of this particle, see \ref PhiloxRandom::fillCoefficients
+*/
+void Particle::calcNewGlobal( double max_velocity, double c1, double c2, double w, VectorN<double> &global_best, const double *random )
+{
+    double r1 = c1 * random[0], r2 = c2 * random[1];
 
-    position = position + velocity;
+    PSOKernel::update( store->getPosition( id ), store->getVelocity( id ), store->getBestPosition( id ), &global_best[0], NULL,
+                       store->getDimension(), w, r1, r2, 0., max_velocity );
 }
 
-void Particle::calcNewGlobalAndLocal( double max_velocity, double c1, double c2, double c3, double w, VectorN<double> &global_best, bool ( *compare )( double, double ) )
+/**
+    Computes the new velocity and position including the best neighbour.
+
+    \param[in] random  the uniform random numbers r1, r2 and r3 of this particle, see \ref PhiloxRandom::fillCoefficients
+*/
+void Particle::calcNewGlobalAndLocal( double max_velocity, double c1, double c2, double c3, double w, VectorN<double> &global_best, bool ( *compare )( double, double ),
+                                      const double *random )
 {
-    if( best_neighbour )
-    {
-        velocity = velocity * w + ( best_position - position ) * c1 * getRandomNumber() + ( global_best - position ) * c2 * getRandomNumber() + ( best_neighbour->position - position ) * c3 * getRandomNumber();
-    }
-    else
+    long best_neighbour = store->getBestNeighbour( id );
+
+    if( best_neighbour != ParticleStore::no_neighbour )
     {
-        velocity = velocity * w + ( best_position - position ) * c1 * getRandomNumber() + ( global_best - position ) * c2 * getRandomNumber();
+        double r1 = c1 * random[0], r2 = c2 * random[1], r3 = c3 * random[2];
 
+        PSOKernel::update( store->getPosition( id ), store->getVelocity( id ), store->getBestPosition( id ), &global_best[0], store->getPosition( best_neighbour ),
+                           store->getDimension(), w, r1, r2, r3, max_velocity );
     }
-
-    if( velocity.length() >= max_velocity )
+    else
     {
-        velocity.normalize();
-        velocity = velocity * max_velocity;
+        calcNewGlobal( max_velocity, c1, c2, w, global_best, random );
     }
+}
 
-    position = position + velocity;
+VectorView<double> Particle::getPosition() const
+{
+    return VectorView<double>( store->getPosition( id ), store->getDimension() );
 }
 
-VectorN< double > &Particle::getPosition()
+VectorView<double> Particle::getVelocity() const
 {
-    return position;
+    return VectorView<double>( store->getVelocity( id ), store->getDimension() );
 }
 
-VectorN< double > &Particle::getVelocity()
+VectorView<double> Particle::getBestPosition() const
 {
-    return velocity;
+    return VectorView<double>( store->getBestPosition( id ), store->getDimension() );
 }
 
-VectorN< double > &Particle::getBestPosition()
+double Particle::getCurrentValue() const
 {
-    return best_position;
+    return store->getCurrentValue( id );
 }
 
-double Particle::getCurrentValue()
+double Particle::getBestValue() const
 {
-    return current_value;
+    return store->getBestValue( id );
 }
 
-double Particle::getBestValue()
+/**
+    Returns a view on the neighbour with the best value. If no neighbour
+    is set the returned view is invalid, see \ref isValid.
+*/
+Particle Particle::getBestNeighbour() const
 {
-    return best_value;
+    long best_neighbour = store->getBestNeighbour( id );
+
+    if( best_neighbour == ParticleStore::no_neighbour )
+    {
+        return Particle();
+    }
+
+    return Particle( store, best_neighbour );
 }
 
-Particle *Particle::getBestNeighbour()
+void Particle::setBestNeighbour( const Particle &bn )
 {
-    return best_neighbour;
+    store->getBestNeighbour( id ) = bn.isValid() ? static_cast<long>( bn.id ) : ParticleStore::no_neighbour;
 }
 
-void Particle::setBestNeighbour( Particle *bn )
+size_t Particle::getId() const
 {
-    best_neighbour = bn;
+    return id;
 }
 
-double Particle::getRandomNumber()
+bool Particle::isValid() const
 {
-#ifdef win32
-    return ( ::rand() % RAND_MAX ) / ( ( double )( RAND_MAX - 1 ) );
-#endif
+    return store != NULL;
+}
 
-#ifdef __gnu_linux__
-    return ( ::random() % RAND_MAX ) / ( ( double )( RAND_MAX - 1 ) );
-#endif
+bool Particle::operator == ( const Particle &other ) const
+{
+    return store == other.store && id == other.id;
+}
 
+bool Particle::operator != ( const Particle &other ) const
+{
+    return !( *this == other );
 }
@@ -21,67 +21,105 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 #define PARTICLE_H_
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <limits>
 
 #include "vectorn.h"
+#include "vectorview.h"
+#include "particlestore.h"
 
+/**
+    Lightweight view on a single particle inside a \ref ParticleStore. The
+    particle data itself lives in the contiguous blocks of the store, the view
+    only holds a pointer to the store and the particle id. Therefore it is cheap
+    to copy and stays valid if the store grows.
+*/
 class Particle
 {
     public:
-        Particle( size_t dim );
-        virtual ~Particle();
+        Particle();
+        Particle( ParticleStore *store_, size_t id_ );
 
         template<typename Functor>
-        void calculateFitness( Functor &func, bool ( *compare )( double, double ) );
+        bool calculateFitness( Functor &func, bool ( *compare )( double, double ) );
         template<typename Functor>
         void initFitness( Functor &func );
 
-        void calcNewGlobal( double max_velocity, double c1, double c2, double w, VectorN<double> &global_best );
+        bool updateBest( bool ( *compare )( double, double ) );
+        void initBest();
 
-        void calcNewGlobalAndLocal( double max_velocity, double c1, double c2, double c3, double w, VectorN<double> &global_best, bool ( *compare )( double, double ) );
+        void calcNewGlobal( double max_velocity, double c1, double c2, double w, VectorN<double> &global_best, const double *random );
 
-        static double getRandomNumber();
+        void calcNewGlobalAndLocal( double max_velocity, double c1, double c2, double c3, double w, VectorN<double> &global_best, bool ( *compare )( double, double ),
+                                    const double *random );
 
-        VectorN<double> &getPosition();
-        VectorN<double> &getVelocity();
-        VectorN<double> &getBestPosition();
+        VectorView<double> getPosition() const;
+        VectorView<double> getVelocity() const;
+        VectorView<double> getBestPosition() const;
 
-        double getCurrentValue();
-        double getBestValue();
+        double getCurrentValue() const;
+        double getBestValue() const;
 
-        Particle *getBestNeighbour();
-        void setBestNeighbour( Particle *bn );
+        Particle getBestNeighbour() const;
+        void setBestNeighbour( const Particle &bn );
 
-    protected:
-        VectorN<double>     position;
-        VectorN<double>     velocity;
-        double              current_value;      //current function value: (<->present)
+        size_t getId() const;
+        bool isValid() const;
 
-        double              best_value;         //best ever found function value: (<->pbest)
-        VectorN<double>     best_position;      //best ever found position: (<->pbest)
+        bool operator == ( const Particle &other ) const;
+        bool operator != ( const Particle &other ) const;
 
-        Particle            *best_neighbour;    //a pointer to the neighbour with the best value
+    protected:
+        ParticleStore       *store;
+        size_t              id;
 };
 
+/**
+    Evaluates the function at the current position and updates the best
+    position. Returns true if the best value was improved.
+*/
 template<typename Functor>
-void Particle::calculateFitness( Functor &func, bool ( *compare )( double, double ) )
+bool Particle::calculateFitness( Functor &func, bool ( *compare )( double, double ) )
 {
-    current_value = func( position );
+    store->getCurrentValue( id ) = func( getPosition() );
+    return updateBest( compare );
+}
+
+template<typename Functor>
+void Particle::initFitness( Functor &func )
+{
+    store->getCurrentValue( id ) = func( getPosition() );
+    initBest();
+}
+
+/**
+    Takes the current position as best position if the current value is better
+    than the best value. Used after the current value was set, for example by a
+    batch evaluation of the whole swarm. Returns true if the best value was improved.
+*/
+inline bool Particle::updateBest( bool ( *compare )( double, double ) )
+{
+    double &current_value = store->getCurrentValue( id );
+    double &best_value = store->getBestValue( id );
 
     if( ( *compare )( current_value, best_value ) )
     {
         best_value = current_value;
-        best_position = position;
+        memcpy( store->getBestPosition( id ), store->getPosition( id ), store->getDimension() * sizeof( double ) );
+        return true;
     }
+
+    return false;
 }
 
-template<typename Functor>
-void Particle::initFitness( Functor &func )
+/**
+    Resets the best value and position to the current ones.
+*/
+inline void Particle::initBest()
 {
-    current_value = func( position );
-    best_value = current_value;
-    best_position = position;
+    store->getBestValue( id ) = store->getCurrentValue( id );
+    memcpy( store->getBestPosition( id ), store->getPosition( id ), store->getDimension() * sizeof( double ) );
 }
 
 #endif
@@ -0,0 +1,152 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "particlestore.h"
+
+#include <string.h>
+
+#include "exception.h"
+
+ParticleStore::ParticleStore( size_t dim ) : dimension( 0 ), stride( 0 ), count( 0 ), capacity( 0 ),
+    positions( NULL ), velocities( NULL ), best_positions( NULL ), current_values( NULL ), best_values( NULL ), best_neighbours( NULL )
+{
+    setDimension( dim );
+}
+
+ParticleStore::~ParticleStore()
+{
+    free( positions );
+    free( velocities );
+    free( best_positions );
+    free( current_values );
+    free( best_values );
+    free( best_neighbours );
+}
+
+/**
+    Changes the dimension of the stored particles. All particles are removed
+    and the memory is released because the row stride changes.
+
+    \param[in] dim
+*/
+void ParticleStore::setDimension( size_t dim )
+{
+    free( positions );
+    free( velocities );
+    free( best_positions );
+    free( current_values );
+    free( best_values );
+    free( best_neighbours );
+
+    positions = velocities = best_positions = current_values = best_values = NULL;
+    best_neighbours = NULL;
+    count = capacity = 0;
+
+    dimension = dim;
+    stride = ( ( dim + row_alignment - 1 ) / row_alignment ) * row_alignment;
+}
+
+/**
+    Removes all particles but keeps the allocated memory for reuse.
+*/
+void ParticleStore::clear()
+{
+    count = 0;
+}
+
+void ParticleStore::reserve( size_t num )
+{
+    if( num > capacity )
+    {
+        grow( num );
+    }
+}
+
+/**
+    Appends a particle with all values set to zero and returns its id.
+*/
+size_t ParticleStore::add()
+{
+    if( count == capacity )
+    {
+        grow( capacity == 0 ? 16 : capacity * 2 );
+    }
+
+    size_t id = count++;
+
+    memset( getPosition( id ), 0, stride * sizeof( double ) );
+    memset( getVelocity( id ), 0, stride * sizeof( double ) );
+    memset( getBestPosition( id ), 0, stride * sizeof( double ) );
+    current_values[id] = 0.;
+    best_values[id] = 0.;
+    best_neighbours[id] = no_neighbour;
+
+    return id;
+}
+
+void *ParticleStore::allocate( size_t bytes )
+{
+    void *block = NULL;
+
+    if( posix_memalign( &block, alignment, bytes == 0 ? alignment : bytes ) != 0 )
+    {
+        throw RuntimeError( "Unable to allocate memory for the particle store" );
+    }
+
+    return block;
+}
+
+/**
+    Reallocates all blocks with room for \a num particles and copies the
+    existing particles.
+*/
+void ParticleStore::grow( size_t num )
+{
+    double *new_positions = static_cast<double *>( allocate( num * stride * sizeof( double ) ) );
+    double *new_velocities = static_cast<double *>( allocate( num * stride * sizeof( double ) ) );
+    double *new_best_positions = static_cast<double *>( allocate( num * stride * sizeof( double ) ) );
+    double *new_current_values = static_cast<double *>( allocate( num * sizeof( double ) ) );
+    double *new_best_values = static_cast<double *>( allocate( num * sizeof( double ) ) );
+    long *new_best_neighbours = static_cast<long *>( allocate( num * sizeof( long ) ) );
+
+    if( count > 0 )
+    {
+        memcpy( new_positions, positions, count * stride * sizeof( double ) );
+        memcpy( new_velocities, velocities, count * stride * sizeof( double ) );
+        memcpy( new_best_positions, best_positions, count * stride * sizeof( double ) );
+        memcpy( new_current_values, current_values, count * sizeof( double ) );
+        memcpy( new_best_values, best_values, count * sizeof( double ) );
+        memcpy( new_best_neighbours, best_neighbours, count * sizeof( long ) );
+    }
+
+    free( positions );
+    free( velocities );
+    free( best_positions );
+    free( current_values );
+    free( best_values );
+    free( best_neighbours );
+
+    positions = new_positions;
+    velocities = new_velocities;
+    best_positions = new_best_positions;
+    current_values = new_current_values;
+    best_values = new_best_values;
+    best_neighbours = new_best_neighbours;
+    capacity = num;
+}
@@ -0,0 +1,172 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARTICLESTORE_H
+#define PARTICLESTORE_H
+
+#include <stdlib.h>
+
+/**
+    Structure of arrays storage for all particles of a swarm. Positions,
+    velocities, best positions and the fitness values are each held in one
+    contiguous and aligned block which is indexed by the particle id. The rows
+    of the vector blocks are padded to \ref getStride elements so that every
+    row starts on an aligned address.
+
+    The store does not know anything about the optimization itself, it is
+    accessed through the lightweight \ref Particle view.
+*/
+class ParticleStore
+{
+    public:
+        static const size_t alignment = 64;    //alignment of each block in bytes
+        static const size_t row_alignment = 4; //rows are padded to a multiple of this number of doubles
+        static const long no_neighbour = -1;
+
+        ParticleStore( size_t dim = 0 );
+        virtual ~ParticleStore();
+
+        void setDimension( size_t dim );
+        size_t getDimension() const;
+        size_t getStride() const;
+
+        size_t size() const;
+        bool empty() const;
+        void clear();
+        void reserve( size_t num );
+
+        size_t add();
+
+        double *getPositions();
+        double *getVelocities();
+        double *getBestPositions();
+        double *getCurrentValues();
+        double *getBestValues();
+        long *getBestNeighbours();
+
+        double *getPosition( size_t id );
+        double *getVelocity( size_t id );
+        double *getBestPosition( size_t id );
+
+        double &getCurrentValue( size_t id );
+        double &getBestValue( size_t id );
+        long &getBestNeighbour( size_t id );
+
+    protected:
+        static void *allocate( size_t bytes );
+        void grow( size_t num );
+
+        size_t  dimension;
+        size_t  stride;
+        size_t  count;
+        size_t  capacity;
+
+        double  *positions;         //count * stride
+        double  *velocities;        //count * stride
+        double  *best_positions;    //count * stride
+        double  *current_values;    //count
+        double  *best_values;       //count
+        long    *best_neighbours;   //count, index of the neighbour with the best value or no_neighbour
+
+    private:
+        ParticleStore( const ParticleStore &other ) {}
+        ParticleStore &operator=( const ParticleStore &other ) {return *this;}
+};
+
+inline size_t ParticleStore::getDimension() const
+{
+    return dimension;
+}
+
+inline size_t ParticleStore::getStride() const
+{
+    return stride;
+}
+
+inline size_t ParticleStore::size() const
+{
+    return count;
+}
+
+inline bool ParticleStore::empty() const
+{
+    return count == 0;
+}
+
+inline double *ParticleStore::getPositions()
+{
+    return positions;
+}
+
+inline double *ParticleStore::getVelocities()
+{
+    return velocities;
+}
+
+inline double *ParticleStore::getBestPositions()
+{
+    return best_positions;
+}
+
+inline double *ParticleStore::getCurrentValues()
+{
+    return current_values;
+}
+
+inline double *ParticleStore::getBestValues()
+{
+    return best_values;
+}
+
+inline long *ParticleStore::getBestNeighbours()
+{
+    return best_neighbours;
+}
+
+inline double *ParticleStore::getPosition( size_t id )
+{
+    return positions + id * stride;
+}
+
+inline double *ParticleStore::getVelocity( size_t id )
+{
+    return velocities + id * stride;
+}
+
+inline double *ParticleStore::getBestPosition( size_t id )
+{
+    return best_positions + id * stride;
+}
+
+inline double &ParticleStore::getCurrentValue( size_t id )
+{
+    return current_values[id];
+}
+
+inline double &ParticleStore::getBestValue( size_t id )
+{
+    return best_values[id];
+}
+
+inline long &ParticleStore::getBestNeighbour( size_t id )
+{
+    return best_neighbours[id];
+}
+
+#endif // PARTICLESTORE_H
@@ -41,12 +41,12 @@ ParticleViewWidget::~ParticleViewWidget()
 
 }
 
-bool compare_a_gt_b( const std::pair<double, Particle *> &a, const std::pair<double, Particle *> &b )
+bool compare_a_gt_b( const std::pair<double, Particle> &a, const std::pair<double, Particle> &b )
 {
     return a.first > b.first;
 }
 
-bool compare_a_lt_b( const std::pair<double, Particle *> &a, const std::pair<double, Particle *> &b )
+bool compare_a_lt_b( const std::pair<double, Particle> &a, const std::pair<double, Particle> &b )
 {
     return a.first < b.first;
 }
@@ -65,14 +65,13 @@ void ParticleViewWidget::updateView()
         particle_model->insertRows( 0, swarm->m_swarm.size() );
     }
 
-    std::vector<std::pair<double, Particle *> > sort_container( swarm->m_swarm.size() );
-    Swarm<Function>::particle_container::iterator begin = swarm->m_swarm.begin(), end = swarm->m_swarm.end();
+    std::vector<std::pair<double, Particle> > sort_container( swarm->m_swarm.size() );
     {
-        size_t i = 0;
+        const double *current_values = swarm->m_swarm.getCurrentValues();
 
-        for( Swarm<Function>::particle_container::iterator it( begin ); it != end; it++, i++ )
+        for( size_t i = 0; i < swarm->m_swarm.size(); i++ )
         {
-            sort_container[i] = std::make_pair( ( *it )->getCurrentValue(), *it );
+            sort_container[i] = std::make_pair( current_values[i], swarm->getParticle( i ) );
         }
     }
 
@@ -89,12 +88,12 @@ void ParticleViewWidget::updateView()
         QString num;
         unsigned int row = 0;
 
-        for( std::vector<std::pair<double, Particle *> >::iterator it( sort_container.begin() ); it != sort_container.end(); it++ )
+        for( std::vector<std::pair<double, Particle> >::iterator it( sort_container.begin() ); it != sort_container.end(); it++ )
         {
-            num.setNum( it->second->getCurrentValue() );
+            num.setNum( it->second.getCurrentValue() );
             particle_model->setItem( row, 0, new QStandardItem( num ) );
-            particle_model->setItem( row, 1, new QStandardItem( QString::fromStdString( it->second->getPosition().toString( 3 ) ) ) );
-            particle_model->setItem( row, 2, new QStandardItem( QString::fromStdString( it->second->getVelocity().toString( 3 ) ) ) );
+            particle_model->setItem( row, 1, new QStandardItem( QString::fromStdString( it->second.getPosition().toString( 3 ) ) ) );
+            particle_model->setItem( row, 2, new QStandardItem( QString::fromStdString( it->second.getVelocity().toString( 3 ) ) ) );
             row++;
         }
     }
@@ -0,0 +1,157 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "philoxrandom.h"
+
+static const uint32_t philox_m0 = 0xD2511F53;
+static const uint32_t philox_m1 = 0xCD9E8D57;
+static const uint32_t philox_w0 = 0x9E3779B9;
+static const uint32_t philox_w1 = 0xBB67AE85;
+static const unsigned int philox_rounds = 10;
+static const double to_unit_interval = 1.0 / 4294967296.0;
+
+/**
+    The Philox round function written without branches on plain arrays, so the
+    compiler is able to vectorize loops which call it for many counters.
+*/
+static inline void philoxRounds( uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1, uint32_t out[4] )
+{
+    for( unsigned int i = 0; i < philox_rounds; i++ )
+    {
+        uint64_t p0 = static_cast<uint64_t>( philox_m0 ) * c0;
+        uint64_t p1 = static_cast<uint64_t>( philox_m1 ) * c2;
+
+        uint32_t n0 = static_cast<uint32_t>( p1 >> 32 ) ^ c1 ^ k0;
+        uint32_t n1 = static_cast<uint32_t>( p1 );
+        uint32_t n2 = static_cast<uint32_t>( p0 >> 32 ) ^ c3 ^ k1;
+        uint32_t n3 = static_cast<uint32_t>( p0 );
+
+        c0 = n0;
+        c1 = n1;
+        c2 = n2;
+        c3 = n3;
+
+        k0 += philox_w0;
+        k1 += philox_w1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+PhiloxRandom::PhiloxRandom( uint64_t seed_ ) : run( 0 )
+{
+    setSeed( seed_ );
+}
+
+/**
+    Sets the seed and resets the run counter.
+
+    \param[in] seed_
+*/
+void PhiloxRandom::setSeed( uint64_t seed_ )
+{
+    seed = seed_;
+    key[0] = static_cast<uint32_t>( seed );
+    key[1] = static_cast<uint32_t>( seed >> 32 );
+    run = 0;
+}
+
+uint64_t PhiloxRandom::getSeed() const
+{
+    return seed;
+}
+
+/**
+    Switches to a new independent set of random numbers. This is used if a
+    new swarm is created, otherwise every swarm with the same seed would
+    behave the same.
+*/
+void PhiloxRandom::nextRun()
+{
+    run++;
+}
+
+uint32_t PhiloxRandom::getRun() const
+{
+    return run;
+}
+
+void PhiloxRandom::setRun( uint32_t run_ )
+{
+    run = run_;
+}
+
+void PhiloxRandom::philox4x32( const uint32_t counter[4], const uint32_t key[2], uint32_t out[4] )
+{
+    philoxRounds( counter[0], counter[1], counter[2], counter[3], key[0], key[1], out );
+}
+
+/**
+    Returns a random number in the interval [0,1) which only depends on the
+    seed, the run and the arguments.
+*/
+double PhiloxRandom::getRandomNumber( uint32_t particle, uint32_t iteration, Stream stream, uint32_t index ) const
+{
+    uint32_t out[4];
+    philoxRounds( particle, iteration, run, ( static_cast<uint32_t>( stream ) << 24 ) | ( index / 4 ), key[0], key[1], out );
+    return out[index % 4] * to_unit_interval;
+}
+
+/**
+    Writes \a count random numbers of one particle to \a out. The number
+    out[i] is the same as the one returned by getRandomNumber( particle, iteration, stream, i ).
+*/
+void PhiloxRandom::fill( uint32_t particle, uint32_t iteration, Stream stream, size_t count, double *out ) const
+{
+    uint32_t block[4];
+
+    for( size_t i = 0; i < count; i += 4 )
+    {
+        philoxRounds( particle, iteration, run, ( static_cast<uint32_t>( stream ) << 24 ) | static_cast<uint32_t>( i / 4 ), key[0], key[1], block );
+
+        for( size_t k = 0; k < 4 && i + k < count; k++ )
+        {
+            out[i + k] = block[k] * to_unit_interval;
+        }
+    }
+}
+
+/**
+    Generates the coefficients r1, r2 and r3 of the velocity update for all
+    particles of one iteration with one Philox evaluation per particle. The
+    coefficients of particle i are stored at out[i * coefficients_per_particle + k].
+*/
+void PhiloxRandom::fillCoefficients( uint32_t iteration, size_t num_particles, double *out ) const
+{
+    const uint32_t stream = static_cast<uint32_t>( STREAM_COEFFICIENTS ) << 24;
+
+    for( size_t i = 0; i < num_particles; i++ )
+    {
+        uint32_t block[4];
+        philoxRounds( static_cast<uint32_t>( i ), iteration, run, stream, key[0], key[1], block );
+
+        out[i * coefficients_per_particle + 0] = block[0] * to_unit_interval;
+        out[i * coefficients_per_particle + 1] = block[1] * to_unit_interval;
+        out[i * coefficients_per_particle + 2] = block[2] * to_unit_interval;
+        out[i * coefficients_per_particle + 3] = block[3] * to_unit_interval;
+    }
+}
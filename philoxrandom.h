@@ -0,0 +1,68 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PHILOXRANDOM_H
+#define PHILOXRANDOM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+    Counter based random number generator (Philox4x32-10, Salmon et al.,
+    "Parallel random numbers: as easy as 1, 2, 3"). A random number is a pure
+    function of the key and the counter, there is no hidden state which is
+    changed by drawing a number. Therefore the generator can be used from any
+    number of threads without locking and a run can be reproduced for a single
+    particle.
+
+    The key is built from the seed. The counter consists of the particle id,
+    the iteration, the run (incremented by \ref nextRun for every new swarm) and
+    the stream, which separates for example the initial positions from the
+    coefficients of the velocity update, together with the index inside the stream.
+    Each evaluation of the Philox function yields four numbers.
+*/
+class PhiloxRandom
+{
+    public:
+        enum Stream {STREAM_COEFFICIENTS, STREAM_INIT_POSITION, STREAM_INIT_VELOCITY, STREAM_TOPOLOGY, STREAM_BENCHMARK};
+
+        static const size_t coefficients_per_particle = 4; //r1, r2, r3 and one unused
+
+        PhiloxRandom( uint64_t seed_ = 0 );
+
+        void setSeed( uint64_t seed_ );
+        uint64_t getSeed() const;
+
+        void nextRun();
+        uint32_t getRun() const;
+        void setRun( uint32_t run_ );
+
+        double getRandomNumber( uint32_t particle, uint32_t iteration, Stream stream, uint32_t index ) const;
+        void fill( uint32_t particle, uint32_t iteration, Stream stream, size_t count, double *out ) const;
+        void fillCoefficients( uint32_t iteration, size_t num_particles, double *out ) const;
+
+        static void philox4x32( const uint32_t counter[4], const uint32_t key[2], uint32_t out[4] );
+
+    protected:
+        uint32_t key[2];
+        uint64_t seed;
+        uint32_t run;
+};
+
+#endif // PHILOXRANDOM_H
@@ -0,0 +1,526 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROCESSISLANDSWARM_H
+#define PROCESSISLANDSWARM_H
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "islandexchange.h"
+#include "philoxrandom.h"
+#include "subprocess.h"
+#include "swarm.h"
+#include "threadpool.h"
+
+/**
+    Island model with one process per island, for functions which can not be
+    evaluated by several threads of one process, for example because they use
+    a library with global state. Each island is a \ref Swarm which is created
+    and optimized in a child process forked by \ref Subprocess, so every island
+    has its own copy of the function and a crash of one island does not
+    affect the others.
+
+    The islands exchange migrants and the global best over an \ref IslandExchange
+    in shared memory. The migration works like in \ref IslandSwarm. In addition
+    every island publishes its global best at each migration, so the best
+    result is known even if an island crashes later.
+
+    The islands are configured in the parent process by \ref getIsland, but
+    their particles only exist in the child processes. Each call of \ref optimize
+    is therefore a complete run: the swarms are created with the parameters of
+    \ref createSwarm, optimized and the results are copied back via the shared
+    memory. The islands must not use threads, see \ref Swarm::setNumberOfThreads,
+    because threads do not survive a fork. The output of the islands on stdout
+    is forwarded to the stdout of the parent as it arrives, so the output of
+    different islands may be interleaved.
+*/
+template<typename Functor, size_t Dim = Dynamic>
+class ProcessIslandSwarm
+{
+    public:
+        typedef Swarm<Functor, Dim> island_type;
+        enum MigrationTopology {MIGRATION_RING, MIGRATION_FULL, MIGRATION_RANDOM};
+
+        /**
+            \param[in] num_islands  number of islands and processes, zero for the number of online processors
+            \param[in] dim
+        */
+        ProcessIslandSwarm( size_t num_islands = 0, size_t dim = ( Dim == Dynamic ? 2 : Dim ) ) : dimension( dim ), exchange( NULL ), swarm_min( dim ), swarm_max( dim )
+        {
+            if( num_islands == 0 )
+            {
+                num_islands = ThreadPool::getNumberOfCPUs();
+            }
+
+            for( size_t i = 0; i < num_islands; i++ )
+            {
+                islands.push_back( new island_type( dim ) );
+            }
+
+            compare_less = false;
+            migration_interval = 10;
+            migration_topology = MIGRATION_RING;
+            swarm_size = 0;
+            swarm_random = true;
+            results.resize( num_islands );
+            setMailboxCapacity( 4 );
+            setRandomSeed( 0 );
+        }
+
+        virtual ~ProcessIslandSwarm()
+        {
+            delete exchange;
+
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                delete islands[i];
+            }
+        }
+
+        size_t getNumberOfIslands()
+        {
+            return islands.size();
+        }
+
+        /**
+            Gives access to the configuration of a single island. The island has
+            no particles in the parent process.
+        */
+        island_type &getIsland( size_t i )
+        {
+            return *islands[i];
+        }
+
+        void setFunction( const Functor &func )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setFunction( func );
+            }
+        }
+
+        void setCompare( bool comp )
+        {
+            compare_less = comp;
+
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setCompare( comp );
+            }
+        }
+
+        void setCheckAbortCriterion( bool c )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setCheckAbortCriterion( c );
+            }
+        }
+
+        /**
+            Each island gets its own seed derived from \a seed, like in \ref IslandSwarm.
+
+            \param[in] seed
+        */
+        void setRandomSeed( uint64_t seed )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                islands[i]->setRandomSeed( seed + i * 0x9E3779B97F4A7C15ULL );
+            }
+
+            random_generator.setSeed( seed );
+        }
+
+        /**
+            Sets the number of iterations between two migrations, zero disables the migration.
+        */
+        void setMigrationInterval( size_t interval )
+        {
+            migration_interval = interval;
+        }
+
+        size_t getMigrationInterval()
+        {
+            return migration_interval;
+        }
+
+        void setMigrationTopology( MigrationTopology topology )
+        {
+            migration_topology = topology;
+        }
+
+        MigrationTopology getMigrationTopology()
+        {
+            return migration_topology;
+        }
+
+        /**
+            Sets the number of migrants which can wait in the mailbox of one pair
+            of islands. Reallocates the shared memory, must not be called during
+            \ref optimize.
+        */
+        void setMailboxCapacity( size_t capacity )
+        {
+            delete exchange;
+            exchange = NULL;
+            exchange = new IslandExchange( islands.size(), dimension, capacity );
+        }
+
+        /**
+            Sets the parameters the islands are created with at the start of
+            \ref optimize, see \ref Swarm::createSwarm.
+        */
+        void createSwarm( int num, const VectorN<double> &min, const VectorN<double> &max, bool random = true )
+        {
+            if( dimension != min.size() || dimension != max.size() ) {throw RuntimeError( "wrong VectorN dimension" );}
+
+            swarm_size = num;
+            swarm_min = min;
+            swarm_max = max;
+            swarm_random = random;
+        }
+
+        /**
+            Forks one process per island and waits until all of them have exited.
+            Each island runs until it has reached \a max_iterations or its abort
+            criterion. Returns the largest number of iterations of an island which
+            has finished, islands which crashed are reported by \ref getNumberOfFailedIslands.
+
+            \param[in] max_iterations
+        */
+        size_t optimize( size_t max_iterations = 10000 )
+        {
+            for( size_t i = 0; i < islands.size(); i++ )
+            {
+                if( islands[i]->getNumberOfThreads() != 1 ) {throw RuntimeError( "the islands of a ProcessIslandSwarm must not use threads" );}
+            }
+
+            exchange->reset();
+
+            std::vector<IslandEntry> entries( islands.size() );
+            std::vector<Subprocess *> processes;
+
+            try
+            {
+                for( size_t i = 0; i < islands.size(); i++ )
+                {
+                    entries[i].island_swarm = this;
+                    entries[i].island = i;
+                    entries[i].max_iterations = max_iterations;
+                    processes.push_back( new Subprocess( entries[i] ) );
+                }
+            }
+            catch( ... )
+            {
+                for( size_t i = 0; i < processes.size(); i++ )
+                {
+                    delete processes[i];
+                }
+
+                throw;
+            }
+
+            //the pipes are read together, otherwise an island which fills its pipe waits until the islands before it have finished
+            const unsigned int buffer_size = 4096;
+            char buffer[buffer_size];
+            size_t iterations = 0;
+            std::vector<pollfd> fds( processes.size() );
+            size_t num_open = processes.size();
+
+            for( size_t i = 0; i < processes.size(); i++ )
+            {
+                fds[i].fd = processes[i]->getStdoutDescriptor();
+                fds[i].events = POLLIN;
+            }
+
+            while( num_open > 0 )
+            {
+                if( poll( &fds[0], fds.size(), -1 ) < 0 )
+                {
+                    if( errno == EINTR ) {continue;}
+
+                    break;
+                }
+
+                for( size_t i = 0; i < fds.size(); i++ )
+                {
+                    if( fds[i].fd < 0 || fds[i].revents == 0 ) {continue;}
+
+                    ssize_t num = read( fds[i].fd, buffer, buffer_size );
+
+                    if( num > 0 )
+                    {
+                        std::cout.write( buffer, num );
+                    }
+                    else if( num == 0 || errno != EINTR )
+                    {
+                        //waits at once, so the islands see a crashed island as dead instead of a zombie, see IslandExchange
+                        fds[i].fd = -1;
+                        num_open--;
+                        processes[i]->wait();
+                    }
+                }
+            }
+
+            for( size_t i = 0; i < processes.size(); i++ )
+            {
+                int status = processes[i]->wait();
+                delete processes[i];
+
+                IslandResult &result = results[i];
+                result.finished = WIFEXITED( status ) && WEXITSTATUS( status ) == 0 &&
+                                  exchange->getResult( i, result.iterations, result.migrants_accepted );
+
+                if( result.finished )
+                {
+                    iterations = std::max( iterations, result.iterations );
+                }
+                else
+                {
+                    result.iterations = 0;
+                    result.migrants_accepted = 0;
+                }
+            }
+
+            std::cout.flush();
+            return iterations;
+        }
+
+        /**
+            Returns the island with the best global best or -1 if no island
+            has published a result.
+        */
+        long getBestIsland()
+        {
+            VectorN<double> position( dimension );
+            double value;
+            long island;
+            return exchange->readBest( &position[0], value, island ) ? island : -1;
+        }
+
+        double getBestFitness()
+        {
+            VectorN<double> position( dimension );
+            double value = 0.;
+            long island;
+            exchange->readBest( &position[0], value, island );
+            return value;
+        }
+
+        /**
+            Returns the position of the global best of all islands.
+        */
+        VectorN<double> getBestPosition()
+        {
+            VectorN<double> position( dimension );
+            double value;
+            long island;
+
+            if( !exchange->readBest( &position[0], value, island ) )
+            {
+                position.setAll( 0. );
+            }
+
+            return position;
+        }
+
+        /**
+            Returns the number of migrants which replaced a particle during the last \ref optimize.
+        */
+        size_t getNumberOfMigrations()
+        {
+            size_t num = 0;
+
+            for( size_t i = 0; i < results.size(); i++ )
+            {
+                num += results[i].migrants_accepted;
+            }
+
+            return num;
+        }
+
+        /**
+            Returns the number of islands whose process did not finish the last
+            \ref optimize, for example because the function crashed.
+        */
+        size_t getNumberOfFailedIslands()
+        {
+            size_t num = 0;
+
+            for( size_t i = 0; i < results.size(); i++ )
+            {
+                if( !results[i].finished ) {num++;}
+            }
+
+            return num;
+        }
+
+        bool isIslandFinished( size_t i )
+        {
+            return results[i].finished;
+        }
+
+    protected:
+        class IslandEntry : public Subprocess::Entry
+        {
+            public:
+                IslandEntry() : island_swarm( NULL ), island( 0 ), max_iterations( 0 ) {}
+
+                int run()
+                {
+                    return island_swarm->runIsland( island, max_iterations );
+                }
+
+                ProcessIslandSwarm  *island_swarm;
+                size_t              island;
+                size_t              max_iterations;
+        };
+
+        struct IslandResult
+        {
+            IslandResult() : finished( false ), iterations( 0 ), migrants_accepted( 0 ) {}
+
+            bool    finished;
+            size_t  iterations;
+            size_t  migrants_accepted;
+        };
+
+        /**
+            Optimization loop of one island, executed in the child process.
+            Only the mailboxes from and to this island and the global best
+            record are accessed.
+        */
+        int runIsland( size_t id, size_t max_iterations )
+        {
+            island_type &island = *islands[id];
+            std::vector<double> position( dimension );
+            double value;
+            size_t iterations = 0;
+            size_t migrants_accepted = 0;
+
+            island.createSwarm( swarm_size, swarm_min, swarm_max, swarm_random );
+
+            while( iterations < max_iterations )
+            {
+                if( island.getCheckAbortCriterion() && island.checkAbortCriterion() )
+                {
+                    break;
+                }
+
+                island.computeNextStep();
+                iterations++;
+
+                if( migration_interval == 0 || iterations % migration_interval != 0 )
+                {
+                    continue;
+                }
+
+                sendMigrant( id, iterations / migration_interval );
+
+                for( size_t from = 0; from < islands.size(); from++ )
+                {
+                    while( from != id && exchange->receive( from, id, &position[0], value ) )
+                    {
+                        if( island.insertMigrant( &position[0], value ) )
+                        {
+                            migrants_accepted++;
+                        }
+                    }
+                }
+            }
+
+            publishBest( id );
+            exchange->setResult( id, iterations, migrants_accepted );
+            return 0;
+        }
+
+        void publishBest( size_t id )
+        {
+            Particle best = islands[id]->getBestParticle();
+
+            if( best.isValid() )
+            {
+                exchange->publishBest( id, best.getBestPosition().getData(), best.getBestValue(), compare_less ? island_type::a_lt_b : island_type::a_gt_b );
+            }
+        }
+
+        void sendMigrant( size_t from, size_t migration )
+        {
+            publishBest( from );
+
+            Particle best = islands[from]->getBestParticle();
+            size_t num = islands.size();
+
+            if( !best.isValid() || num < 2 ) {return;}
+
+            const double *position = best.getBestPosition().getData();
+
+            switch( migration_topology )
+            {
+                case MIGRATION_RING:
+                    exchange->send( from, ( from + 1 ) % num, position, best.getBestValue() );
+                    break;
+
+                case MIGRATION_FULL:
+                    for( size_t to = 0; to < num; to++ )
+                    {
+                        if( to != from )
+                        {
+                            exchange->send( from, to, position, best.getBestValue() );
+                        }
+                    }
+
+                    break;
+
+                case MIGRATION_RANDOM:
+                {
+                    double r = random_generator.getRandomNumber( from, migration, PhiloxRandom::STREAM_TOPOLOGY, 0 );
+                    size_t to = ( from + 1 + static_cast<size_t>( r * ( num - 1 ) ) ) % num;
+                    exchange->send( from, to, position, best.getBestValue() );
+                }
+                break;
+            }
+        }
+
+        size_t                      dimension;
+        std::vector<island_type *>  islands;
+        std::vector<IslandResult>   results;
+        IslandExchange              *exchange;
+        PhiloxRandom                random_generator;
+        bool                        compare_less;
+        size_t                      migration_interval;
+        MigrationTopology           migration_topology;
+
+        int                         swarm_size;         //parameters of createSwarm
+        VectorN<double>             swarm_min;
+        VectorN<double>             swarm_max;
+        bool                        swarm_random;
+};
+
+#endif // PROCESSISLANDSWARM_H
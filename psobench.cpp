@@ -0,0 +1,603 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmarkfunction.h"
+#include "exception.h"
+#include "function.h"
+#include "particle.h"
+#include "philoxrandom.h"
+#include "swarm.h"
+#include "vectorn.h"
+
+/**
+    Micro benchmarks of the optimizer. Every benchmark is run repeatedly until
+    the minimum time is reached, the time per operation and the throughput are
+    written as JSON. An operation is one vector expression, one particle update
+    or one function evaluation, see the description of each benchmark.
+*/
+
+namespace
+{
+    volatile double sink = 0.; //keeps the compiler from removing the benchmarked code
+
+    double getSeconds()
+    {
+        struct timespec ts;
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    struct Sphere
+    {
+        double operator()( const VectorView<double> &x )
+        {
+            double sum = 0.;
+
+            for( size_t i = 0; i < x.size(); i++ )
+            {
+                sum += x[i] * x[i];
+            }
+
+            return sum;
+        }
+    };
+
+    typedef Swarm<Sphere> BenchSwarm;
+
+    const char *backend_names[] = {"parser", "native", "vm"};
+
+    class Benchmark
+    {
+        public:
+            Benchmark( const std::string &name_, size_t particles_, size_t dimension_, const std::string &method_ = "" ) :
+                name( name_ ), particles( particles_ ), dimension( dimension_ ), method( method_ ) {}
+            virtual ~Benchmark() {}
+
+            virtual void setUp() {}
+            virtual void run() = 0;
+            virtual size_t getOperations() const = 0;      //operations of one call of run
+
+            std::string name;
+            size_t      particles;
+            size_t      dimension;
+            std::string method;
+    };
+
+    /**
+        a = b * w + ( c - d ) * r, one operation is one assignment.
+    */
+    class VectorBenchmark : public Benchmark
+    {
+        public:
+            VectorBenchmark( size_t dim ) : Benchmark( "vectorn_expression", 0, dim ), a( dim ), b( dim ), c( dim ), d( dim ) {}
+
+            void setUp()
+            {
+                for( size_t i = 0; i < dimension; i++ )
+                {
+                    b[i] = i;
+                    c[i] = 2. * i;
+                    d[i] = 0.5 * i;
+                }
+            }
+
+            void run()
+            {
+                for( size_t i = 0; i < repetitions; i++ )
+                {
+                    a = b * 0.7 + ( c - d ) * 1.3;
+                    b[0] = a[dimension - 1] * 1e-3;
+                }
+
+                sink = sink + a[0];
+            }
+
+            size_t getOperations() const
+            {
+                return repetitions;
+            }
+
+        protected:
+            static const size_t repetitions = 1000;
+            VectorN<double> a, b, c, d;
+    };
+
+    /**
+        Particle::calcNewGlobal for all particles of a store, one operation is one particle update.
+    */
+    class ParticleUpdateBenchmark : public Benchmark
+    {
+        public:
+            ParticleUpdateBenchmark( size_t num, size_t dim ) : Benchmark( "particle_calc_new_global", num, dim ), store( dim ), global_best( dim ) {}
+
+            void setUp()
+            {
+                PhiloxRandom random( 1 );
+                store.reserve( particles );
+
+                for( size_t i = 0; i < particles; i++ )
+                {
+                    size_t id = store.add();
+                    random.fill( id, 0, PhiloxRandom::STREAM_INIT_POSITION, dimension, store.getPosition( id ) );
+                    random.fill( id, 0, PhiloxRandom::STREAM_INIT_VELOCITY, dimension, store.getVelocity( id ) );
+                    memcpy( store.getBestPosition( id ), store.getPosition( id ), dimension * sizeof( double ) );
+                }
+
+                global_best.setAll( 0.5 );
+                coefficients.resize( particles * PhiloxRandom::coefficients_per_particle );
+                random.fillCoefficients( 0, particles, &coefficients[0] );
+            }
+
+            void run()
+            {
+                for( size_t i = 0; i < particles; i++ )
+                {
+                    Particle( &store, i ).calcNewGlobal( 2., 1.49, 1.49, 0.72, global_best, &coefficients[i * PhiloxRandom::coefficients_per_particle] );
+                }
+
+                sink = sink + store.getPosition( 0 )[0];
+            }
+
+            size_t getOperations() const
+            {
+                return particles;
+            }
+
+        protected:
+            ParticleStore       store;
+            VectorN<double>     global_best;
+            std::vector<double> coefficients;
+    };
+
+    /**
+        Function::operator() or Function::evaluateBatch of a sum of squares
+        with the given backend, one operation is one evaluation.
+    */
+    class FunctionBenchmark : public Benchmark
+    {
+        public:
+            FunctionBenchmark( size_t num, size_t dim, bool batch_, Function::Backend backend ) :
+                Benchmark( batch_ ? "function_evaluate_batch" : "function_call", num, dim, backend_names[backend] ), batch( batch_ )
+            {
+                function.setBackend( backend );
+            }
+
+            void setUp()
+            {
+                std::stringstream expression;
+
+                for( size_t i = 0; i < dimension; i++ )
+                {
+                    expression << ( i ? "+" : "" ) << "x" << i + 1 << "*x" << i + 1;
+                }
+
+                function.setExpression( expression.str() );
+
+                PhiloxRandom random( 2 );
+                positions.resize( particles * dimension );
+                values.resize( particles );
+                random.fill( 0, 0, PhiloxRandom::STREAM_INIT_POSITION, positions.size(), &positions[0] );
+            }
+
+            void run()
+            {
+                if( batch )
+                {
+                    function.evaluateBatch( &positions[0], particles, dimension, &values[0] );
+                }
+                else
+                {
+                    for( size_t i = 0; i < particles; i++ )
+                    {
+                        values[i] = function( VectorView<double>( &positions[i * dimension], dimension ) );
+                    }
+                }
+
+                sink = sink + values[particles - 1];
+            }
+
+            size_t getOperations() const
+            {
+                return particles;
+            }
+
+        protected:
+            bool                batch;
+            Function            function;
+            std::vector<double> positions;
+            std::vector<double> values;
+    };
+
+    /**
+        Batch evaluation of a natively compiled \ref BenchmarkFunction, the
+        counterpart of function_evaluate_batch without the parser. One
+        operation is one function evaluation.
+    */
+    class BenchmarkFunctionBenchmark : public Benchmark
+    {
+        public:
+            BenchmarkFunctionBenchmark( size_t num, size_t dim, BenchmarkFunction::Type type ) :
+                Benchmark( "benchmark_function", num, dim, BenchmarkFunction::getName( type ) ), function( type, dim ) {}
+
+            void setUp()
+            {
+                PhiloxRandom random( 2 );
+                positions.resize( particles * dimension );
+                values.resize( particles );
+                random.fill( 0, 0, PhiloxRandom::STREAM_INIT_POSITION, positions.size(), &positions[0] );
+            }
+
+            void run()
+            {
+                function.evaluateBatch( &positions[0], particles, dimension, &values[0] );
+                sink = sink + values[particles - 1];
+            }
+
+            size_t getOperations() const
+            {
+                return particles;
+            }
+
+        protected:
+            BenchmarkFunction   function;
+            std::vector<double> positions;
+            std::vector<double> values;
+    };
+
+    /**
+        Benchmarks on a whole swarm: the neighbour search of GLOBAL_LOCAL_BEST,
+        the global best search and complete iterations. One operation is the
+        processing of one particle.
+    */
+    class SwarmBenchmark : public Benchmark
+    {
+        public:
+            enum Kind {FIND_BEST_NEIGHBOUR, FIND_GLOBAL_BEST, COMPUTE_NEXT_STEP};
+
+            SwarmBenchmark( Kind kind_, size_t num, size_t dim, const std::string &method_, BenchSwarm::ComutationMethode cm, size_t threads_ ) :
+                Benchmark( getName( kind_ ), num, dim, method_ ), kind( kind_ ), computation_methode( cm ), threads( threads_ ), swarm( dim ) {}
+
+            void setUp()
+            {
+                VectorN<double> min( dimension ), max( dimension );
+                min.setAll( -5. );
+                max.setAll( 5. );
+
+                swarm.setCompare( true );
+                swarm.setCheckAbortCriterion( false );
+                swarm.setNumberOfThreads( threads );
+                swarm.setComputationMethode( computation_methode );
+                swarm.setParameterW( 0.72 );
+                swarm.setParameterC1( 1.49 );
+                swarm.setParameterC2( 1.49 );
+                swarm.setParameterC3( 1.49 );
+                swarm.setNeighbourRadius( 1. );
+                swarm.setMaxVelocity( 2. );
+                swarm.setRandomSeed( 3 );
+                swarm.createSwarm( particles, min, max, true );
+            }
+
+            void run()
+            {
+                switch( kind )
+                {
+                    case FIND_BEST_NEIGHBOUR:
+                        swarm.findBestNeighbours();
+                        break;
+
+                    case FIND_GLOBAL_BEST:
+                        swarm.findGlobalBest();
+                        break;
+
+                    case COMPUTE_NEXT_STEP:
+                        swarm.computeNextStep();
+                        break;
+                }
+
+                sink = sink + swarm.getBestFitness();
+            }
+
+            size_t getOperations() const
+            {
+                return particles;
+            }
+
+            static std::string getName( Kind kind )
+            {
+                switch( kind )
+                {
+                    case FIND_BEST_NEIGHBOUR: return "swarm_find_best_neighbour";
+                    case FIND_GLOBAL_BEST: return "swarm_find_global_best";
+                    default: return "swarm_compute_next_step";
+                }
+            }
+
+        protected:
+            Kind                            kind;
+            BenchSwarm::ComutationMethode   computation_methode;
+            size_t                          threads;
+            BenchSwarm                      swarm;
+    };
+
+    struct Result
+    {
+        std::string name;
+        size_t      particles;
+        size_t      dimension;
+        std::string method;
+        size_t      runs;
+        size_t      operations;
+        double      seconds;
+    };
+
+    /**
+        Calls run until \a min_time seconds have passed, after one call which
+        is not measured.
+    */
+    Result measure( Benchmark &benchmark, double min_time )
+    {
+        benchmark.setUp();
+        benchmark.run();
+
+        Result result;
+        result.name = benchmark.name;
+        result.particles = benchmark.particles;
+        result.dimension = benchmark.dimension;
+        result.method = benchmark.method;
+        result.runs = 0;
+
+        double start = getSeconds(), now = start;
+
+        do
+        {
+            benchmark.run();
+            result.runs++;
+            now = getSeconds();
+        }
+        while( now - start < min_time );
+
+        result.seconds = now - start;
+        result.operations = result.runs * benchmark.getOperations();
+        return result;
+    }
+
+    std::vector<size_t> toList( const char *arg )
+    {
+        std::vector<size_t> values;
+        std::stringstream sstream( arg );
+        std::string item;
+
+        while( std::getline( sstream, item, ',' ) )
+        {
+            char *end = NULL;
+            unsigned long value = strtoul( item.c_str(), &end, 10 );
+
+            if( item.empty() || *end != '\0' || value == 0 ) {throw RuntimeError( "invalid list: " + std::string( arg ) );}
+
+            values.push_back( value );
+        }
+
+        return values;
+    }
+
+    size_t toSize( const char *arg, const char *option )
+    {
+        char *end = NULL;
+        unsigned long value = strtoul( arg, &end, 10 );
+
+        if( end == arg || *end != '\0' || arg[0] == '-' ) {throw RuntimeError( std::string( "invalid number for --" ) + option + ": " + arg );}
+
+        return value;
+    }
+
+    double toSeconds( const char *arg, const char *option )
+    {
+        char *end = NULL;
+        double value = strtod( arg, &end );
+
+        if( end == arg || *end != '\0' || !( value > 0. && value < HUGE_VAL ) ) {throw RuntimeError( std::string( "invalid time for --" ) + option + ": " + arg );}
+
+        return value;
+    }
+
+    void writeJson( std::ostream &os, const std::vector<Result> &results, double min_time, size_t threads )
+    {
+        char buffer[64];
+
+        os << "{\n  \"benchmark\": \"pso_bench\",\n  \"version\": 1,\n  \"timestamp\": " << static_cast<long>( time( NULL ) )
+           << ",\n  \"min_time\": " << min_time << ",\n  \"threads\": " << threads << ",\n  \"results\": [";
+
+        for( size_t i = 0; i < results.size(); i++ )
+        {
+            const Result &r = results[i];
+            os << ( i ? "," : "" ) << "\n    {\"name\": \"" << r.name << "\", \"particles\": " << r.particles << ", \"dimension\": " << r.dimension;
+
+            if( !r.method.empty() )
+            {
+                os << ", \"method\": \"" << r.method << "\"";
+            }
+
+            snprintf( buffer, sizeof( buffer ), "%.4g", r.seconds * 1e9 / r.operations );
+            os << ", \"runs\": " << r.runs << ", \"operations\": " << r.operations << ", \"ns_per_op\": " << buffer;
+            snprintf( buffer, sizeof( buffer ), "%.6g", r.operations / r.seconds );
+            os << ", \"ops_per_second\": " << buffer << "}";
+        }
+
+        os << "\n  ]\n}" << std::endl;
+    }
+
+    void printUsage( std::ostream &os )
+    {
+        os << "Usage: pso_bench [options]\n"
+           "  -p, --particles LIST    comma separated particle counts (default 100,1000,10000)\n"
+           "  -d, --dimensions LIST   comma separated dimensions (default 2,10,30)\n"
+           "  -t, --threads N         evaluation threads of the swarm benchmarks (default 1)\n"
+           "  -m, --min-time SECONDS  minimum measuring time of each benchmark (default 0.2)\n"
+           "  -f, --filter TEXT       only run benchmarks whose name contains TEXT\n"
+           "  -o, --output FILE       write the JSON result to FILE instead of stdout\n"
+           "  -h, --help\n";
+    }
+}
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        std::vector<size_t> particle_counts, dimensions;
+        size_t threads = 1;
+        double min_time = 0.2;
+        std::string filter, output;
+
+        particle_counts.push_back( 100 );
+        particle_counts.push_back( 1000 );
+        particle_counts.push_back( 10000 );
+        dimensions.push_back( 2 );
+        dimensions.push_back( 10 );
+        dimensions.push_back( 30 );
+
+        const struct option long_options[] =
+        {
+            {"particles",  required_argument, NULL, 'p'},
+            {"dimensions", required_argument, NULL, 'd'},
+            {"threads",    required_argument, NULL, 't'},
+            {"min-time",   required_argument, NULL, 'm'},
+            {"filter",     required_argument, NULL, 'f'},
+            {"output",     required_argument, NULL, 'o'},
+            {"help",       no_argument,       NULL, 'h'},
+            {NULL,         0,                 NULL, 0}
+        };
+
+        int option;
+
+        while( ( option = getopt_long( argc, argv, "p:d:t:m:f:o:h", long_options, NULL ) ) != -1 )
+        {
+            switch( option )
+            {
+                case 'p': particle_counts = toList( optarg ); break;
+                case 'd': dimensions = toList( optarg ); break;
+                case 't': threads = toSize( optarg, "threads" ); break;
+                case 'm': min_time = toSeconds( optarg, "min-time" ); break;
+                case 'f': filter = optarg; break;
+                case 'o': output = optarg; break;
+
+                case 'h':
+                    printUsage( std::cout );
+                    return 0;
+
+                default:
+                    printUsage( std::cerr );
+                    return 2;
+            }
+        }
+
+        const char *method_names[] = {"global", "local", "ring", "vonneumann", "random", "smallworld"};
+        const BenchSwarm::ComutationMethode methods[] = {BenchSwarm::GLOBAL_BEST, BenchSwarm::GLOBAL_LOCAL_BEST, BenchSwarm::RING,
+                                                         BenchSwarm::VON_NEUMANN, BenchSwarm::RANDOM_K, BenchSwarm::SMALL_WORLD
+                                                        };
+        const size_t num_methods = sizeof( methods ) / sizeof( methods[0] );
+
+        std::vector<Benchmark *> benchmarks;
+
+        for( size_t d = 0; d < dimensions.size(); d++ )
+        {
+            benchmarks.push_back( new VectorBenchmark( dimensions[d] ) );
+
+            for( size_t p = 0; p < particle_counts.size(); p++ )
+            {
+                size_t num = particle_counts[p], dim = dimensions[d];
+
+                benchmarks.push_back( new ParticleUpdateBenchmark( num, dim ) );
+                benchmarks.push_back( new FunctionBenchmark( num, dim, false, Function::BACKEND_PARSER ) );
+
+                for( int b = Function::BACKEND_PARSER; b <= Function::BACKEND_VM; b++ )
+                {
+                    benchmarks.push_back( new FunctionBenchmark( num, dim, true, static_cast<Function::Backend>( b ) ) );
+                }
+
+                for( int t = 0; t < BenchmarkFunction::NUMBER_OF_TYPES; t++ )
+                {
+                    benchmarks.push_back( new BenchmarkFunctionBenchmark( num, dim, static_cast<BenchmarkFunction::Type>( t ) ) );
+                }
+
+                benchmarks.push_back( new SwarmBenchmark( SwarmBenchmark::FIND_BEST_NEIGHBOUR, num, dim, "local", BenchSwarm::GLOBAL_LOCAL_BEST, threads ) );
+                benchmarks.push_back( new SwarmBenchmark( SwarmBenchmark::FIND_GLOBAL_BEST, num, dim, "global", BenchSwarm::GLOBAL_BEST, threads ) );
+
+                for( size_t m = 0; m < num_methods; m++ )
+                {
+                    benchmarks.push_back( new SwarmBenchmark( SwarmBenchmark::COMPUTE_NEXT_STEP, num, dim, method_names[m], methods[m], threads ) );
+                }
+            }
+        }
+
+        std::vector<Result> results;
+
+        for( size_t i = 0; i < benchmarks.size(); i++ )
+        {
+            if( filter.empty() || benchmarks[i]->name.find( filter ) != std::string::npos )
+            {
+                Result result = measure( *benchmarks[i], min_time );
+                results.push_back( result );
+
+                std::cerr << result.name << " particles=" << result.particles << " dimension=" << result.dimension
+                          << ( result.method.empty() ? "" : " method=" + result.method ) << ": "
+                          << result.seconds * 1e9 / result.operations << " ns/op" << std::endl;
+            }
+
+            delete benchmarks[i];
+        }
+
+        if( output.empty() )
+        {
+            writeJson( std::cout, results, min_time, threads );
+        }
+        else
+        {
+            std::ofstream file( output.c_str() );
+
+            if( !file ) {throw RuntimeError( "unable to open " + output );}
+
+            writeJson( file, results, min_time, threads );
+        }
+    }
+    catch( Exception &err )
+    {
+        std::cerr << "pso_bench: " << err.getMessage() << std::endl;
+        return 1;
+    }
+    catch( std::exception &err )
+    {
+        std::cerr << "pso_bench: " << err.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
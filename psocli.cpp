@@ -0,0 +1,551 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "exception.h"
+#include "fitnesscache.h"
+#include "function.h"
+#include "swarm.h"
+
+/**
+    Headless command line interface: optimizes one function with a \ref Swarm
+    and prints the result as JSON (default) or as key value lines. Neither Qt
+    nor OpenGL is used.
+*/
+
+namespace
+{
+    typedef Swarm<CachedFunction<Function> > CliSwarm;
+
+    /**
+        Deletes the owned object when it goes out of scope, so the trajectory
+        is closed and the cache is freed on every path out of main.
+    */
+    template<class T>
+    class ScopedPointer
+    {
+        public:
+            ScopedPointer() : pointer( NULL ) {}
+
+            ~ScopedPointer()
+            {
+                delete pointer;
+            }
+
+            void reset( T *pointer_ )
+            {
+                delete pointer;
+                pointer = pointer_;
+            }
+
+            T *get() const
+            {
+                return pointer;
+            }
+
+            T *operator->() const
+            {
+                return pointer;
+            }
+
+        private:
+            ScopedPointer( const ScopedPointer &other ) {}
+            ScopedPointer &operator=( const ScopedPointer &other ) {return *this;}
+
+            T *pointer;
+    };
+
+    enum OptionId
+    {
+        OPTION_MIN = 256, OPTION_MAX, OPTION_MAXIMIZE, OPTION_C1, OPTION_C2, OPTION_C3, OPTION_W, OPTION_RADIUS, OPTION_MAX_VELOCITY,
+        OPTION_AUTO_VELOCITY, OPTION_NEIGHBOURS, OPTION_REWIRING, OPTION_ABORT_ITERATIONS, OPTION_ASYNC, OPTION_CHECKPOINT,
+        OPTION_CHECKPOINT_INTERVAL, OPTION_RESUME, OPTION_TRAJECTORY, OPTION_TRAJECTORY_FRAMES, OPTION_FORMAT, OPTION_BACKEND,
+        OPTION_CACHE, OPTION_CACHE_MEMORY
+    };
+
+    const struct option long_options[] =
+    {
+        {"expression",          required_argument, NULL, 'e'},
+        {"listing",             required_argument, NULL, 'l'},
+        {"dimension",           required_argument, NULL, 'd'},
+        {"min",                 required_argument, NULL, OPTION_MIN},
+        {"max",                 required_argument, NULL, OPTION_MAX},
+        {"particles",           required_argument, NULL, 'n'},
+        {"iterations",          required_argument, NULL, 'i'},
+        {"method",              required_argument, NULL, 'm'},
+        {"maximize",            no_argument,       NULL, OPTION_MAXIMIZE},
+        {"c1",                  required_argument, NULL, OPTION_C1},
+        {"c2",                  required_argument, NULL, OPTION_C2},
+        {"c3",                  required_argument, NULL, OPTION_C3},
+        {"w",                   required_argument, NULL, OPTION_W},
+        {"radius",              required_argument, NULL, OPTION_RADIUS},
+        {"max-velocity",        required_argument, NULL, OPTION_MAX_VELOCITY},
+        {"auto-velocity",       no_argument,       NULL, OPTION_AUTO_VELOCITY},
+        {"neighbours",          required_argument, NULL, OPTION_NEIGHBOURS},
+        {"rewiring",            required_argument, NULL, OPTION_REWIRING},
+        {"abort-iterations",    required_argument, NULL, OPTION_ABORT_ITERATIONS},
+        {"threads",             required_argument, NULL, 't'},
+        {"seed",                required_argument, NULL, 's'},
+        {"async",               no_argument,       NULL, OPTION_ASYNC},
+        {"checkpoint",          required_argument, NULL, OPTION_CHECKPOINT},
+        {"checkpoint-interval", required_argument, NULL, OPTION_CHECKPOINT_INTERVAL},
+        {"resume",              required_argument, NULL, OPTION_RESUME},
+        {"trajectory",          required_argument, NULL, OPTION_TRAJECTORY},
+        {"trajectory-frames",   required_argument, NULL, OPTION_TRAJECTORY_FRAMES},
+        {"format",              required_argument, NULL, OPTION_FORMAT},
+        {"backend",             required_argument, NULL, OPTION_BACKEND},
+        {"cache",               required_argument, NULL, OPTION_CACHE},
+        {"cache-memory",        required_argument, NULL, OPTION_CACHE_MEMORY},
+        {"help",                no_argument,       NULL, 'h'},
+        {NULL,                  0,                 NULL, 0}
+    };
+
+    void printUsage( std::ostream &os )
+    {
+        os << "Usage: pso-cli [options]\n"
+           "  -e, --expression EXPR         function of the variables x1, x2, ...\n"
+           "  -l, --listing FILE            listing with constants and one expression, - for stdin\n"
+           "  -d, --dimension N             default: number of variables of the expression\n"
+           "      --min VALUES              lower bound of the initial positions, one value or a\n"
+           "                                comma separated list (default -10)\n"
+           "      --max VALUES              upper bound of the initial positions (default 10)\n"
+           "  -n, --particles N             default 100\n"
+           "  -i, --iterations N            iteration budget, default 1000\n"
+           "  -m, --method NAME             global, local, ring, vonneumann, random or smallworld\n"
+           "      --maximize                search the maximum instead of the minimum\n"
+           "      --c1 X, --c2 X, --c3 X    acceleration coefficients\n"
+           "      --w X                     inertia weight\n"
+           "      --radius X                neighbour radius of the method local\n"
+           "      --max-velocity X\n"
+           "      --auto-velocity\n"
+           "      --neighbours K            neighbours of the topology methods\n"
+           "      --rewiring P              rewiring probability of the method smallworld\n"
+           "      --abort-iterations N      stop if the best value has not changed for N iterations\n"
+           "  -t, --threads N               evaluation threads, 0 for all processors (default 1)\n"
+           "  -s, --seed N                  seed of the random numbers\n"
+           "      --async                   asynchronous steady state execution\n"
+           "      --checkpoint FILE         write checkpoints to FILE\n"
+           "      --checkpoint-interval N   iterations between two checkpoints (default 100)\n"
+           "      --resume FILE             continue the run stored in the checkpoint FILE, the\n"
+           "                                parameters of the checkpoint replace the options\n"
+           "      --trajectory FILE         record all particles of each iteration to FILE\n"
+           "      --trajectory-frames N     capacity of the trajectory file, rounded up to a\n"
+           "                                multiple of 64. Later frames are dropped and\n"
+           "                                reported (default 262144)\n"
+           "      --format json|text        output format (default json)\n"
+           "      --backend NAME            evaluation of the expression: parser, native or vm,\n"
+           "                                native falls back to parser without a compiler\n"
+           "                                (default parser)\n"
+           "      --cache TOL               cache the fitness of positions rounded to multiples\n"
+           "                                of TOL, 0 caches exact positions only\n"
+           "      --cache-memory MB         memory of the fitness cache (default 64)\n"
+           "  -h, --help\n";
+    }
+
+    double toDouble( const char *arg, const char *option )
+    {
+        char *end = NULL;
+        double value = strtod( arg, &end );
+
+        if( end == arg || *end != '\0' ) {throw RuntimeError( std::string( "invalid number for --" ) + option + ": " + arg );}
+
+        return value;
+    }
+
+    const char *backend_names[] = {"parser", "native", "vm"};
+    const size_t num_backends = sizeof( backend_names ) / sizeof( backend_names[0] );
+
+    Function::Backend toBackend( const char *arg )
+    {
+        for( size_t i = 0; i < num_backends; i++ )
+        {
+            if( std::string( arg ) == backend_names[i] ) {return static_cast<Function::Backend>( i );}
+        }
+
+        throw RuntimeError( std::string( "unknown backend: " ) + arg );
+    }
+
+    size_t toSize( const char *arg, const char *option )
+    {
+        char *end = NULL;
+        unsigned long long value = strtoull( arg, &end, 10 );
+
+        if( end == arg || *end != '\0' || arg[0] == '-' ) {throw RuntimeError( std::string( "invalid number for --" ) + option + ": " + arg );}
+
+        return value;
+    }
+
+    std::vector<double> toList( const char *arg, const char *option )
+    {
+        std::vector<double> values;
+        std::stringstream sstream( arg );
+        std::string item;
+
+        while( std::getline( sstream, item, ',' ) )
+        {
+            values.push_back( toDouble( item.c_str(), option ) );
+        }
+
+        if( values.empty() ) {throw RuntimeError( std::string( "missing values for --" ) + option );}
+
+        return values;
+    }
+
+    /**
+        Expands a single value to \a dim values.
+    */
+    VectorN<double> toBound( const std::vector<double> &values, size_t dim, const char *option )
+    {
+        if( values.size() != 1 && values.size() != dim ) {throw RuntimeError( std::string( "--" ) + option + " needs one value or one value per dimension" );}
+
+        VectorN<double> bound( dim );
+
+        for( size_t i = 0; i < dim; i++ )
+        {
+            bound[i] = values.size() == 1 ? values[0] : values[i];
+        }
+
+        return bound;
+    }
+
+    CliSwarm::ComutationMethode toMethod( const std::string &name )
+    {
+        if( name == "global" ) {return CliSwarm::GLOBAL_BEST;}
+
+        if( name == "local" ) {return CliSwarm::GLOBAL_LOCAL_BEST;}
+
+        if( name == "ring" ) {return CliSwarm::RING;}
+
+        if( name == "vonneumann" ) {return CliSwarm::VON_NEUMANN;}
+
+        if( name == "random" ) {return CliSwarm::RANDOM_K;}
+
+        if( name == "smallworld" ) {return CliSwarm::SMALL_WORLD;}
+
+        throw RuntimeError( "unknown method: " + name );
+    }
+
+    std::string readListing( const std::string &filename )
+    {
+        std::stringstream sstream;
+
+        if( filename == "-" )
+        {
+            sstream << std::cin.rdbuf();
+        }
+        else
+        {
+            std::ifstream file( filename.c_str() );
+
+            if( !file ) {throw RuntimeError( "unable to open listing " + filename );}
+
+            sstream << file.rdbuf();
+        }
+
+        //the lines of a listing are separated by semicolons
+        std::string listing = sstream.str();
+        std::replace( listing.begin(), listing.end(), '\n', ';' );
+        return listing;
+    }
+
+    std::string toJsonString( const std::string &str )
+    {
+        std::string result = "\"";
+
+        for( size_t i = 0; i < str.size(); i++ )
+        {
+            unsigned char c = str[i];
+
+            if( c == '"' || c == '\\' )
+            {
+                result += '\\';
+                result += c;
+            }
+            else if( c < 0x20 )
+            {
+                char buffer[8];
+                snprintf( buffer, sizeof( buffer ), "\\u%04x", c );
+                result += buffer;
+            }
+            else
+            {
+                result += c;
+            }
+        }
+
+        return result + "\"";
+    }
+
+    std::string toNumber( double value )
+    {
+        //JSON has no representation for inf and nan
+        if( value != value || value - value != 0. ) {return "null";}
+
+        char buffer[32];
+        snprintf( buffer, sizeof( buffer ), "%.17g", value );
+        return buffer;
+    }
+
+    double getSeconds()
+    {
+        struct timespec ts;
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        std::string expression, listing, resume, checkpoint, trajectory, format = "json";
+        Function::Backend backend = Function::BACKEND_PARSER;
+        size_t dimension = 0, particles = 100, iterations = 1000, threads = 1, checkpoint_interval = 100, abort_iterations = 0, trajectory_frames = 262144;
+        std::vector<double> min_values( 1, -10. ), max_values( 1, 10. );
+        double cache_tolerance = -1.;
+        size_t cache_memory = 64;
+
+        //declared before the swarm, whose threads use them until it is destroyed
+        ScopedPointer<FitnessCache> cache;
+        ScopedPointer<TrajectoryRecorder> recorder;
+        CliSwarm swarm;
+
+        swarm.setCompare( true );
+        swarm.setCheckAbortCriterion( false );
+
+        int option;
+
+        while( ( option = getopt_long( argc, argv, "e:l:d:n:i:m:t:s:h", long_options, NULL ) ) != -1 )
+        {
+            switch( option )
+            {
+                case 'e': expression = optarg; break;
+                case 'l': listing = optarg; break;
+                case 'd': dimension = toSize( optarg, "dimension" ); break;
+                case OPTION_MIN: min_values = toList( optarg, "min" ); break;
+                case OPTION_MAX: max_values = toList( optarg, "max" ); break;
+                case 'n': particles = toSize( optarg, "particles" ); break;
+                case 'i': iterations = toSize( optarg, "iterations" ); break;
+                case 'm': swarm.setComputationMethode( toMethod( optarg ) ); break;
+                case OPTION_MAXIMIZE: swarm.setCompare( false ); break;
+                case OPTION_C1: swarm.setParameterC1( toDouble( optarg, "c1" ) ); break;
+                case OPTION_C2: swarm.setParameterC2( toDouble( optarg, "c2" ) ); break;
+                case OPTION_C3: swarm.setParameterC3( toDouble( optarg, "c3" ) ); break;
+                case OPTION_W: swarm.setParameterW( toDouble( optarg, "w" ) ); break;
+                case OPTION_RADIUS: swarm.setNeighbourRadius( toDouble( optarg, "radius" ) ); break;
+                case OPTION_MAX_VELOCITY: swarm.setMaxVelocity( toDouble( optarg, "max-velocity" ) ); break;
+                case OPTION_AUTO_VELOCITY: swarm.setAutoVelocity( true ); break;
+                case OPTION_NEIGHBOURS: swarm.setTopologyNeighbours( toSize( optarg, "neighbours" ) ); break;
+                case OPTION_REWIRING: swarm.setTopologyRewiring( toDouble( optarg, "rewiring" ) ); break;
+                case OPTION_ABORT_ITERATIONS: abort_iterations = toSize( optarg, "abort-iterations" ); break;
+                case 't': threads = toSize( optarg, "threads" ); break;
+                case 's': swarm.setRandomSeed( toSize( optarg, "seed" ) ); break;
+                case OPTION_ASYNC: swarm.setExecutionMode( CliSwarm::ASYNCHRONOUS ); break;
+                case OPTION_CHECKPOINT: checkpoint = optarg; break;
+                case OPTION_CHECKPOINT_INTERVAL: checkpoint_interval = toSize( optarg, "checkpoint-interval" ); break;
+                case OPTION_RESUME: resume = optarg; break;
+                case OPTION_TRAJECTORY: trajectory = optarg; break;
+                case OPTION_TRAJECTORY_FRAMES: trajectory_frames = toSize( optarg, "trajectory-frames" ); break;
+                case OPTION_FORMAT: format = optarg; break;
+                case OPTION_BACKEND: backend = toBackend( optarg ); break;
+                case OPTION_CACHE: cache_tolerance = toDouble( optarg, "cache" ); break;
+                case OPTION_CACHE_MEMORY: cache_memory = toSize( optarg, "cache-memory" ); break;
+
+                case 'h':
+                    printUsage( std::cout );
+                    return 0;
+
+                default:
+                    printUsage( std::cerr );
+                    return 2;
+            }
+        }
+
+        if( optind < argc ) {throw RuntimeError( std::string( "unexpected argument: " ) + argv[optind] );}
+
+        if( expression.empty() == listing.empty() ) {throw RuntimeError( "exactly one of --expression and --listing is required" );}
+
+        if( format != "json" && format != "text" ) {throw RuntimeError( "unknown format: " + format );}
+
+        if( !listing.empty() )
+        {
+            expression = Function::reduceListingToExpression( readListing( listing ) );
+        }
+
+        Function function;
+        function.setBackend( backend );
+        function.setExpression( expression );
+
+        if( dimension == 0 )
+        {
+            dimension = std::max<size_t>( function.getNumberOfVariablesInExpression(), 1 );
+        }
+
+        if( dimension < function.getNumberOfVariablesInExpression() ) {throw RuntimeError( "the dimension is smaller than the number of variables of the expression" );}
+
+        if( particles == 0 ) {throw RuntimeError( "at least one particle is required" );}
+
+        if( cache_tolerance >= 0. )
+        {
+            cache.reset( new FitnessCache( dimension, cache_tolerance, cache_memory << 20 ) );
+        }
+
+        swarm.setDimension( dimension );
+        swarm.setFunction( CachedFunction<Function>( function, cache.get() ) );
+        swarm.setNumberOfThreads( threads );
+
+        if( abort_iterations > 0 )
+        {
+            swarm.setCheckAbortCriterion( true );
+            swarm.setAbortCriterionIterations( abort_iterations );
+        }
+
+        if( !trajectory.empty() )
+        {
+            //the index of the file has one entry per chunk
+            size_t frames_per_chunk = 64;
+            recorder.reset( new TrajectoryRecorder( trajectory, frames_per_chunk, ( trajectory_frames + frames_per_chunk - 1 ) / frames_per_chunk ) );
+            swarm.setTrajectoryRecorder( recorder.get() );
+        }
+
+        double start = getSeconds();
+
+        if( !resume.empty() )
+        {
+            swarm.loadCheckpoint( resume );
+        }
+        else
+        {
+            swarm.createSwarm( particles, toBound( min_values, dimension, "min" ), toBound( max_values, dimension, "max" ), true );
+        }
+
+        if( !checkpoint.empty() )
+        {
+            swarm.setCheckpoint( checkpoint, checkpoint_interval );
+        }
+
+        //the loop of Swarm::optimize, but reaching the budget is a regular result
+        bool converged = false;
+        size_t first_iteration = swarm.getIterationStep();
+
+        while( swarm.getIterationStep() - first_iteration < iterations )
+        {
+            if( swarm.getCheckAbortCriterion() && swarm.checkAbortCriterion() )
+            {
+                converged = true;
+                break;
+            }
+
+            swarm.computeNextStep();
+        }
+
+        if( !checkpoint.empty() )
+        {
+            swarm.flushCheckpoint();
+            swarm.saveCheckpoint( checkpoint );
+        }
+
+        std::stringstream trajectory_json, trajectory_text;
+
+        if( recorder.get() )
+        {
+            swarm.setTrajectoryRecorder( NULL );
+            recorder->close();
+            trajectory_json << ",\"trajectory_frames\":" << recorder->getNumberOfRecorded() << ",\"trajectory_dropped\":" << recorder->getNumberOfDropped();
+            trajectory_text << "trajectory_frames " << recorder->getNumberOfRecorded() << "\n" << "trajectory_dropped " << recorder->getNumberOfDropped() << "\n";
+        }
+
+        double seconds = getSeconds() - start;
+        Particle best = swarm.getBestParticle();
+        std::stringstream position, cache_json, cache_text;
+
+        if( cache.get() )
+        {
+            cache_json << ",\"cache_hits\":" << cache->getNumberOfHits() << ",\"cache_misses\":" << cache->getNumberOfMisses()
+                       << ",\"cache_evictions\":" << cache->getNumberOfEvictions();
+            cache_text << "cache_hits " << cache->getNumberOfHits() << "\n" << "cache_misses " << cache->getNumberOfMisses() << "\n"
+                       << "cache_evictions " << cache->getNumberOfEvictions() << "\n";
+        }
+
+        for( size_t i = 0; i < dimension; i++ )
+        {
+            position << ( i ? ( format == "json" ? "," : " " ) : "" ) << toNumber( best.getBestPosition()[i] );
+        }
+
+        if( format == "json" )
+        {
+            std::cout << "{\"expression\":" << toJsonString( expression )
+                      << ",\"backend\":\"" << backend_names[function.getActiveBackend()] << "\""
+                      << ",\"operations_parsed\":" << function.getNumberOfParsedOperations()
+                      << ",\"operations_optimized\":" << function.getNumberOfOperations()
+                      << ",\"dimension\":" << dimension
+                      << ",\"particles\":" << swarm.m_swarm.size()
+                      << ",\"iterations\":" << swarm.getIterationStep()
+                      << ",\"converged\":" << ( converged ? "true" : "false" )
+                      << ",\"best_fitness\":" << toNumber( swarm.getBestFitness() )
+                      << ",\"best_position\":[" << position.str() << "]"
+                      << ",\"average_fitness\":" << toNumber( swarm.getAverageFitness() )
+                      << cache_json.str()
+                      << trajectory_json.str()
+                      << ",\"seconds\":" << toNumber( seconds )
+                      << "}" << std::endl;
+        }
+        else
+        {
+            std::cout << "expression " << expression << "\n"
+                      << "backend " << backend_names[function.getActiveBackend()] << "\n"
+                      << "operations_parsed " << function.getNumberOfParsedOperations() << "\n"
+                      << "operations_optimized " << function.getNumberOfOperations() << "\n"
+                      << "dimension " << dimension << "\n"
+                      << "particles " << swarm.m_swarm.size() << "\n"
+                      << "iterations " << swarm.getIterationStep() << "\n"
+                      << "converged " << ( converged ? 1 : 0 ) << "\n"
+                      << "best_fitness " << toNumber( swarm.getBestFitness() ) << "\n"
+                      << "best_position " << position.str() << "\n"
+                      << "average_fitness " << toNumber( swarm.getAverageFitness() ) << "\n"
+                      << cache_text.str()
+                      << trajectory_text.str()
+                      << "seconds " << toNumber( seconds ) << std::endl;
+        }
+    }
+    catch( Exception &err )
+    {
+        std::cerr << "pso-cli: " << err.getMessage() << std::endl;
+        return 1;
+    }
+    catch( std::exception &err )
+    {
+        std::cerr << "pso-cli: " << err.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "psokernel.h"
+
+#include <cmath>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define PSOKERNEL_X86
+#include <immintrin.h>
+#endif
+
+/**
+    Scales the velocity to \a max_velocity if its length exceeds it. The position
+    was already advanced by the unscaled velocity, therefore it is corrected by the
+    difference.
+*/
+static inline void clampVelocity( double *position, double *velocity, size_t dim, double sum_sq, double max_velocity )
+{
+    double length = sqrt( sum_sq );
+
+    if( length >= max_velocity )
+    {
+        double scale = max_velocity / length;
+
+        for( size_t i = 0; i < dim; i++ )
+        {
+            position[i] -= velocity[i] * ( 1. - scale );
+            velocity[i] *= scale;
+        }
+    }
+}
+
+static void updateScalar( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                          size_t dim, double w, double r1, double r2, double r3, double max_velocity )
+{
+    double sum_sq = 0.;
+
+    for( size_t i = 0; i < dim; i++ )
+    {
+        double x = position[i];
+        double v = velocity[i] * w + ( best_position[i] - x ) * r1 + ( global_best[i] - x ) * r2;
+
+        if( neighbour_position )
+        {
+            v += ( neighbour_position[i] - x ) * r3;
+        }
+
+        sum_sq += v * v;
+        velocity[i] = v;
+        position[i] = x + v;
+    }
+
+    clampVelocity( position, velocity, dim, sum_sq, max_velocity );
+}
+
+#ifdef PSOKERNEL_X86
+__attribute__( ( target( "avx2,fma" ) ) )
+static void updateAVX2( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                        size_t dim, double w, double r1, double r2, double r3, double max_velocity )
+{
+    __m256d vw = _mm256_set1_pd( w ), vr1 = _mm256_set1_pd( r1 ), vr2 = _mm256_set1_pd( r2 ), vr3 = _mm256_set1_pd( r3 );
+    __m256d vsum = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for( ; i + 4 <= dim; i += 4 )
+    {
+        __m256d x = _mm256_loadu_pd( position + i );
+        __m256d v = _mm256_mul_pd( _mm256_loadu_pd( velocity + i ), vw );
+        v = _mm256_fmadd_pd( _mm256_sub_pd( _mm256_loadu_pd( best_position + i ), x ), vr1, v );
+        v = _mm256_fmadd_pd( _mm256_sub_pd( _mm256_loadu_pd( global_best + i ), x ), vr2, v );
+
+        if( neighbour_position )
+        {
+            v = _mm256_fmadd_pd( _mm256_sub_pd( _mm256_loadu_pd( neighbour_position + i ), x ), vr3, v );
+        }
+
+        vsum = _mm256_fmadd_pd( v, v, vsum );
+        _mm256_storeu_pd( velocity + i, v );
+        _mm256_storeu_pd( position + i, _mm256_add_pd( x, v ) );
+    }
+
+    __m128d half = _mm_add_pd( _mm256_castpd256_pd128( vsum ), _mm256_extractf128_pd( vsum, 1 ) );
+    double sum_sq = _mm_cvtsd_f64( _mm_add_sd( half, _mm_unpackhi_pd( half, half ) ) );
+
+    for( ; i < dim; i++ )
+    {
+        double x = position[i];
+        double v = velocity[i] * w + ( best_position[i] - x ) * r1 + ( global_best[i] - x ) * r2;
+
+        if( neighbour_position )
+        {
+            v += ( neighbour_position[i] - x ) * r3;
+        }
+
+        sum_sq += v * v;
+        velocity[i] = v;
+        position[i] = x + v;
+    }
+
+    clampVelocity( position, velocity, dim, sum_sq, max_velocity );
+}
+
+__attribute__( ( target( "avx512f" ) ) )
+static void updateAVX512( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                          size_t dim, double w, double r1, double r2, double r3, double max_velocity )
+{
+    __m512d vw = _mm512_set1_pd( w ), vr1 = _mm512_set1_pd( r1 ), vr2 = _mm512_set1_pd( r2 ), vr3 = _mm512_set1_pd( r3 );
+    __m512d vsum = _mm512_setzero_pd();
+
+    //the remainder is handled by masked loads and stores, no scalar tail loop is needed
+    for( size_t i = 0; i < dim; i += 8 )
+    {
+        __mmask8 mask = dim - i >= 8 ? 0xFF : static_cast<__mmask8>( ( 1u << ( dim - i ) ) - 1 );
+        __m512d x = _mm512_maskz_loadu_pd( mask, position + i );
+        __m512d v = _mm512_mul_pd( _mm512_maskz_loadu_pd( mask, velocity + i ), vw );
+        v = _mm512_fmadd_pd( _mm512_sub_pd( _mm512_maskz_loadu_pd( mask, best_position + i ), x ), vr1, v );
+        v = _mm512_fmadd_pd( _mm512_sub_pd( _mm512_maskz_loadu_pd( mask, global_best + i ), x ), vr2, v );
+
+        if( neighbour_position )
+        {
+            v = _mm512_fmadd_pd( _mm512_sub_pd( _mm512_maskz_loadu_pd( mask, neighbour_position + i ), x ), vr3, v );
+        }
+
+        vsum = _mm512_fmadd_pd( v, v, vsum );
+        _mm512_mask_storeu_pd( velocity + i, mask, v );
+        _mm512_mask_storeu_pd( position + i, mask, _mm512_add_pd( x, v ) );
+    }
+
+    double lanes[8];
+    _mm512_storeu_pd( lanes, vsum );
+    double sum_sq = ( ( lanes[0] + lanes[1] ) + ( lanes[2] + lanes[3] ) ) + ( ( lanes[4] + lanes[5] ) + ( lanes[6] + lanes[7] ) );
+
+    clampVelocity( position, velocity, dim, sum_sq, max_velocity );
+}
+#endif
+
+PSOKernel::InstructionSet PSOKernel::instruction_set = PSOKernel::getBestSupportedInstructionSet();
+PSOKernel::UpdateFunction PSOKernel::update_function = PSOKernel::getUpdateFunction( PSOKernel::getBestSupportedInstructionSet() );
+
+/**
+    Returns the widest instruction set supported by the processor.
+*/
+PSOKernel::InstructionSet PSOKernel::getBestSupportedInstructionSet()
+{
+#ifdef PSOKERNEL_X86
+    __builtin_cpu_init();
+
+    if( __builtin_cpu_supports( "avx512f" ) )
+    {
+        return AVX512;
+    }
+
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+    {
+        return AVX2;
+    }
+
+#endif
+    return SCALAR;
+}
+
+PSOKernel::InstructionSet PSOKernel::getInstructionSet()
+{
+    return instruction_set;
+}
+
+/**
+    Forces the kernel to use \a set. If the processor does not support \a set
+    the best supported instruction set is used instead.
+
+    \param[in] set
+*/
+void PSOKernel::setInstructionSet( InstructionSet set )
+{
+    if( set > getBestSupportedInstructionSet() )
+    {
+        set = getBestSupportedInstructionSet();
+    }
+
+    instruction_set = set;
+    update_function = getUpdateFunction( set );
+}
+
+PSOKernel::UpdateFunction PSOKernel::getUpdateFunction( InstructionSet set )
+{
+    switch( set )
+    {
+#ifdef PSOKERNEL_X86
+
+        case AVX512:
+            return updateAVX512;
+
+        case AVX2:
+            return updateAVX2;
+#endif
+
+        default:
+            return updateScalar;
+    }
+}
@@ -0,0 +1,111 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PSOKERNEL_H
+#define PSOKERNEL_H
+
+#include <stdlib.h>
+
+#include <cmath>
+
+/**
+    Fused velocity and position update of a single particle. The new velocity
+
+        v = w * v + r1 * (best_position - x) + r2 * (global_best - x) [+ r3 * (neighbour_position - x)]
+
+    its squared length and the new position x + v are computed in one pass over
+    the dimension without any temporary memory. Only if the velocity exceeds
+    \a max_velocity a second pass scales the velocity and corrects the position.
+    The coefficients r1, r2 and r3 already contain the parameters c1, c2 and c3.
+
+    The implementation is selected at program start by the capabilities of the
+    processor (AVX-512, AVX2 with FMA or plain scalar code) and can be changed
+    with \ref setInstructionSet.
+
+    If the dimension is known at compile time \ref updateFixed can be used
+    instead. Its loops have a constant trip count and are completely unrolled
+    by the compiler which is faster than the runtime dispatch for small dimensions.
+*/
+class PSOKernel
+{
+    public:
+        enum InstructionSet {SCALAR, AVX2, AVX512};
+
+        static void update( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                            size_t dim, double w, double r1, double r2, double r3, double max_velocity );
+
+        template<size_t Dim>
+        static void updateFixed( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                                 double w, double r1, double r2, double r3, double max_velocity );
+
+        static InstructionSet getInstructionSet();
+        static InstructionSet getBestSupportedInstructionSet();
+        static void setInstructionSet( InstructionSet set );
+
+    private:
+        typedef void ( *UpdateFunction )( double *, double *, const double *, const double *, const double *, size_t, double, double, double, double, double );
+
+        static UpdateFunction getUpdateFunction( InstructionSet set );
+
+        static InstructionSet   instruction_set;
+        static UpdateFunction   update_function;
+};
+
+inline void PSOKernel::update( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                               size_t dim, double w, double r1, double r2, double r3, double max_velocity )
+{
+    ( *update_function )( position, velocity, best_position, global_best, neighbour_position, dim, w, r1, r2, r3, max_velocity );
+}
+
+template<size_t Dim>
+inline void PSOKernel::updateFixed( double *position, double *velocity, const double *best_position, const double *global_best, const double *neighbour_position,
+                                    double w, double r1, double r2, double r3, double max_velocity )
+{
+    double sum_sq = 0.;
+
+    for( size_t i = 0; i < Dim; i++ )
+    {
+        double x = position[i];
+        double v = velocity[i] * w + ( best_position[i] - x ) * r1 + ( global_best[i] - x ) * r2;
+
+        if( neighbour_position )
+        {
+            v += ( neighbour_position[i] - x ) * r3;
+        }
+
+        sum_sq += v * v;
+        velocity[i] = v;
+        position[i] = x + v;
+    }
+
+    double length = sqrt( sum_sq );
+
+    if( length >= max_velocity )
+    {
+        double scale = max_velocity / length;
+
+        for( size_t i = 0; i < Dim; i++ )
+        {
+            position[i] -= velocity[i] * ( 1. - scale );
+            velocity[i] *= scale;
+        }
+    }
+}
+
+#endif // PSOKERNEL_H
@@ -0,0 +1,84 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemory.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "exception.h"
+
+SharedMemory::SharedMemory( size_t size_ ) : data( NULL ), size( size_ )
+{
+    static unsigned int counter = 0;
+    char name[64];
+    int fd = -1;
+
+    for( unsigned int attempt = 0; fd == -1 && attempt < 100; attempt++ )
+    {
+        snprintf( name, sizeof( name ), "/pso-%ld-%u", static_cast<long>( getpid() ), __sync_fetch_and_add( &counter, 1 ) );
+        fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR );
+
+        if( fd == -1 && errno != EEXIST )
+        {
+            break;
+        }
+    }
+
+    if( fd == -1 )
+    {
+        throw RuntimeError( "Unable to create shared memory" );
+    }
+
+    shm_unlink( name );
+
+    if( ftruncate( fd, size ) != 0 )
+    {
+        close( fd );
+        throw RuntimeError( "Unable to resize shared memory" );
+    }
+
+    data = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+
+    if( data == MAP_FAILED )
+    {
+        data = NULL;
+        throw RuntimeError( "Unable to map shared memory" );
+    }
+}
+
+SharedMemory::~SharedMemory()
+{
+    if( data ) munmap( data, size );
+}
+
+void *SharedMemory::getData() const
+{
+    return data;
+}
+
+size_t SharedMemory::getSize() const
+{
+    return size;
+}
@@ -0,0 +1,49 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <stdlib.h>
+
+/**
+    Anonymous POSIX shared memory segment. The segment is created with
+    shm_open and mapped with MAP_SHARED, the name is removed immediately
+    afterwards, so the memory is released with the last mapping even if a
+    process crashes. A child created by fork after the construction shares
+    the memory with its parent. The memory is filled with zeros.
+*/
+class SharedMemory
+{
+    public:
+        SharedMemory( size_t size_ );
+        virtual ~SharedMemory();
+
+        void *getData() const;
+        size_t getSize() const;
+
+    private:
+        SharedMemory( const SharedMemory &other ) {}
+        SharedMemory &operator=( const SharedMemory &other ) {return *this;}
+
+        void    *data;
+        size_t  size;
+};
+
+#endif // SHAREDMEMORY_H
@@ -19,28 +19,93 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 
 #include "subprocess.h"
 
+#include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <cstdio>
 
 #include <fstream>
+#include <iostream>
 
 #include "exception.h"
 
-Subprocess::Subprocess( std::string command ) : stdout( NULL ), stdin( NULL )
+Subprocess::Subprocess( std::string command ) : pid( -1 ), status( 0 ), stdout( NULL ), stdin( NULL ), buf_stdin_sync( NULL ), buf_stdout_sync( NULL )
 {
-    if( pipe( pipe_write ) != 0 )
+    start( &command, NULL );
+}
+
+Subprocess::Subprocess( Entry &entry ) : pid( -1 ), status( 0 ), stdout( NULL ), stdin( NULL ), buf_stdin_sync( NULL ), buf_stdout_sync( NULL )
+{
+    start( NULL, &entry );
+}
+
+namespace
+{
+    /**
+        Creates a pipe whose ends are closed on exec, so commands started
+        later by other threads do not inherit them. pipe2 sets the flag
+        atomically, with pipe and fcntl a fork in between still leaks the
+        ends. Returns 0 on success like pipe.
+    */
+    int createPipe( int fds[2] )
+    {
+#if defined(__linux__) && defined(O_CLOEXEC)
+        return pipe2( fds, O_CLOEXEC );
+#else
+
+        if( pipe( fds ) != 0 )
+        {
+            return -1;
+        }
+
+        fcntl( fds[0], F_SETFD, FD_CLOEXEC );
+        fcntl( fds[1], F_SETFD, FD_CLOEXEC );
+        return 0;
+#endif
+    }
+
+    /**
+        Connects \a fd to the standard stream \a target of the child. dup2
+        clears the close on exec flag of the copy, if \a fd already is
+        \a target the flag is cleared explicitly.
+    */
+    bool connectStream( int fd, int target )
+    {
+        if( fd == target )
+        {
+            return fcntl( fd, F_SETFD, 0 ) != -1;
+        }
+
+        return dup2( fd, target ) != -1;
+    }
+}
+
+/**
+    Creates the pipes and forks. The child executes \a command or, if
+    \a command is NULL, runs \a entry.
+*/
+void Subprocess::start( const std::string *command, Entry *entry )
+{
+    if( createPipe( pipe_write ) != 0 )
     {
         throw RuntimeError( "Unable to create pipe" );
     }
 
-    if( pipe( pipe_read ) != 0 )
+    if( createPipe( pipe_read ) != 0 )
     {
+        close( pipe_write[0] );
+        close( pipe_write[1] );
         throw RuntimeError( "Unable to create pipe" );
     }
 
+    //otherwise the child would write the buffered output of the parent a second time
+    std::cout.flush();
+    fflush( NULL );
+
     pid = fork();
 
     if( pid == 0 ) //child
@@ -48,21 +113,45 @@ Subprocess::Subprocess( std::string command ) : stdout( NULL ), stdin( NULL )
         close( pipe_write[1] );                     //closes the write-pipe
         close( pipe_read[0] );                      //closes the read-pile
 
-        if( dup2( pipe_write[0], STDIN_FILENO ) == -1 ) //connects the read-pipe with the stdin
+        if( !connectStream( pipe_write[0], STDIN_FILENO ) ) //connects the read-pipe with the stdin
         {
             throw RuntimeError( "Function dup2 failed" );
         }
 
-        if( dup2( pipe_read[1], STDOUT_FILENO ) == -1 ) //connects the write-pipe with the stdout
+        if( !connectStream( pipe_read[1], STDOUT_FILENO ) ) //connects the write-pipe with the stdout
         {
             throw RuntimeError( "Function dup2 failed" );
         }
 
-        system( command.c_str() );
+        if( command )
+        {
+            //like system, but the shell replaces the child, so kill reaches it
+            execl( "/bin/sh", "sh", "-c", command->c_str(), static_cast<char *>( NULL ) );
+            _exit( 127 );
+        }
+
+        int exit_status = 1;
+
+        try
+        {
+            exit_status = entry->run();
+        }
+        catch( ... )
+        {
+        }
 
-        close( pipe_write[1] );                     //clean up the pipe
-        close( pipe_read[0] );                      //clean up the pipe
-        exit( 0 );
+        //the destructors and atexit handlers belong to the parent, only the buffers are flushed
+        std::cout.flush();
+        fflush( NULL );
+        _exit( exit_status );
+    }
+    else if( pid == -1 )
+    {
+        close( pipe_write[0] );
+        close( pipe_write[1] );
+        close( pipe_read[0] );
+        close( pipe_read[1] );
+        throw RuntimeError( "Function fork failed" );
     }
     else//parent
     {
@@ -93,10 +182,57 @@ Subprocess::~Subprocess()
     wait();
 }
 
-void Subprocess::wait()
+/**
+    Waits until the child has exited and returns its status as reported by
+    waitpid, which can be examined with WIFEXITED, WEXITSTATUS and WIFSIGNALED.
+    Can be called more than once.
+*/
+int Subprocess::wait()
+{
+    if( pid > 0 )
+    {
+        waitpid( pid, &status, 0 );
+        pid = -1;
+    }
+
+    return status;
+}
+
+/**
+    Sends \a signal to the child, which has no effect if the child has
+    already been waited for.
+
+    \param[in] signal
+*/
+void Subprocess::kill( int signal )
+{
+    if( pid > 0 )
+    {
+        ::kill( pid, signal );
+    }
+}
+
+pid_t Subprocess::getPid() const
+{
+    return pid;
+}
+
+/**
+    Returns the file descriptor of the pipe to the stdin of the child. It
+    must not be mixed with \ref getStdin, which buffers the data.
+*/
+int Subprocess::getStdinDescriptor() const
+{
+    return pipe_write[1];
+}
+
+/**
+    Returns the file descriptor of the pipe from the stdout of the child. It
+    must not be mixed with \ref getStdout, which buffers the data.
+*/
+int Subprocess::getStdoutDescriptor() const
 {
-    int status = 0;
-    waitpid( pid, &status, 0 );
+    return pipe_read[0];
 }
 
 std::ostream &Subprocess::getStdin()
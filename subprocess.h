@@ -20,6 +20,8 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 #ifndef SUBPROCESS_H
 #define SUBPROCESS_H
 
+#include <sys/types.h>
+
 #include <string>
 #include <ostream>
 #include <istream>
@@ -27,13 +29,38 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 #include <ext/stdio_sync_filebuf.h>
 #include <ext/stdio_filebuf.h>
 
+/**
+    Child process whose stdin and stdout are connected to the parent with
+    pipes. The child either executes a shell command or runs an \ref Entry,
+    which is a function of the parent program executed in the forked copy
+    of the process. The pipes are closed on exec, so commands started by
+    other threads at the same time do not inherit them.
+*/
 class Subprocess
 {
     public:
+        /**
+            Code executed in the child process, the return value of \ref run
+            is the exit status of the child. Exceptions are caught in the
+            child and result in the exit status one.
+        */
+        class Entry
+        {
+            public:
+                virtual ~Entry() {}
+                virtual int run() = 0;
+        };
+
         Subprocess( std::string command );
+        Subprocess( Entry &entry );
         virtual ~Subprocess();
 
-        void wait();
+        int wait();
+        void kill( int signal );
+
+        pid_t getPid() const;
+        int getStdinDescriptor() const;
+        int getStdoutDescriptor() const;
 
         std::istream &getStdout();
         std::ostream &getStdin();
@@ -45,7 +72,10 @@ class Subprocess
         Subprocess &operator=( const Subprocess &other ) {return *this;}
         bool operator==( const Subprocess &other ) const {return false;}
 
+        void start( const std::string *command, Entry *entry );
+
         pid_t   pid;
+        int     status;
         int     pipe_read[2];
         int     pipe_write[2];
 
@@ -22,18 +22,72 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdlib.h>
 
+#include <string.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <deque>
 #include <set>
 #include <vector>
+#include "checkpoint.h"
+#include "neighbourindex.h"
 #include "particle.h"
+#include "philoxrandom.h"
+#include "psokernel.h"
+#include "threadpool.h"
+#include "topology.h"
+#include "trajectoryrecorder.h"
+
+const size_t Dynamic = 0; //template argument of Swarm if the dimension is only known at runtime
 
+/**
+    Evaluates \a func at \a count points with \a dim coordinates each, the
+    coordinates of point i start at positions[i * stride]. This generic version
+    calls the Functor once per point. A Functor which is able to evaluate many
+    points at once provides an overload, see \ref Function::evaluateBatch.
+*/
 template<typename Functor>
+void evaluateBatch( Functor &func, const double *positions, size_t count, size_t stride, size_t dim, double *out )
+{
+    for( size_t i = 0; i < count; i++ )
+    {
+        out[i] = func( VectorView<double>( const_cast<double *>( positions + i * stride ), dim ) );
+    }
+}
+
+/**
+    If the template argument \a Dim is not \ref Dynamic the dimension of the swarm
+    is fixed at compile time. The particle update is then done by
+    \ref PSOKernel::updateFixed whose loops are completely unrolled. The Dynamic
+    swarm uses the same unrolled update for the dimensions two and three and the
+    runtime dispatched SIMD kernel for all other dimensions.
+*/
+template<typename Functor, size_t Dim = Dynamic>
 class Swarm
 {
     public:
-        typedef std::vector<Particle *> particle_container;
-        enum ComutationMethode {GLOBAL_BEST, GLOBAL_LOCAL_BEST};
-        Swarm( size_t dim = 2 ) : dimension( dim ), global_best_particle( NULL )
+        typedef ParticleStore particle_container;
+        enum ComutationMethode {GLOBAL_BEST, GLOBAL_LOCAL_BEST, RING, VON_NEUMANN, RANDOM_K, SMALL_WORLD};
+        enum ExecutionMode {SYNCHRONOUS, ASYNCHRONOUS};
+        Swarm( size_t dim = ( Dim == Dynamic ? 2 : Dim ) ) : m_swarm( dim ), dimension( dim ), thread_pool( NULL ), checkpoint_writer( NULL ), trajectory_recorder( NULL )
         {
+            pthread_mutex_init( &async_mutex, NULL );
+            pthread_cond_init( &async_dispatch, NULL );
+            pthread_cond_init( &async_progress, NULL );
+            execution_mode = SYNCHRONOUS;
+            async_running = false;
+            async_open = false;
+            async_stop = false;
+            async_failed = false;
+            async_finished = 0;
+            async_target = 0;
+            async_improvements = 0;
+            async_use_neighbours = false;
+            async_use_topology = false;
+            async_global_best_value = 0.;
+
+            if( Dim != Dynamic && dim != Dim ) {throw RuntimeError( "dimension does not match the fixed dimension of the swarm" );}
+
             compare_function = a_gt_b;
 //          m_compare_function = a_lt_b;
             parameter_neighbour_radius = 10;
@@ -52,11 +106,22 @@ class Swarm
             abort_criterion_iterations = 1;
 
             check_abort_criterion = true;
+
+            topology_valid = false;
+            topology_neighbours = 2;
+            topology_rewiring = 0.1;
+
+            checkpoint_interval = 0;
         }
 
         virtual ~Swarm()
         {
+            delete checkpoint_writer;
             clear();
+            delete thread_pool;
+            pthread_cond_destroy( &async_progress );
+            pthread_cond_destroy( &async_dispatch );
+            pthread_mutex_destroy( &async_mutex );
         }
 
         bool getCheckAbortCriterion()
@@ -71,19 +136,73 @@ class Swarm
 
         void setFunction( const Functor &func )
         {
+            stopAsynchronous();
             function = func;
+            thread_functions.assign( thread_functions.size(), function );
+        }
+
+        /**
+            Enables the parallel fitness evaluation with \a num threads. Each
+            worker thread evaluates its own copy of the function, therefore the
+            Functor does not need to be thread safe. With \a num equal to one the
+            fitness is evaluated in the calling thread. With \a num equal to zero
+            the number of online processors is used.
+
+            \param[in] num
+        */
+        void setNumberOfThreads( size_t num )
+        {
+            stopAsynchronous();
+            delete thread_pool;
+            thread_pool = NULL;
+            thread_functions.clear();
+            evaluation_jobs.clear();
+
+            if( num == 0 )
+            {
+                num = ThreadPool::getNumberOfCPUs();
+            }
+
+            if( num > 1 )
+            {
+                thread_pool = new ThreadPool( num );
+                thread_functions.assign( num, function );
+            }
+        }
+
+        size_t getNumberOfThreads()
+        {
+            return thread_pool ? thread_pool->getNumberOfThreads() : 1;
+        }
+
+        /**
+            Sets the seed of the random numbers. The random numbers of a particle
+            only depend on the seed, the number of swarms created since the seed
+            was set, the particle id and the iteration. Therefore a run is
+            reproducible independent of the number of threads.
+
+            \param[in] seed
+        */
+        void setRandomSeed( uint64_t seed )
+        {
+            random_generator.setSeed( seed );
+        }
+
+        uint64_t getRandomSeed()
+        {
+            return random_generator.getSeed();
         }
 
         void addParticke2D( double x1, double x2 )
         {
-            Particle *current;
-            current = new Particle( dimension );
-            current->getPosition()[0] = x1;
-            current->getPosition()[1] = x2;
-            current->getVelocity()[0] = 0.0;
-            current->getVelocity()[1] = 0.0;
-            current->initFitness( function );
-            m_swarm.push_back( current );
+            stopAsynchronous();
+            topology_valid = false;
+            Particle current( &m_swarm, m_swarm.add() );
+            current.getPosition()[0] = x1;
+            current.getPosition()[1] = x2;
+            current.getVelocity()[0] = 0.0;
+            current.getVelocity()[1] = 0.0;
+            current.initFitness( function );
             findGlobalBest();
         }
 
@@ -93,7 +212,10 @@ class Swarm
 
             if( dimension != min.size() || dimension != max.size() ) {throw RuntimeError( "wrong VectorN dimension" );}
 
-            Particle *current;
+            m_swarm.reserve( num );
+            random_generator.nextRun();
+
+            std::vector<double> random_position( dimension ), random_velocity( dimension );
 
             if( dimension == 2 && !random )
             {
@@ -117,15 +239,14 @@ class Swarm
                 {
                     for( size_t j = 0; j < ny; j++ )
                     {
-                        current = new Particle( dimension );
-                        current->getPosition()[0] = min[0] + x_step * i + x_step / 2.;
-                        current->getPosition()[1] = min[1] + y_step * j + y_step / 2.;
-                        current->getVelocity()[0] = ( min[0] + ( max[0] - min[0] ) * Particle::getRandomNumber() ) * 0.01;
-                        current->getVelocity()[1] = ( min[1] + ( max[1] - min[1] ) * Particle::getRandomNumber() ) * 0.01;
+                        Particle current( &m_swarm, m_swarm.add() );
+                        random_generator.fill( current.getId(), 0, PhiloxRandom::STREAM_INIT_VELOCITY, 2, &random_velocity[0] );
+                        current.getPosition()[0] = min[0] + x_step * i + x_step / 2.;
+                        current.getPosition()[1] = min[1] + y_step * j + y_step / 2.;
+                        current.getVelocity()[0] = ( min[0] + ( max[0] - min[0] ) * random_velocity[0] ) * 0.01;
+                        current.getVelocity()[1] = ( min[1] + ( max[1] - min[1] ) * random_velocity[1] ) * 0.01;
 
 
-                        current->initFitness( function );
-                        m_swarm.push_back( current );
                         tmp_num--;
 
                         if( tmp_num == 0 ) {break;}
@@ -141,22 +262,21 @@ class Swarm
             {
                 for( size_t i = 0; i < num; i++ )
                 {
-                    current = new Particle( dimension );
-
+                    Particle current( &m_swarm, m_swarm.add() );
+                    random_generator.fill( current.getId(), 0, PhiloxRandom::STREAM_INIT_POSITION, dimension, &random_position[0] );
+                    random_generator.fill( current.getId(), 0, PhiloxRandom::STREAM_INIT_VELOCITY, dimension, &random_velocity[0] );
 
                     for( size_t k = 0; k < dimension; k++ )
                     {
-                        current->getPosition()[k] = min[k] + ( max[k] - min[k] ) * Particle::getRandomNumber();
-                        current->getVelocity()[k] = ( min[k] + ( max[k] - min[k] ) * Particle::getRandomNumber() ) * 0.01;
+                        current.getPosition()[k] = min[k] + ( max[k] - min[k] ) * random_position[k];
+                        current.getVelocity()[k] = ( min[k] + ( max[k] - min[k] ) * random_velocity[k] ) * 0.01;
                     }
-
-                    current->initFitness( function );
-                    m_swarm.push_back( current );
                 }
             }
 
+            evaluateFitness( true );
             iteration_steps = 0;
-            findGlobalBest();
+            recordTrajectory();
         }
 
         size_t getIterationStep()
@@ -164,11 +284,89 @@ class Swarm
             return iteration_steps;
         }
 
+        /**
+            Writes the particles and the state of the optimization, including the
+            iteration counter, the abort criterion, the velocity limits and the
+            state of the random numbers, to \a filename. The function is not part
+            of the checkpoint, it has to be set before \ref loadCheckpoint.
+
+            \param[in] filename
+        */
+        void saveCheckpoint( const std::string &filename )
+        {
+            CheckpointImage image;
+            writeCheckpoint( image );
+            image.save( filename );
+        }
+
+        /**
+            Replaces the swarm by the checkpoint \a filename, which is mapped into
+            memory instead of being read. The optimization continues exactly as if
+            it had never been interrupted.
+
+            \param[in] filename
+        */
+        void loadCheckpoint( const std::string &filename )
+        {
+            CheckpointImage image;
+            image.load( filename );
+            readCheckpoint( image );
+        }
+
+        /**
+            Writes a checkpoint to \a filename every \a interval iterations. The
+            swarm is copied at the end of \ref computeNextStep and written by a
+            background thread, see \ref CheckpointWriter. An empty \a filename or
+            an \a interval of zero disables the checkpoints.
+
+            \param[in] filename
+            \param[in] interval
+        */
+        void setCheckpoint( const std::string &filename, size_t interval )
+        {
+            delete checkpoint_writer;
+            checkpoint_writer = NULL;
+            checkpoint_interval = interval;
+
+            if( !filename.empty() && interval > 0 )
+            {
+                checkpoint_writer = new CheckpointWriter( filename );
+            }
+        }
+
+        /**
+            Records the particles after \ref createSwarm and after each
+            \ref computeNextStep with \a recorder, NULL stops the recording.
+            The swarm does not take the ownership of \a recorder.
+
+            \param[in] recorder
+        */
+        void setTrajectoryRecorder( TrajectoryRecorder *recorder )
+        {
+            trajectory_recorder = recorder;
+        }
+
+        TrajectoryRecorder *getTrajectoryRecorder()
+        {
+            return trajectory_recorder;
+        }
+
+        /**
+            Waits until the background thread has written the last checkpoint.
+        */
+        void flushCheckpoint()
+        {
+            if( checkpoint_writer )
+            {
+                checkpoint_writer->flush();
+            }
+        }
+
         double getBestFitness()
         {
-            if( global_best_particle )
+            if( global_best_particle.isValid() )
             {
-                return global_best_particle->getBestValue();
+                return global_best_particle.getBestValue();
             }
             else
             {
@@ -176,37 +374,61 @@ class Swarm
             }
         }
 
-        Particle *getBestParticle()
+        /**
+            Returns a view on the global best particle. The view is invalid
+            if the swarm is empty, see \ref Particle::isValid.
+        */
+        Particle getBestParticle()
         {
             return global_best_particle;
         }
 
-        double getAverageFitness()
+        Particle getParticle( size_t id )
         {
-            double sum = 0.;
+            return Particle( &m_swarm, id );
+        }
 
-            for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
-            {
-                sum += ( *it )->getCurrentValue();
-            }
+        /**
+            Returns the mean of the current values. The value is computed during
+            the evaluation of the swarm, see \ref Statistics.
+        */
+        double getAverageFitness()
+        {
+            return statistics.sum_current_values / ( double )statistics.count;
+        }
 
-            return sum / ( double )m_swarm.size();
+        /**
+            Returns the number of particles whose best value was improved in the
+            last step.
+        */
+        size_t getNumberOfImprovements()
+        {
+            return statistics.improvements;
         }
 
         void clear()
         {
-            for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
-            {
-                delete *it;
-            }
-
+            stopAsynchronous();
             m_swarm.clear();
-            global_best_particle = NULL;
+            global_best_particle = Particle();
+            statistics = Statistics();
+            async_update_counts.clear();
+            topology_valid = false;
         }
 
+        /**
+            GLOBAL_BEST uses the global best particle, GLOBAL_LOCAL_BEST additionally
+            the best particle within the neighbour radius. The topology methods RING,
+            VON_NEUMANN, RANDOM_K and SMALL_WORLD replace the global best of a particle
+            by the best particle of its fixed neighbourhood, see \ref Topology.
+        */
         void setComputationMethode( ComutationMethode cm )
         {
-            computation_methode = cm;
+            if( cm != computation_methode )
+            {
+                computation_methode = cm;
+                topology_valid = false;
+            }
         }
 
         ComutationMethode getComputationMethode()
@@ -214,10 +436,34 @@ class Swarm
             return computation_methode;
         }
 
+        /**
+            In the SYNCHRONOUS mode all particles are moved, then all particles are
+            evaluated and then the global best is searched. In the ASYNCHRONOUS mode
+            a particle is moved again as soon as its own evaluation is finished,
+            using the global best known at that moment, see \ref computeNextStepAsynchronous.
+        */
+        void setExecutionMode( ExecutionMode mode )
+        {
+            if( mode != ASYNCHRONOUS )
+            {
+                stopAsynchronous();
+            }
+
+            execution_mode = mode;
+        }
+
+        ExecutionMode getExecutionMode()
+        {
+            return execution_mode;
+        }
+
         void setDimension( size_t dim )
         {
+            if( Dim != Dynamic && dim != Dim ) {throw RuntimeError( "dimension does not match the fixed dimension of the swarm" );}
+
             dimension = dim;
             clear();
+            m_swarm.setDimension( dim );
         }
 
 
@@ -226,61 +472,135 @@ class Swarm
             return dimension;
         }
 
+        /**
+            Rescans the whole swarm for the global best and the mean fitness. This
+            is only needed if the values were changed outside of the evaluation,
+            for example after the compare function was changed, because
+            \ref evaluateFitness already updates the statistics. The number of
+            improvements is kept.
+        */
         void findGlobalBest()
         {
-            if( m_swarm.size() > 0 )
-            {
-                global_best_particle = *m_swarm.begin();
+            size_t improvements = statistics.improvements;
+            statistics = Statistics();
+            reduceRange( 0, m_swarm.size(), statistics );
+            statistics.improvements = improvements;
+            applyStatistics();
+        }
+
+        /**
+            Replaces the particle with the worst best value by a particle from
+            another swarm if \a value is better. The new particle starts at rest
+            at \a position, which is also its best position. Returns true if the
+            particle was replaced. Used for the migration of \ref IslandSwarm.
+
+            \param[in] position
+            \param[in] value       fitness at \a position
+        */
+        bool insertMigrant( const double *position, double value )
+        {
+            if( m_swarm.empty() ) {return false;}
 
-                for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
+            const double *best_values = m_swarm.getBestValues();
+            size_t worst = 0;
+
+            for( size_t i = 1; i < m_swarm.size(); i++ )
+            {
+                if( ( *compare_function )( best_values[worst], best_values[i] ) )
                 {
-                    if( ( *compare_function )( ( *it )->getBestValue(), global_best_particle->getBestValue() ) )
-                    {
-                        global_best_particle = *it;
-                    }
+                    worst = i;
                 }
             }
-            else
+
+            if( !( *compare_function )( value, best_values[worst] ) ) {return false;}
+
+            //a running evaluation of the replaced particle must not overwrite the migrant
+            if( async_running && worst < async_discard.size() )
+            {
+                pthread_mutex_lock( &async_mutex );
+                async_discard[worst] = 1;
+                pthread_mutex_unlock( &async_mutex );
+            }
+
+            statistics.sum_current_values += value - m_swarm.getCurrentValue( worst );
+
+            memcpy( m_swarm.getPosition( worst ), position, dimension * sizeof( double ) );
+            memcpy( m_swarm.getBestPosition( worst ), position, dimension * sizeof( double ) );
+            memset( m_swarm.getVelocity( worst ), 0, dimension * sizeof( double ) );
+            m_swarm.getCurrentValue( worst ) = value;
+            m_swarm.getBestValue( worst ) = value;
+
+            if( !global_best_particle.isValid() || ( *compare_function )( value, getBestFitness() ) )
             {
-                global_best_particle = NULL;
+                statistics.best = worst;
+                applyStatistics();
             }
+
+            return true;
         }
 
-        void findBestNeighbour( Particle *particle )
+        /**
+            Sets the best neighbour of \a particle to the particle with the best
+            current value within the neighbour radius. The candidates are taken
+            from the spatial index, which has to be built by \ref findBestNeighbours
+            for the current positions.
+        */
+        void findBestNeighbour( Particle particle )
         {
-            VectorN<double> tmp( dimension );
-            particle->setBestNeighbour( NULL );
+            const double *current_values = m_swarm.getCurrentValues();
+            long &best_neighbour = m_swarm.getBestNeighbour( particle.getId() );
+            best_neighbour = ParticleStore::no_neighbour;
+
+            neighbour_index.query( particle.getId(), neighbour_candidates );
 
-            for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
+            for( size_t i = 0; i < neighbour_candidates.size(); i++ )
             {
-                particle->getPosition().sub( ( *it )->getPosition(), tmp );
+                size_t j = neighbour_candidates[i];
 
-                if( tmp.length() < parameter_neighbour_radius )
+                if( best_neighbour == ParticleStore::no_neighbour )
+                {
+                    best_neighbour = j;
+                }
+                else
                 {
-                    if( *it != particle )
+                    if( ( *compare_function )( current_values[j], current_values[best_neighbour] ) )
                     {
-                        if( particle->getBestNeighbour() == NULL )
-                        {
-                            particle->setBestNeighbour( *it );;
-                        }
-                        else
-                        {
-                            if( ( *compare_function )( ( *it )->getCurrentValue(), particle->getBestNeighbour()->getCurrentValue() ) )
-                            {
-                                particle->setBestNeighbour( *it );;
-                            }
-                        }
+                        best_neighbour = j;
                     }
                 }
             }
         }
 
+        /**
+            Rebuilds the spatial index over the current positions and finds the
+            best neighbour of every particle.
+        */
+        void findBestNeighbours()
+        {
+            neighbour_index.build( m_swarm.getPositions(), m_swarm.getStride(), m_swarm.size(), dimension, parameter_neighbour_radius );
+
+            for( size_t i = 0; i < m_swarm.size(); i++ )
+            {
+                findBestNeighbour( getParticle( i ) );
+            }
+        }
+
+        void setNeighbourSearchMethod( NeighbourIndex::Method method )
+        {
+            neighbour_index.setMethod( method );
+        }
+
+        NeighbourIndex::Method getNeighbourSearchMethod()
+        {
+            return neighbour_index.getMethod();
+        }
+
 
         bool checkAbortCriterion()
         {
-            if( !global_best_particle ) {return false;}
+            if( !global_best_particle.isValid() ) {return false;}
 
-            if( fabs( global_best_particle->getBestValue() - global_best_previous ) < 1e-10 )
+            if( fabs( getBestFitness() - global_best_previous ) < 1e-10 )
             {
                 if( global_best_iterations > abort_criterion_iterations )
                 {
@@ -296,7 +616,7 @@ class Swarm
             }
             else
             {
-                global_best_previous = global_best_particle->getBestValue();
+                global_best_previous = getBestFitness();
                 global_best_iterations = 0;
                 return false;
             }
@@ -312,74 +632,274 @@ class Swarm
 
         void computeNextStep()
         {
+            if( execution_mode == ASYNCHRONOUS )
+            {
+                computeNextStepAsynchronous();
+                return;
+            }
+
+            VectorN<double> global_best_position( dimension );
+
+            if( global_best_particle.isValid() )
+            {
+                global_best_particle.getBestPosition().copyTo( global_best_position );
+            }
+            else
+            {
+                global_best_position.setAll( 0. );
+            }
+
             switch( computation_methode )
             {
                 case GLOBAL_BEST:
                 {
-                    VectorN<double> global_best_position( dimension );
+                    updateParticles( global_best_position, false );
 
-                    if( global_best_particle )
-                    {
-                        global_best_position = global_best_particle->getBestPosition();
-                    }
-                    else
-                    {
-                        global_best_position.setAll( 0. );
-                    }
+                    evaluateFitness();
+                }
+                break;
 
-                    for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
+                case GLOBAL_LOCAL_BEST:
+
+                    if( !( fabs( parameter_c3 ) < 1e-5 ) )
                     {
-                        ( *it )->calcNewGlobal( limit_velocity_max, parameter_c1, parameter_c2, parameter_w, global_best_position );
+                        findBestNeighbours();
                     }
 
-                    for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
+                    updateParticles( global_best_position, true );
+
+                    evaluateFitness();
+
+                    break;
+
+                case RING:
+                case VON_NEUMANN:
+                case RANDOM_K:
+                case SMALL_WORLD:
+
+                    if( !m_swarm.empty() )
                     {
-                        ( *it )->calculateFitness( function, compare_function );
+                        findLocalBest();
+                        updateParticles( global_best_position, false, &local_best[0] );
                     }
+
+                    evaluateFitness();
+
+                    break;
+            }
+
+            iteration_steps++;
+
+            if( auto_velocity )
+            {
+                calculateMaxVelocity();
+            }
+
+            snapshotCheckpoint();
+            recordTrajectory();
+        }
+
+        /**
+            Steady state variant of \ref computeNextStep. The worker threads are
+            not synchronised per step: every worker takes the next idle particle,
+            moves it with the global best known at that moment, evaluates it and
+            updates the global best immediately. The workers keep running across
+            the steps, so a particle whose evaluation is fast is moved again while
+            a slow one is still evaluated, and an evaluation which is still running
+            at the end of a step is finished in the next one.
+
+            The iterations are counted in evaluations: a step returns as soon as
+            the number of finished evaluations since the previous step equals the
+            number of particles. The iteration counter, the abort criterion and the
+            automatic velocity therefore advance by one per N evaluations, as in
+            the synchronous mode, even if some particles were evaluated more often
+            than others.
+
+            Between the steps the particles are not changed: a worker which
+            finishes an evaluation outside of a step keeps the result until the
+            next step starts, so the swarm can be read, checkpointed and recorded
+            without a lock. The workers are stopped by \ref stopAsynchronous, which
+            is called by every function that changes the swarm or the threads.
+
+            In the GLOBAL_LOCAL_BEST mode the best neighbours are searched at the
+            start of the step, their positions are taken when a particle is moved.
+            The topology methods use the local best of each particle found at the
+            start of the step instead of the global best.
+        */
+        void computeNextStepAsynchronous()
+        {
+            if( !m_swarm.empty() )
+            {
+                if( !global_best_particle.isValid() )
+                {
+                    findGlobalBest();
                 }
-                break;
 
-                case GLOBAL_LOCAL_BEST:
+                //no particle is changed outside of a step, so the swarm can be scanned without the lock
+                async_use_neighbours = computation_methode == GLOBAL_LOCAL_BEST;
 
-                    VectorN<double> global_best_position( dimension );
+                if( async_use_neighbours && !( fabs( parameter_c3 ) < 1e-5 ) )
+                {
+                    findBestNeighbours();
+                }
 
-                    if( global_best_particle )
-                    {
-                        global_best_position = global_best_particle->getBestPosition();
-                    }
-                    else
+                async_use_topology = isTopologyMethode( computation_methode );
+
+                if( async_use_topology )
+                {
+                    findLocalBest();
+                }
+
+                pthread_mutex_lock( &async_mutex );
+
+                if( !async_running )
+                {
+                    async_ready.clear();
+
+                    for( size_t i = 0; i < m_swarm.size(); i++ )
                     {
-                        global_best_position.setAll( 0. );
+                        async_ready.push_back( i );
                     }
 
-                    if( !( fabs( parameter_c3 ) < 1e-5 ) )
+                    async_update_counts.resize( m_swarm.size(), 0 );
+                    async_discard.assign( m_swarm.size(), 0 );
+                    async_finished = 0;
+                    async_target = 0;
+                }
+
+                async_global_best_position.assign( global_best_particle.getBestPosition().getData(), global_best_particle.getBestPosition().getData() + dimension );
+                async_global_best_value = global_best_particle.getBestValue();
+                async_improvements = 0;
+                async_target += m_swarm.size();
+                async_open = true;
+
+                if( thread_pool )
+                {
+                    if( !async_running )
                     {
-                        for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
+                        async_running = true;
+                        asynchronous_jobs.resize( thread_pool->getNumberOfThreads() );
+
+                        for( size_t i = 0; i < asynchronous_jobs.size(); i++ )
                         {
-                            findBestNeighbour( *it );
+                            asynchronous_jobs[i].swarm = this;
+                            thread_pool->enqueue( &asynchronous_jobs[i] );
                         }
                     }
 
-                    for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
-                    {
-                        ( *it )->calcNewGlobalAndLocal( limit_velocity_max, parameter_c1, parameter_c2, parameter_c3, parameter_w, global_best_position, compare_function );
-                    }
+                    pthread_cond_broadcast( &async_dispatch );
 
-                    for( particle_container::iterator it( m_swarm.begin() ); it != m_swarm.end(); it++ )
+                    while( async_finished < async_target && !async_failed )
                     {
-                        ( *it )->calculateFitness( function, compare_function );
+                        pthread_cond_wait( &async_progress, &async_mutex );
                     }
+                }
+                else
+                {
+                    pthread_mutex_unlock( &async_mutex );
+                    runAsynchronous( function, false );
+                    pthread_mutex_lock( &async_mutex );
+                }
 
-                    break;
+                async_open = false;
+                bool failed = async_failed;
+                std::string message = async_error;
+                pthread_mutex_unlock( &async_mutex );
+
+                if( failed )
+                {
+                    stopAsynchronous();
+                    throw RuntimeError( message );
+                }
             }
 
             iteration_steps++;
             findGlobalBest();
+            statistics.improvements = async_improvements;
 
             if( auto_velocity )
             {
                 calculateMaxVelocity();
             }
+
+            snapshotCheckpoint();
+            recordTrajectory();
+        }
+
+        /**
+            Stops the worker threads of the ASYNCHRONOUS mode. Evaluations which
+            are still running are finished, but their results are dropped and the
+            particles keep their state of the last step.
+        */
+        void stopAsynchronous()
+        {
+            if( !async_running ) {return;}
+
+            pthread_mutex_lock( &async_mutex );
+            async_stop = true;
+            async_open = false;
+            pthread_cond_broadcast( &async_dispatch );
+            pthread_mutex_unlock( &async_mutex );
+
+            //the workers catch all exceptions of the function, so wait does not throw
+            thread_pool->wait();
+
+            pthread_mutex_lock( &async_mutex );
+            async_running = false;
+            async_stop = false;
+            async_failed = false;
+            async_error.clear();
+            async_ready.clear();
+            pthread_mutex_unlock( &async_mutex );
+        }
+
+        /**
+            Evaluates the fitness of all particles. If the parallel evaluation is
+            enabled by \ref setNumberOfThreads the particles are split into chunks
+            which are distributed to the worker threads.
+
+            The global best, the mean fitness and the number of improved particles
+            are reduced in the same pass, each chunk computes its own part which
+            are merged afterwards. Therefore no additional pass over the swarm is
+            needed to find the global best.
+
+            \param[in] init    if true the best values are reset to the current values
+        */
+        void evaluateFitness( bool init = false )
+        {
+            stopAsynchronous();
+
+            if( thread_pool && m_swarm.size() >= 2 * thread_pool->getNumberOfThreads() )
+            {
+                size_t num_jobs = thread_pool->getNumberOfThreads() * jobs_per_thread;
+                size_t chunk_size = ( m_swarm.size() + num_jobs - 1 ) / num_jobs;
+                evaluation_jobs.resize( num_jobs );
+
+                for( size_t i = 0; i < num_jobs; i++ )
+                {
+                    evaluation_jobs[i].swarm = this;
+                    evaluation_jobs[i].init = init;
+                    evaluation_jobs[i].begin = std::min( i * chunk_size, m_swarm.size() );
+                    evaluation_jobs[i].end = std::min( ( i + 1 ) * chunk_size, m_swarm.size() );
+                    thread_pool->enqueue( &evaluation_jobs[i] );
+                }
+
+                thread_pool->wait();
+
+                statistics = Statistics();
+
+                for( size_t i = 0; i < num_jobs; i++ )
+                {
+                    mergeStatistics( statistics, evaluation_jobs[i].statistics );
+                }
+            }
+            else
+            {
+                statistics = Statistics();
+                evaluateRange( function, 0, m_swarm.size(), init, statistics );
+            }
+
+            applyStatistics();
         }
 
         size_t optimize( size_t max_iterations = 10000 )
@@ -434,6 +954,49 @@ class Swarm
             parameter_neighbour_radius = dist;
         }
 
+        /**
+            Sets the number of neighbours on each side for RING and SMALL_WORLD
+            and the number of neighbours for RANDOM_K.
+        */
+        void setTopologyNeighbours( size_t k )
+        {
+            //the von Neumann grid has no parameter
+            if( k != topology_neighbours && isTopologyMethode( computation_methode ) && computation_methode != VON_NEUMANN )
+            {
+                topology_valid = false;
+            }
+
+            topology_neighbours = k;
+        }
+
+        size_t getTopologyNeighbours()
+        {
+            return topology_neighbours;
+        }
+
+        /**
+            Sets the probability of moving an edge of the SMALL_WORLD topology.
+        */
+        void setTopologyRewiring( double p )
+        {
+            if( p != topology_rewiring && computation_methode == SMALL_WORLD )
+            {
+                topology_valid = false;
+            }
+
+            topology_rewiring = p;
+        }
+
+        double getTopologyRewiring()
+        {
+            return topology_rewiring;
+        }
+
+        static bool isTopologyMethode( ComutationMethode cm )
+        {
+            return cm == RING || cm == VON_NEUMANN || cm == RANDOM_K || cm == SMALL_WORLD;
+        }
+
         void setParameterC1( double c1 )
         {
             parameter_c1 = c1;
@@ -459,6 +1022,15 @@ class Swarm
             abort_criterion_iterations = i;
         }
 
+        /**
+            Returns true if the fitness \a a is better than \a b with respect to
+            the current compare function, see \ref setCompare.
+        */
+        bool isBetter( double a, double b )
+        {
+            return ( *compare_function )( a, b );
+        }
+
         static bool a_lt_b( double a, double b )
         {
             return a < b;
@@ -471,10 +1043,539 @@ class Swarm
 
         particle_container m_swarm;
     protected:
+        static const size_t jobs_per_thread = 4; //more chunks than threads to balance expensive regions of the function
+
+        /**
+            Result of the reduction over a range of particles.
+        */
+        struct Statistics
+        {
+            Statistics() : best( ParticleStore::no_neighbour ), sum_current_values( 0. ), improvements( 0 ), count( 0 ) {}
+
+            long    best;               //id of the particle with the best value or no_neighbour for an empty range
+            double  sum_current_values;
+            size_t  improvements;       //number of particles whose best value was improved
+            size_t  count;
+        };
+
+        class EvaluationJob : public ThreadPool::Job
+        {
+            public:
+                EvaluationJob() : swarm( NULL ), begin( 0 ), end( 0 ), init( false ) {}
+
+                void run( size_t thread_id )
+                {
+                    statistics = Statistics();
+                    swarm->evaluateRange( swarm->thread_functions[thread_id], begin, end, init, statistics );
+                }
+
+                Swarm       *swarm;
+                size_t      begin;
+                size_t      end;
+                bool        init;
+                Statistics  statistics;
+        };
+
+        class AsynchronousJob : public ThreadPool::Job
+        {
+            public:
+                AsynchronousJob() : swarm( NULL ) {}
+
+                void run( size_t thread_id )
+                {
+                    swarm->runAsynchronous( swarm->thread_functions[thread_id], true );
+                }
+
+                Swarm   *swarm;
+        };
+
+        /**
+            Worker loop of \ref computeNextStepAsynchronous. The swarm and the shared
+            state are only accessed with async_mutex locked: a particle is copied
+            when it is taken from the ready queue, moved and evaluated without the
+            lock and written back while a step is open. A particle is owned by one
+            thread from taking it out of the ready queue until it is put back.
+
+            A \a background worker runs until \ref stopAsynchronous, otherwise the
+            loop returns at the end of the step.
+        */
+        void runAsynchronous( Functor &func, bool background )
+        {
+            std::vector<double> buffer( 5 * dimension );
+            double *position = &buffer[0];
+            double *velocity = position + dimension;
+            double *best_position = velocity + dimension;
+            double *social_best = best_position + dimension;
+            double *neighbour_position = social_best + dimension;
+            double random[PhiloxRandom::coefficients_per_particle];
+
+            pthread_mutex_lock( &async_mutex );
+
+            while( true )
+            {
+                if( !background && ( async_finished >= async_target || async_ready.empty() ) ) {break;}
+
+                while( !async_stop && !( async_open && !async_ready.empty() && async_finished < async_target ) )
+                {
+                    pthread_cond_wait( &async_dispatch, &async_mutex );
+                }
+
+                if( async_stop ) {break;}
+
+                size_t i = async_ready.front();
+                async_ready.pop_front();
+                memcpy( position, m_swarm.getPosition( i ), dimension * sizeof( double ) );
+                memcpy( velocity, m_swarm.getVelocity( i ), dimension * sizeof( double ) );
+                memcpy( best_position, m_swarm.getBestPosition( i ), dimension * sizeof( double ) );
+
+                if( async_use_topology )
+                {
+                    memcpy( social_best, m_swarm.getBestPosition( local_best[i] ), dimension * sizeof( double ) );
+                }
+                else
+                {
+                    std::copy( async_global_best_position.begin(), async_global_best_position.end(), social_best );
+                }
+
+                long best_neighbour = async_use_neighbours ? m_swarm.getBestNeighbour( i ) : ParticleStore::no_neighbour;
+
+                if( best_neighbour != ParticleStore::no_neighbour )
+                {
+                    memcpy( neighbour_position, m_swarm.getPosition( best_neighbour ), dimension * sizeof( double ) );
+                }
+
+                double w = parameter_w, c1 = parameter_c1, c2 = parameter_c2, c3 = parameter_c3, max_velocity = limit_velocity_max;
+                uint32_t update = async_update_counts[i];
+
+                pthread_mutex_unlock( &async_mutex );
+
+                //the update counter of the particle replaces the iteration, so the random numbers do not depend on the scheduling
+                random_generator.fill( i, update, PhiloxRandom::STREAM_COEFFICIENTS, 3, random );
+
+                bool has_neighbour = best_neighbour != ParticleStore::no_neighbour;
+                PSOKernel::update( position, velocity, best_position, social_best, has_neighbour ? neighbour_position : NULL, dimension, w, c1 * random[0],
+                                   c2 * random[1], has_neighbour ? c3 * random[2] : 0., max_velocity );
+
+                double value = 0.;
+                std::string message;
+
+                try
+                {
+                    value = func( VectorView<double>( position, dimension ) );
+                }
+                catch( Exception &err )
+                {
+                    message = err.getMessage();
+                }
+                catch( std::exception &err )
+                {
+                    message = err.what();
+                }
+                catch( ... )
+                {
+                    message = "Unknown exception in the evaluation";
+                }
+
+                pthread_mutex_lock( &async_mutex );
+
+                if( !message.empty() )
+                {
+                    if( !async_failed )
+                    {
+                        async_failed = true;
+                        async_error = message;
+                    }
+
+                    pthread_cond_broadcast( &async_progress );
+                    break;
+                }
+
+                //the particles are only changed during a step
+                while( background && !async_open && !async_stop )
+                {
+                    pthread_cond_wait( &async_dispatch, &async_mutex );
+                }
+
+                if( async_stop ) {break;}
+
+                if( async_discard[i] )
+                {
+                    async_discard[i] = 0;
+                }
+                else
+                {
+                    memcpy( m_swarm.getPosition( i ), position, dimension * sizeof( double ) );
+                    memcpy( m_swarm.getVelocity( i ), velocity, dimension * sizeof( double ) );
+                    m_swarm.getCurrentValue( i ) = value;
+                    async_update_counts[i]++;
+                    async_finished++;
+
+                    Particle current = getParticle( i );
+
+                    if( current.updateBest( compare_function ) )
+                    {
+                        async_improvements++;
+                    }
+
+                    if( ( *compare_function )( current.getBestValue(), async_global_best_value ) )
+                    {
+                        async_global_best_value = current.getBestValue();
+                        memcpy( &async_global_best_position[0], m_swarm.getBestPosition( i ), dimension * sizeof( double ) );
+                        global_best_particle = current;
+                    }
+
+                    if( async_finished >= async_target )
+                    {
+                        pthread_cond_signal( &async_progress );
+                    }
+                }
+
+                async_ready.push_back( i );
+                pthread_cond_signal( &async_dispatch );
+            }
+
+            pthread_mutex_unlock( &async_mutex );
+        }
+
+        /**
+            Creates the topology of the current computation methode if the swarm
+            size or the topology parameters have changed since it was created.
+        */
+        void updateTopology()
+        {
+            if( topology_valid && topology.size() == m_swarm.size() ) {return;}
+
+            switch( computation_methode )
+            {
+                case RING:
+                    topology.createRing( m_swarm.size(), topology_neighbours );
+                    break;
+
+                case VON_NEUMANN:
+                    topology.createVonNeumann( m_swarm.size() );
+                    break;
+
+                case RANDOM_K:
+                    topology.createRandom( m_swarm.size(), topology_neighbours, random_generator );
+                    break;
+
+                case SMALL_WORLD:
+                    topology.createSmallWorld( m_swarm.size(), topology_neighbours, topology_rewiring, random_generator );
+                    break;
+
+                default:
+                    topology.clear();
+                    break;
+            }
+
+            topology_valid = true;
+        }
+
+        /**
+            Finds the best particle of the neighbourhood of each particle with one
+            pass over the topology, the result is stored in \a local_best.
+        */
+        void findLocalBest()
+        {
+            updateTopology();
+            local_best.resize( m_swarm.size() );
+            topology.findLocalBest( m_swarm.getBestValues(), compare_function, &local_best[0] );
+        }
+
+        /**
+            Computes the new velocity and position of all particles. If \a use_neighbours
+            is true the best neighbour found by \ref findBestNeighbour is included.
+            If \a local_best is not NULL the best position of particle local_best[i]
+            is used instead of \a global_best for particle i.
+            The random coefficients of all particles are generated at once before
+            the update.
+        */
+        void updateParticles( VectorN<double> &global_best, bool use_neighbours, const long *local_best = NULL )
+        {
+            if( m_swarm.empty() ) {return;}
+
+            random_coefficients.resize( m_swarm.size() * PhiloxRandom::coefficients_per_particle );
+            random_generator.fillCoefficients( iteration_steps, m_swarm.size(), &random_coefficients[0] );
+
+            if( Dim != Dynamic )
+            {
+                updateParticlesFixed<Dim>( &global_best[0], use_neighbours, local_best );
+                return;
+            }
+
+            switch( dimension )
+            {
+                case 2:
+                    updateParticlesFixed<2>( &global_best[0], use_neighbours, local_best );
+                    break;
+
+                case 3:
+                    updateParticlesFixed<3>( &global_best[0], use_neighbours, local_best );
+                    break;
+
+                default:
+                    for( size_t i = 0; i < m_swarm.size(); i++ )
+                    {
+                        const double *random = &random_coefficients[i * PhiloxRandom::coefficients_per_particle];
+
+                        if( local_best )
+                        {
+                            PSOKernel::update( m_swarm.getPosition( i ), m_swarm.getVelocity( i ), m_swarm.getBestPosition( i ), m_swarm.getBestPosition( local_best[i] ), NULL,
+                                               dimension, parameter_w, parameter_c1 * random[0], parameter_c2 * random[1], 0., limit_velocity_max );
+                        }
+                        else if( use_neighbours )
+                        {
+                            getParticle( i ).calcNewGlobalAndLocal( limit_velocity_max, parameter_c1, parameter_c2, parameter_c3, parameter_w, global_best, compare_function, random );
+                        }
+                        else
+                        {
+                            getParticle( i ).calcNewGlobal( limit_velocity_max, parameter_c1, parameter_c2, parameter_w, global_best, random );
+                        }
+                    }
+
+                    break;
+            }
+        }
+
+        /**
+            Same as the dynamic part of \ref updateParticles but with the dimension
+            \a D known at compile time. The random coefficients are used in the
+            same way as in \ref Particle::calcNewGlobalAndLocal.
+        */
+        template<size_t D>
+        void updateParticlesFixed( const double *global_best, bool use_neighbours, const long *local_best )
+        {
+            for( size_t i = 0; i < m_swarm.size(); i++ )
+            {
+                const double *social_best = local_best ? m_swarm.getBestPosition( local_best[i] ) : global_best;
+                long best_neighbour = use_neighbours ? m_swarm.getBestNeighbour( i ) : ParticleStore::no_neighbour;
+                const double *neighbour_position = NULL;
+                const double *random = &random_coefficients[i * PhiloxRandom::coefficients_per_particle];
+                double r1 = parameter_c1 * random[0], r2 = parameter_c2 * random[1], r3 = 0.;
+
+                if( best_neighbour != ParticleStore::no_neighbour )
+                {
+                    r3 = parameter_c3 * random[2];
+                    neighbour_position = m_swarm.getPosition( best_neighbour );
+                }
+
+                PSOKernel::updateFixed<D>( m_swarm.getPosition( i ), m_swarm.getVelocity( i ), m_swarm.getBestPosition( i ), social_best, neighbour_position,
+                                           parameter_w, r1, r2, r3, limit_velocity_max );
+            }
+        }
+
+        /**
+            Evaluates the particles [begin, end) with one call of \ref evaluateBatch,
+            updates their best values and reduces the statistics of the range into
+            \a result in the same loop.
+        */
+        void evaluateRange( Functor &func, size_t begin, size_t end, bool init, Statistics &result )
+        {
+            if( begin >= end ) {return;}
+
+            const double *current_values = m_swarm.getCurrentValues();
+            const double *best_values = m_swarm.getBestValues();
+
+            evaluateBatch( func, m_swarm.getPosition( begin ), end - begin, m_swarm.getStride(), dimension, m_swarm.getCurrentValues() + begin );
+
+            for( size_t i = begin; i < end; i++ )
+            {
+                if( init )
+                {
+                    getParticle( i ).initBest();
+                }
+                else if( getParticle( i ).updateBest( compare_function ) )
+                {
+                    result.improvements++;
+                }
+
+                if( result.best == ParticleStore::no_neighbour || ( *compare_function )( best_values[i], best_values[result.best] ) )
+                {
+                    result.best = i;
+                }
+
+                result.sum_current_values += current_values[i];
+            }
+
+            result.count += end - begin;
+        }
+
+        /**
+            Same reduction as in \ref evaluateRange without evaluating the particles.
+        */
+        void reduceRange( size_t begin, size_t end, Statistics &result )
+        {
+            const double *current_values = m_swarm.getCurrentValues();
+            const double *best_values = m_swarm.getBestValues();
+
+            for( size_t i = begin; i < end; i++ )
+            {
+                if( result.best == ParticleStore::no_neighbour || ( *compare_function )( best_values[i], best_values[result.best] ) )
+                {
+                    result.best = i;
+                }
+
+                result.sum_current_values += current_values[i];
+            }
+
+            result.count += end - begin;
+        }
+
+        /**
+            Merges the statistics \a b of a range behind the range of \a a into \a a.
+            The first of equal best values is kept, as in a sequential scan.
+        */
+        void mergeStatistics( Statistics &a, const Statistics &b )
+        {
+            const double *best_values = m_swarm.getBestValues();
+
+            if( b.best != ParticleStore::no_neighbour && ( a.best == ParticleStore::no_neighbour || ( *compare_function )( best_values[b.best], best_values[a.best] ) ) )
+            {
+                a.best = b.best;
+            }
+
+            a.sum_current_values += b.sum_current_values;
+            a.improvements += b.improvements;
+            a.count += b.count;
+        }
+
+        void applyStatistics()
+        {
+            global_best_particle = statistics.best != ParticleStore::no_neighbour ? getParticle( statistics.best ) : Particle();
+        }
+
+        void snapshotCheckpoint()
+        {
+            if( checkpoint_writer && iteration_steps % checkpoint_interval == 0 )
+            {
+                writeCheckpoint( checkpoint_writer->beginSnapshot() );
+                checkpoint_writer->commitSnapshot();
+            }
+        }
+
+        void recordTrajectory()
+        {
+            if( trajectory_recorder && !m_swarm.empty() )
+            {
+                trajectory_recorder->record( iteration_steps, m_swarm.getPositions(), m_swarm.getVelocities(), m_swarm.getStride(),
+                                             m_swarm.getCurrentValues(), m_swarm.size(), dimension );
+            }
+        }
+
+        void writeCheckpoint( CheckpointImage &image )
+        {
+            SwarmState state;
+            memset( &state, 0, sizeof( state ) );
+            state.dimension = dimension;
+            state.count = m_swarm.size();
+            state.iteration_steps = iteration_steps;
+            state.global_best_iterations = global_best_iterations;
+            state.abort_criterion_iterations = abort_criterion_iterations;
+            state.topology_neighbours = topology_neighbours;
+            state.improvements = statistics.improvements;
+            state.random_seed = random_generator.getSeed();
+            state.random_run = random_generator.getRun();
+            state.computation_methode = computation_methode;
+            state.execution_mode = execution_mode;
+            state.flags = ( auto_velocity ? CheckpointImage::flag_auto_velocity : 0 ) |
+                          ( check_abort_criterion ? CheckpointImage::flag_check_abort_criterion : 0 ) |
+                          ( compare_function == a_lt_b ? CheckpointImage::flag_compare_less : 0 );
+            state.global_best_previous = global_best_previous;
+            state.limit_velocity_max = limit_velocity_max;
+            state.limit_velocity_min = limit_velocity_min;
+            state.parameter_c1 = parameter_c1;
+            state.parameter_c2 = parameter_c2;
+            state.parameter_c3 = parameter_c3;
+            state.parameter_w = parameter_w;
+            state.parameter_neighbour_radius = parameter_neighbour_radius;
+            state.topology_rewiring = topology_rewiring;
+
+            image.create( state );
+
+            double *positions = image.getPositions(), *velocities = image.getVelocities(), *best_positions = image.getBestPositions();
+
+            for( size_t i = 0; i < m_swarm.size(); i++ )
+            {
+                memcpy( positions + i * dimension, m_swarm.getPosition( i ), dimension * sizeof( double ) );
+                memcpy( velocities + i * dimension, m_swarm.getVelocity( i ), dimension * sizeof( double ) );
+                memcpy( best_positions + i * dimension, m_swarm.getBestPosition( i ), dimension * sizeof( double ) );
+                image.getBestNeighbours()[i] = m_swarm.getBestNeighbour( i );
+                image.getUpdateCounts()[i] = i < async_update_counts.size() ? async_update_counts[i] : 0;
+            }
+
+            memcpy( image.getCurrentValues(), m_swarm.getCurrentValues(), m_swarm.size() * sizeof( double ) );
+            memcpy( image.getBestValues(), m_swarm.getBestValues(), m_swarm.size() * sizeof( double ) );
+        }
+
+        void readCheckpoint( const CheckpointImage &image )
+        {
+            const SwarmState &state = image.getState();
+
+            if( state.dimension != dimension ) {throw RuntimeError( "the dimension of the checkpoint does not match the swarm" );}
+
+            //the checksum only detects damage, the values are checked before the current swarm is dropped
+            if( state.computation_methode > SMALL_WORLD ) {throw RuntimeError( "the checkpoint contains an unknown computation method" );}
+
+            if( state.execution_mode > ASYNCHRONOUS ) {throw RuntimeError( "the checkpoint contains an unknown execution mode" );}
+
+            for( size_t i = 0; i < state.count; i++ )
+            {
+                int64_t neighbour = image.getBestNeighbours()[i];
+
+                if( neighbour != ParticleStore::no_neighbour && ( neighbour < 0 || static_cast<uint64_t>( neighbour ) >= state.count ) )
+                {
+                    throw RuntimeError( "the checkpoint contains an invalid best neighbour" );
+                }
+            }
+
+            clear();
+            m_swarm.reserve( state.count );
+
+            const double *positions = image.getPositions(), *velocities = image.getVelocities(), *best_positions = image.getBestPositions();
+
+            for( size_t i = 0; i < state.count; i++ )
+            {
+                size_t id = m_swarm.add();
+                memcpy( m_swarm.getPosition( id ), positions + i * dimension, dimension * sizeof( double ) );
+                memcpy( m_swarm.getVelocity( id ), velocities + i * dimension, dimension * sizeof( double ) );
+                memcpy( m_swarm.getBestPosition( id ), best_positions + i * dimension, dimension * sizeof( double ) );
+                m_swarm.getCurrentValue( id ) = image.getCurrentValues()[i];
+                m_swarm.getBestValue( id ) = image.getBestValues()[i];
+                m_swarm.getBestNeighbour( id ) = image.getBestNeighbours()[i];
+            }
+
+            async_update_counts.assign( image.getUpdateCounts(), image.getUpdateCounts() + state.count );
+
+            iteration_steps = state.iteration_steps;
+            global_best_iterations = state.global_best_iterations;
+            abort_criterion_iterations = state.abort_criterion_iterations;
+            topology_neighbours = state.topology_neighbours;
+            random_generator.setSeed( state.random_seed );
+            random_generator.setRun( state.random_run );
+            computation_methode = static_cast<ComutationMethode>( state.computation_methode );
+            execution_mode = static_cast<ExecutionMode>( state.execution_mode );
+            auto_velocity = ( state.flags & CheckpointImage::flag_auto_velocity ) != 0;
+            check_abort_criterion = ( state.flags & CheckpointImage::flag_check_abort_criterion ) != 0;
+            setCompare( ( state.flags & CheckpointImage::flag_compare_less ) != 0 );
+            global_best_previous = state.global_best_previous;
+            limit_velocity_max = state.limit_velocity_max;
+            limit_velocity_min = state.limit_velocity_min;
+            parameter_c1 = state.parameter_c1;
+            parameter_c2 = state.parameter_c2;
+            parameter_c3 = state.parameter_c3;
+            parameter_w = state.parameter_w;
+            parameter_neighbour_radius = state.parameter_neighbour_radius;
+            topology_rewiring = state.topology_rewiring;
+
+            reduceRange( 0, m_swarm.size(), statistics );
+            statistics.improvements = state.improvements;
+            applyStatistics();
+        }
+
         size_t              dimension;
         double              parameter_neighbour_radius;
         Functor             function;
-        Particle            *global_best_particle;
+        Particle            global_best_particle;
         ComutationMethode   computation_methode;
         bool ( *compare_function )( double, double );
         double              parameter_c1;
@@ -489,6 +1590,49 @@ class Swarm
         size_t              global_best_iterations;     //iterations since last change of m_global_best->best
         size_t              abort_criterion_iterations; //breaks if !(m_global_best_iterations < m_abort_criterion_iterations) is true
         bool                check_abort_criterion;
+
+        ThreadPool                  *thread_pool;
+        std::vector<Functor>        thread_functions;   //one copy of function for each worker thread
+        std::vector<EvaluationJob>  evaluation_jobs;
+        Statistics                  statistics;         //result of the last reduction over the whole swarm
+
+        ExecutionMode                   execution_mode;
+        pthread_mutex_t                 async_mutex;
+        pthread_cond_t                  async_dispatch;             //signals idle particles, the start of a step and the stop to the workers
+        pthread_cond_t                  async_progress;             //signals the end of a step to computeNextStepAsynchronous
+        std::deque<size_t>              async_ready;                //idle particles
+        bool                            async_running;              //the workers run in the thread pool
+        bool                            async_open;                 //a step is running, the workers may change the particles
+        bool                            async_stop;
+        bool                            async_failed;               //an evaluation has thrown async_error
+        std::string                     async_error;
+        uint64_t                        async_finished;             //finished evaluations since the workers were started
+        uint64_t                        async_target;               //value of async_finished at the end of the current step
+        size_t                          async_improvements;
+        bool                            async_use_neighbours;
+        bool                            async_use_topology;
+        std::vector<double>             async_global_best_position;
+        double                          async_global_best_value;
+        std::vector<uint32_t>           async_update_counts;        //number of updates of each particle
+        std::vector<uint8_t>            async_discard;              //the particle was replaced while it was evaluated
+        std::vector<AsynchronousJob>    asynchronous_jobs;
+
+        Topology                    topology;
+        bool                        topology_valid;
+        size_t                      topology_neighbours;
+        double                      topology_rewiring;
+        std::vector<long>           local_best;         //best particle of the neighbourhood of each particle
+
+        NeighbourIndex              neighbour_index;
+        std::vector<size_t>         neighbour_candidates;
+
+        PhiloxRandom                random_generator;
+        std::vector<double>         random_coefficients; //r1, r2 and r3 of each particle for the current iteration
+
+        CheckpointWriter            *checkpoint_writer;
+        size_t                      checkpoint_interval;
+
+        TrajectoryRecorder          *trajectory_recorder;
 };
 
 #endif
@@ -88,12 +88,16 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
         ui_methode_switch = new QComboBox( this );
         ui_methode_switch->addItem( "global best" );
         ui_methode_switch->addItem( "global&local best" );
+        ui_methode_switch->addItem( "ring" );
+        ui_methode_switch->addItem( "von Neumann" );
+        ui_methode_switch->addItem( "random-k" );
+        ui_methode_switch->addItem( "small world" );
         connect( ui_methode_switch, SIGNAL( activated( int ) ), this, SLOT( setComputationMode( int ) ) );
         connect( ui_methode_switch, SIGNAL( activated( int ) ), this, SLOT( changeComputationModeLayout( int ) ) );
         layout->addWidget( ui_methode_switch, row, 1 );
     }
 
-    parameter_widgetlist.resize( 2 );
+    parameter_widgetlist.resize( 6 ); //one list for each entry of ui_methode_switch
 
     row++;
     {
@@ -103,8 +107,11 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
         {
             current = new QLabel( "parameter c1:" );
             layout->addWidget( current, row, 0 );
-            parameter_widgetlist[0].push_back( current );
-            parameter_widgetlist[1].push_back( current );
+
+            for( int i = 0; i < parameter_widgetlist.size(); i++ )
+            {
+                parameter_widgetlist[i].push_back( current );
+            }
 
             ui_parameter_c1 = new QDoubleSpinBox( this );
             ui_parameter_c1->setRange( min, max );
@@ -112,16 +119,22 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
             ui_parameter_c1->setValue( 2 );
             connect( ui_parameter_c1, SIGNAL( valueChanged( double ) ), this, SLOT( setSwarmParameter() ) );
             layout->addWidget( ui_parameter_c1, row, 1 );
-            parameter_widgetlist[0].push_back( ui_parameter_c1 );
-            parameter_widgetlist[1].push_back( ui_parameter_c1 );
+
+            for( int i = 0; i < parameter_widgetlist.size(); i++ )
+            {
+                parameter_widgetlist[i].push_back( ui_parameter_c1 );
+            }
         }
 
         row++;
         {
             current = new QLabel( "parameter c2:" );
             layout->addWidget( current, row, 0 );
-            parameter_widgetlist[0].push_back( current );
-            parameter_widgetlist[1].push_back( current );
+
+            for( int i = 0; i < parameter_widgetlist.size(); i++ )
+            {
+                parameter_widgetlist[i].push_back( current );
+            }
 
             ui_parameter_c2 = new QDoubleSpinBox( this );
             ui_parameter_c2->setRange( min, max );
@@ -129,8 +142,11 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
             ui_parameter_c2->setValue( 2 );
             connect( ui_parameter_c2, SIGNAL( valueChanged( double ) ), this, SLOT( setSwarmParameter() ) );
             layout->addWidget( ui_parameter_c2, row, 1 );
-            parameter_widgetlist[0].push_back( ui_parameter_c2 );
-            parameter_widgetlist[1].push_back( ui_parameter_c2 );
+
+            for( int i = 0; i < parameter_widgetlist.size(); i++ )
+            {
+                parameter_widgetlist[i].push_back( ui_parameter_c2 );
+            }
         }
 
         row++;
@@ -152,8 +168,11 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
         {
             current = new QLabel( "parameter w:" );
             layout->addWidget( current, row, 0 );
-            parameter_widgetlist[0].push_back( current );
-            parameter_widgetlist[1].push_back( current );
+
+            for( int i = 0; i < parameter_widgetlist.size(); i++ )
+            {
+                parameter_widgetlist[i].push_back( current );
+            }
 
             ui_parameter_w = new QDoubleSpinBox( this );
             ui_parameter_w->setRange( 0, max );
@@ -161,8 +180,11 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
             ui_parameter_w->setValue( 1.0 );
             connect( ui_parameter_w, SIGNAL( valueChanged( double ) ), this, SLOT( setSwarmParameter() ) );
             layout->addWidget( ui_parameter_w, row, 1 );
-            parameter_widgetlist[0].push_back( ui_parameter_w );
-            parameter_widgetlist[1].push_back( ui_parameter_w );
+
+            for( int i = 0; i < parameter_widgetlist.size(); i++ )
+            {
+                parameter_widgetlist[i].push_back( ui_parameter_w );
+            }
         }
 
         row++;
@@ -180,6 +202,43 @@ SwarmControlWidget::SwarmControlWidget( MainWindow *mw, QWidget *parent, Qt::Win
             parameter_widgetlist[1].push_back( ui_parameter_neighbour_radius );
         }
 
+        row++;
+        {
+            current = new QLabel( "neighbours k:" );
+            layout->addWidget( current, row, 0 );
+
+            ui_parameter_topology_neighbours = new QSpinBox( this );
+            ui_parameter_topology_neighbours->setRange( 1, 1000 );
+            ui_parameter_topology_neighbours->setValue( 2 );
+            layout->addWidget( ui_parameter_topology_neighbours, row, 1 );
+            connect( ui_parameter_topology_neighbours, SIGNAL( valueChanged( int ) ), this, SLOT( setSwarmParameter() ) );
+
+            //ring, random-k and small world
+            for( int i = 2; i < parameter_widgetlist.size(); i++ )
+            {
+                if( i != 3 )
+                {
+                    parameter_widgetlist[i].push_back( current );
+                    parameter_widgetlist[i].push_back( ui_parameter_topology_neighbours );
+                }
+            }
+        }
+
+        row++;
+        {
+            current = new QLabel( "rewiring p:" );
+            layout->addWidget( current, row, 0 );
+            parameter_widgetlist[5].push_back( current );
+
+            ui_parameter_topology_rewiring = new QDoubleSpinBox( this );
+            ui_parameter_topology_rewiring->setRange( 0, 1 );
+            ui_parameter_topology_rewiring->setSingleStep( 0.01 );
+            ui_parameter_topology_rewiring->setValue( 0.1 );
+            layout->addWidget( ui_parameter_topology_rewiring, row, 1 );
+            connect( ui_parameter_topology_rewiring, SIGNAL( valueChanged( double ) ), this, SLOT( setSwarmParameter() ) );
+            parameter_widgetlist[5].push_back( ui_parameter_topology_rewiring );
+        }
+
         setSwarmParameter();
     }
 
@@ -341,21 +400,25 @@ void SwarmControlWidget::setMaxVelocity()
 
 void SwarmControlWidget::setComputationMode( int index )
 {
-    if( index != 0 && index != 1 ) {return;}
-
-    if( index == 0 ) // GLOBAL_BEST
+    //same order as the entries of ui_methode_switch
+    static const Swarm<Function>::ComutationMethode methodes[] =
     {
-        ui_mainwindow->getSwarm()->setComputationMethode( Swarm<Function>::GLOBAL_BEST );
-    }
-    else if( index == 1 ) // GLOBAL_LOCAL_BEST
-    {
-        ui_mainwindow->getSwarm()->setComputationMethode( Swarm<Function>::GLOBAL_LOCAL_BEST );
-    }
+        Swarm<Function>::GLOBAL_BEST,
+        Swarm<Function>::GLOBAL_LOCAL_BEST,
+        Swarm<Function>::RING,
+        Swarm<Function>::VON_NEUMANN,
+        Swarm<Function>::RANDOM_K,
+        Swarm<Function>::SMALL_WORLD
+    };
+
+    if( index < 0 || index >= static_cast<int>( sizeof( methodes ) / sizeof( methodes[0] ) ) ) {return;}
+
+    ui_mainwindow->getSwarm()->setComputationMethode( methodes[index] );
 }
 
 void SwarmControlWidget::changeComputationModeLayout( int index )
 {
-    if( index != 0 && index != 1 ) {return;}
+    if( index < 0 || index >= parameter_widgetlist.size() ) {return;}
 
     if( index < static_cast<int>( parameter_widgetlist.size() ) )
     {
@@ -382,6 +445,8 @@ void SwarmControlWidget::setSwarmParameter()
     swarm->setParameterC3( ui_parameter_c3->value() );
     swarm->setParameterW( ui_parameter_w->value() );
     swarm->setNeighbourRadius( ui_parameter_neighbour_radius->value() );
+    swarm->setTopologyNeighbours( ui_parameter_topology_neighbours->value() );
+    swarm->setTopologyRewiring( ui_parameter_topology_rewiring->value() );
 }
 
 void SwarmControlWidget::createSwarm()
@@ -83,6 +83,8 @@ class SwarmControlWidget :  public QWidget
         QDoubleSpinBox      *ui_parameter_c3;
         QDoubleSpinBox      *ui_parameter_w;
         QDoubleSpinBox      *ui_parameter_neighbour_radius;
+        QSpinBox            *ui_parameter_topology_neighbours;
+        QDoubleSpinBox      *ui_parameter_topology_rewiring;
 
         QDoubleSpinBox      *ui_max_velocity;
         QCheckBox           *ui_abort_criterion;
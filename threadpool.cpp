@@ -0,0 +1,204 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "threadpool.h"
+
+#include <unistd.h>
+
+#include "exception.h"
+
+/**
+    Starts \a num_threads worker threads. If \a num_threads is zero the number
+    of online processors is used.
+
+    \param[in] num_threads
+*/
+ThreadPool::ThreadPool( size_t num_threads ) : active_jobs( 0 ), stop( false ), error_occurred( false )
+{
+    if( num_threads == 0 )
+    {
+        num_threads = getNumberOfCPUs();
+    }
+
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &job_available, NULL );
+    pthread_cond_init( &jobs_done, NULL );
+
+    threads.resize( num_threads );
+    worker_infos.resize( num_threads );
+
+    for( size_t i = 0; i < num_threads; i++ )
+    {
+        worker_infos[i].pool = this;
+        worker_infos[i].thread_id = i;
+
+        if( pthread_create( &threads[i], NULL, workerEntry, &worker_infos[i] ) != 0 )
+        {
+            //the destructor is not called, so the threads already started are stopped here
+            threads.resize( i );
+            shutdown();
+            throw RuntimeError( "Unable to create worker thread" );
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+/**
+    Adds \a job to the queue. The pool does not take the ownership of \a job,
+    it has to stay valid until \ref wait returns.
+
+    \param[in] job
+*/
+void ThreadPool::enqueue( Job *job )
+{
+    pthread_mutex_lock( &mutex );
+    queue.push_back( job );
+    pthread_cond_signal( &job_available );
+    pthread_mutex_unlock( &mutex );
+}
+
+/**
+    Blocks until all queued jobs are finished.
+*/
+void ThreadPool::wait()
+{
+    pthread_mutex_lock( &mutex );
+
+    while( !queue.empty() || active_jobs > 0 )
+    {
+        pthread_cond_wait( &jobs_done, &mutex );
+    }
+
+    bool error = error_occurred;
+    std::string message = error_message;
+    error_occurred = false;
+    error_message.clear();
+
+    pthread_mutex_unlock( &mutex );
+
+    if( error )
+    {
+        throw RuntimeError( message );
+    }
+}
+
+size_t ThreadPool::getNumberOfThreads() const
+{
+    return threads.size();
+}
+
+size_t ThreadPool::getNumberOfCPUs()
+{
+    long num = sysconf( _SC_NPROCESSORS_ONLN );
+    return num > 0 ? static_cast<size_t>( num ) : 1;
+}
+
+/**
+    Lets the worker threads finish the queued jobs, joins them and releases
+    the synchronisation objects.
+*/
+void ThreadPool::shutdown()
+{
+    pthread_mutex_lock( &mutex );
+    stop = true;
+    pthread_cond_broadcast( &job_available );
+    pthread_mutex_unlock( &mutex );
+
+    for( size_t i = 0; i < threads.size(); i++ )
+    {
+        pthread_join( threads[i], NULL );
+    }
+
+    pthread_cond_destroy( &jobs_done );
+    pthread_cond_destroy( &job_available );
+    pthread_mutex_destroy( &mutex );
+}
+
+void *ThreadPool::workerEntry( void *arg )
+{
+    WorkerInfo *info = static_cast<WorkerInfo *>( arg );
+    info->pool->workerLoop( info->thread_id );
+    return NULL;
+}
+
+void ThreadPool::workerLoop( size_t thread_id )
+{
+    pthread_mutex_lock( &mutex );
+
+    while( true )
+    {
+        while( queue.empty() && !stop )
+        {
+            pthread_cond_wait( &job_available, &mutex );
+        }
+
+        if( queue.empty() && stop )
+        {
+            break;
+        }
+
+        Job *job = queue.front();
+        queue.pop_front();
+        active_jobs++;
+        pthread_mutex_unlock( &mutex );
+
+        std::string message;
+        bool error = false;
+
+        try
+        {
+            job->run( thread_id );
+        }
+        catch( Exception &err )
+        {
+            error = true;
+            message = err.getMessage();
+        }
+        catch( std::exception &err )
+        {
+            error = true;
+            message = err.what();
+        }
+        catch( ... )
+        {
+            error = true;
+            message = "Unknown exception in worker thread";
+        }
+
+        pthread_mutex_lock( &mutex );
+        active_jobs--;
+
+        if( error && !error_occurred )
+        {
+            error_occurred = true;
+            error_message = message;
+        }
+
+        if( queue.empty() && active_jobs == 0 )
+        {
+            pthread_cond_broadcast( &jobs_done );
+        }
+    }
+
+    pthread_mutex_unlock( &mutex );
+}
@@ -0,0 +1,88 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+    A fixed number of worker threads which process jobs from a shared queue.
+    Each job gets the id of the worker thread which executes it. The id is a
+    number between zero and \ref getNumberOfThreads - 1 and can be used to
+    select per thread data like a private copy of the function to evaluate.
+
+    Exceptions thrown by a job, of any type, are caught in the worker thread
+    and the first message is rethrown as RuntimeError by \ref wait.
+*/
+class ThreadPool
+{
+    public:
+        class Job
+        {
+            public:
+                virtual ~Job() {}
+                virtual void run( size_t thread_id ) = 0;
+        };
+
+        ThreadPool( size_t num_threads = 0 );
+        virtual ~ThreadPool();
+
+        void enqueue( Job *job );
+        void wait();
+
+        size_t getNumberOfThreads() const;
+
+        static size_t getNumberOfCPUs();
+
+    private:
+        ThreadPool( const ThreadPool &other ) {}
+        ThreadPool &operator=( const ThreadPool &other ) {return *this;}
+
+        struct WorkerInfo
+        {
+            ThreadPool  *pool;
+            size_t      thread_id;
+        };
+
+        void shutdown();
+
+        static void *workerEntry( void *arg );
+        void workerLoop( size_t thread_id );
+
+        std::vector<pthread_t>  threads;
+        std::vector<WorkerInfo> worker_infos;
+
+        pthread_mutex_t         mutex;
+        pthread_cond_t          job_available;
+        pthread_cond_t          jobs_done;
+
+        std::deque<Job *>       queue;
+        size_t                  active_jobs;
+        bool                    stop;
+
+        bool                    error_occurred;
+        std::string             error_message;
+};
+
+#endif // THREADPOOL_H
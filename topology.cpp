@@ -0,0 +1,228 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "topology.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+Topology::Topology()
+{
+
+}
+
+/**
+    Each particle is connected to the \a k particles before and after it,
+    the ring is closed at the ends.
+
+    \param[in] num     number of particles
+    \param[in] k
+*/
+void Topology::createRing( size_t num, size_t k )
+{
+    std::vector<std::vector<uint32_t> > lists( num );
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        for( size_t m = 1; m <= k && m < num; m++ )
+        {
+            lists[i].push_back( ( i + m ) % num );
+            lists[i].push_back( ( i + num - m ) % num );
+        }
+    }
+
+    createFromLists( lists );
+}
+
+/**
+    The particles are placed row by row on a grid with about sqrt( \a num )
+    columns which is closed at the borders. Each particle is connected to the
+    particles above, below, left and right of it. Positions of the last row
+    which are not occupied are skipped.
+
+    \param[in] num     number of particles
+*/
+void Topology::createVonNeumann( size_t num )
+{
+    std::vector<std::vector<uint32_t> > lists( num );
+
+    if( num == 0 )
+    {
+        createFromLists( lists );
+        return;
+    }
+
+    size_t cols = static_cast<size_t>( ceil( sqrt( static_cast<double>( num ) ) ) );
+    size_t rows = ( num + cols - 1 ) / cols;
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        size_t r = i / cols, c = i % cols;
+        size_t candidates[4] =
+        {
+            ( ( r + rows - 1 ) % rows ) * cols + c,
+            ( ( r + 1 ) % rows ) * cols + c,
+            r * cols + ( c + cols - 1 ) % cols,
+            r * cols + ( c + 1 ) % cols
+        };
+
+        for( size_t n = 0; n < 4; n++ )
+        {
+            if( candidates[n] < num )
+            {
+                lists[i].push_back( candidates[n] );
+                lists[candidates[n]].push_back( i );
+            }
+        }
+    }
+
+    createFromLists( lists );
+}
+
+/**
+    Each particle gets \a k different randomly chosen neighbours. The relation
+    is not symmetric. The random numbers are taken from the topology stream of
+    \a random, so the topology is reproducible.
+
+    \param[in] num     number of particles
+    \param[in] k
+    \param[in] random
+*/
+void Topology::createRandom( size_t num, size_t k, const PhiloxRandom &random )
+{
+    std::vector<std::vector<uint32_t> > lists( num );
+
+    if( num > 0 && k >= num - 1 )
+    {
+        createRing( num, num );
+        return;
+    }
+
+    for( size_t i = 0; i < num; i++ )
+    {
+        uint32_t index = 0;
+
+        while( lists[i].size() < k )
+        {
+            size_t j = static_cast<size_t>( random.getRandomNumber( i, 0, PhiloxRandom::STREAM_TOPOLOGY, index++ ) * num );
+
+            if( j != i && std::find( lists[i].begin(), lists[i].end(), j ) == lists[i].end() )
+            {
+                lists[i].push_back( j );
+            }
+        }
+    }
+
+    createFromLists( lists );
+}
+
+/**
+    Watts-Strogatz small world: a ring with \a k neighbours on each side where
+    each edge is moved to a random particle with the probability \a p. The
+    relation is symmetric.
+
+    \param[in] num     number of particles
+    \param[in] k
+    \param[in] p
+    \param[in] random
+*/
+void Topology::createSmallWorld( size_t num, size_t k, double p, const PhiloxRandom &random )
+{
+    std::vector<std::vector<uint32_t> > lists( num );
+
+    for( size_t i = 0; i < num && num > 1; i++ )
+    {
+        uint32_t index = 0;
+
+        for( size_t m = 1; m <= k && m < num; m++ )
+        {
+            size_t j = ( i + m ) % num;
+
+            if( random.getRandomNumber( i, 0, PhiloxRandom::STREAM_TOPOLOGY, index++ ) < p )
+            {
+                do
+                {
+                    j = static_cast<size_t>( random.getRandomNumber( i, 0, PhiloxRandom::STREAM_TOPOLOGY, index++ ) * num );
+                }
+                while( j == i );
+            }
+
+            lists[i].push_back( j );
+            lists[j].push_back( i );
+        }
+    }
+
+    createFromLists( lists );
+}
+
+void Topology::clear()
+{
+    offsets.clear();
+    neighbours.clear();
+}
+
+/**
+    Writes for each particle the id of the particle with the best value in
+    its neighbourhood, including the particle itself, to \a local_best. Equal
+    values are resolved in favour of the particle itself and then the smaller id.
+
+    \param[in]  values      one value for each particle, usually the best values
+    \param[in]  compare
+    \param[out] local_best  size() entries
+*/
+void Topology::findLocalBest( const double *values, bool ( *compare )( double, double ), long *local_best ) const
+{
+    for( size_t i = 0; i < size(); i++ )
+    {
+        size_t best = i;
+
+        for( uint32_t n = offsets[i]; n < offsets[i + 1]; n++ )
+        {
+            if( ( *compare )( values[neighbours[n]], values[best] ) )
+            {
+                best = neighbours[n];
+            }
+        }
+
+        local_best[i] = best;
+    }
+}
+
+/**
+    Converts the neighbour lists into the compressed row form. Duplicates and
+    the particle itself are removed from the lists.
+*/
+void Topology::createFromLists( std::vector<std::vector<uint32_t> > &lists )
+{
+    offsets.resize( lists.size() + 1 );
+    neighbours.clear();
+    offsets[0] = 0;
+
+    for( size_t i = 0; i < lists.size(); i++ )
+    {
+        std::vector<uint32_t> &list = lists[i];
+        std::sort( list.begin(), list.end() );
+        list.erase( std::unique( list.begin(), list.end() ), list.end() );
+        list.erase( std::remove( list.begin(), list.end(), static_cast<uint32_t>( i ) ), list.end() );
+
+        neighbours.insert( neighbours.end(), list.begin(), list.end() );
+        offsets[i + 1] = neighbours.size();
+    }
+}
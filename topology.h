@@ -0,0 +1,79 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "philoxrandom.h"
+
+/**
+    Static neighbourhood of the particles of a swarm, stored in compressed
+    sparse row form: the neighbours of particle i are
+    neighbours[offsets[i]] ... neighbours[offsets[i + 1] - 1] in ascending order.
+    A particle is never its own neighbour, but it is always part of its
+    neighbourhood in \ref findLocalBest.
+
+    The topology is created once for a swarm size and afterwards only read,
+    so the local best of all particles is found in one pass over two arrays.
+*/
+class Topology
+{
+    public:
+        Topology();
+
+        void createRing( size_t num, size_t k );
+        void createVonNeumann( size_t num );
+        void createRandom( size_t num, size_t k, const PhiloxRandom &random );
+        void createSmallWorld( size_t num, size_t k, double p, const PhiloxRandom &random );
+        void clear();
+
+        size_t size() const;
+        size_t getNumberOfNeighbours( size_t id ) const;
+        const uint32_t *getNeighbours( size_t id ) const;
+
+        void findLocalBest( const double *values, bool ( *compare )( double, double ), long *local_best ) const;
+
+    protected:
+        void createFromLists( std::vector<std::vector<uint32_t> > &lists );
+
+        std::vector<uint32_t>   offsets;    //size() + 1 entries
+        std::vector<uint32_t>   neighbours;
+};
+
+inline size_t Topology::size() const
+{
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+inline size_t Topology::getNumberOfNeighbours( size_t id ) const
+{
+    return offsets[id + 1] - offsets[id];
+}
+
+inline const uint32_t *Topology::getNeighbours( size_t id ) const
+{
+    return neighbours.empty() ? NULL : &neighbours[0] + offsets[id];
+}
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,638 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trajectoryrecorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "exception.h"
+
+namespace
+{
+    const char magic_number[8] = {'P', 'S', 'O', 'T', 'R', 'A', 'J', '\0'};
+    const uint32_t byte_order_mark = 0x01020304;
+    const size_t block_alignment = 64;
+
+    struct TrajectoryHeader
+    {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    byte_order;
+        uint64_t    dimension;
+        uint64_t    count;
+        uint64_t    frames_per_chunk;
+        uint64_t    frame_size;
+        uint64_t    chunk_size;
+        uint64_t    data_offset;
+        uint64_t    max_chunks;
+        uint64_t    num_chunks;
+    };
+
+    struct TrajectoryIndexEntry
+    {
+        uint64_t    first_iteration;
+        uint64_t    num_frames;
+    };
+
+    size_t roundUp( size_t size, size_t alignment )
+    {
+        return ( size + alignment - 1 ) / alignment * alignment;
+    }
+
+    size_t getVectorBlockSize( size_t count, size_t dim )
+    {
+        return roundUp( count * dim * sizeof( double ), block_alignment );
+    }
+
+    TrajectoryIndexEntry *getIndex( char *header )
+    {
+        return reinterpret_cast<TrajectoryIndexEntry *>( header + roundUp( sizeof( TrajectoryHeader ), block_alignment ) );
+    }
+}
+
+/**
+    The file is created when the first frame is written.
+
+    \param[in] filename_
+    \param[in] frames_per_chunk_    number of frames which are mapped into memory at the same time
+    \param[in] max_chunks_          size of the index, the file holds at most frames_per_chunk_ * max_chunks_ frames
+    \param[in] queue_length         number of frames which can wait for the background thread
+    \param[in] drop_frames_         if true \ref record drops the frame instead of waiting for the background thread if the queue is full
+*/
+TrajectoryRecorder::TrajectoryRecorder( const std::string &filename_, size_t frames_per_chunk_, size_t max_chunks_, size_t queue_length, bool drop_frames_ ) :
+    filename( filename_ ),
+    frames_per_chunk( frames_per_chunk_ ? frames_per_chunk_ : 1 ),
+    max_chunks( max_chunks_ ? max_chunks_ : 1 ),
+    drop_frames( drop_frames_ ),
+    dimension( 0 ),
+    count( 0 ),
+    frame_size( 0 ),
+    chunk_size( 0 ),
+    data_offset( 0 ),
+    writing( false ),
+    recorded( 0 ),
+    dropped( 0 ),
+    stop( false ),
+    closed( false ),
+    full( false ),
+    error_occurred( false ),
+    fd( -1 ),
+    header( NULL ),
+    chunk( NULL ),
+    num_chunks( 0 ),
+    chunk_frames( 0 )
+{
+    buffers.resize( queue_length ? queue_length : 1 );
+
+    for( size_t i = 0; i < buffers.size(); i++ )
+    {
+        free_buffers.push_back( i );
+    }
+
+    pthread_mutex_init( &mutex, NULL );
+    pthread_cond_init( &frame_available, NULL );
+    pthread_cond_init( &frame_written, NULL );
+
+    if( pthread_create( &thread, NULL, writerEntry, this ) != 0 )
+    {
+        throw RuntimeError( "Unable to create trajectory thread" );
+    }
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    try
+    {
+        close();
+    }
+    catch( ... )
+    {
+    }
+
+    pthread_cond_destroy( &frame_written );
+    pthread_cond_destroy( &frame_available );
+    pthread_mutex_destroy( &mutex );
+}
+
+/**
+    Copies one frame into a free buffer and hands it over to the background
+    thread. Returns false if the frame was dropped because no buffer was free
+    or the file is full.
+    All frames must have the same number of particles and dimension. Throws a
+    RuntimeError if writing a previous frame has failed.
+
+    \param[in] iteration
+    \param[in] positions   \a count rows of \a stride doubles
+    \param[in] velocities  \a count rows of \a stride doubles
+    \param[in] stride
+    \param[in] values      \a count current values
+    \param[in] count_
+    \param[in] dim
+*/
+bool TrajectoryRecorder::record( uint64_t iteration, const double *positions, const double *velocities, size_t stride, const double *values, size_t count_, size_t dim )
+{
+    pthread_mutex_lock( &mutex );
+
+    if( error_occurred || closed )
+    {
+        pthread_mutex_unlock( &mutex );
+
+        if( closed ) {throw RuntimeError( "Trajectory recorder is closed" );}
+
+        throwError();
+    }
+
+    if( frame_size == 0 )
+    {
+        dimension = dim;
+        count = count_;
+        frame_size = block_alignment + 2 * getVectorBlockSize( count, dimension ) + getVectorBlockSize( count, 1 );
+
+        for( size_t i = 0; i < buffers.size(); i++ )
+        {
+            buffers[i].resize( frame_size / sizeof( uint64_t ) );
+        }
+    }
+    else if( dim != dimension || count_ != count )
+    {
+        pthread_mutex_unlock( &mutex );
+        throw RuntimeError( "The size of the swarm has changed while recording the trajectory" );
+    }
+
+    if( full )
+    {
+        dropped++;
+        pthread_mutex_unlock( &mutex );
+        return false;
+    }
+
+    while( free_buffers.empty() && !drop_frames && !error_occurred )
+    {
+        pthread_cond_wait( &frame_written, &mutex );
+    }
+
+    if( free_buffers.empty() )
+    {
+        dropped++;
+        pthread_mutex_unlock( &mutex );
+        return false;
+    }
+
+    size_t index = free_buffers.back();
+    free_buffers.pop_back();
+    pthread_mutex_unlock( &mutex );
+
+    std::vector<uint64_t> &buffer = buffers[index];
+    char *frame = reinterpret_cast<char *>( &buffer[0] );
+    double *frame_positions = reinterpret_cast<double *>( frame + block_alignment );
+    double *frame_velocities = reinterpret_cast<double *>( frame + block_alignment + getVectorBlockSize( count, dimension ) );
+    double *frame_values = reinterpret_cast<double *>( frame + block_alignment + 2 * getVectorBlockSize( count, dimension ) );
+
+    buffer[0] = iteration;
+
+    for( size_t i = 0; i < count; i++ )
+    {
+        memcpy( frame_positions + i * dimension, positions + i * stride, dimension * sizeof( double ) );
+        memcpy( frame_velocities + i * dimension, velocities + i * stride, dimension * sizeof( double ) );
+    }
+
+    memcpy( frame_values, values, count * sizeof( double ) );
+
+    pthread_mutex_lock( &mutex );
+    queued_buffers.push_back( index );
+    pthread_cond_signal( &frame_available );
+    pthread_mutex_unlock( &mutex );
+
+    return true;
+}
+
+/**
+    Waits until all recorded frames are written. Throws a RuntimeError if
+    writing a frame has failed.
+*/
+void TrajectoryRecorder::flush()
+{
+    pthread_mutex_lock( &mutex );
+
+    while( !queued_buffers.empty() || writing )
+    {
+        pthread_cond_wait( &frame_written, &mutex );
+    }
+
+    bool error = error_occurred;
+    pthread_mutex_unlock( &mutex );
+
+    if( error ) {throwError();}
+}
+
+/**
+    Writes the remaining frames, stops the background thread and closes the
+    file. Throws a RuntimeError if writing a frame has failed.
+*/
+void TrajectoryRecorder::close()
+{
+    pthread_mutex_lock( &mutex );
+
+    if( closed )
+    {
+        pthread_mutex_unlock( &mutex );
+        return;
+    }
+
+    closed = true;
+    stop = true;
+    pthread_cond_broadcast( &frame_available );
+    pthread_mutex_unlock( &mutex );
+
+    pthread_join( thread, NULL );
+
+    finishChunk();
+
+    if( header )
+    {
+        msync( header, data_offset, MS_SYNC );
+        munmap( header, data_offset );
+        header = NULL;
+    }
+
+    if( fd != -1 )
+    {
+        ::close( fd );
+        fd = -1;
+    }
+
+    if( error_occurred ) {throwError();}
+}
+
+const std::string &TrajectoryRecorder::getFilename() const
+{
+    return filename;
+}
+
+size_t TrajectoryRecorder::getFramesPerChunk() const
+{
+    return frames_per_chunk;
+}
+
+/**
+    Returns the number of frames the file can hold, further frames are
+    dropped.
+*/
+size_t TrajectoryRecorder::getMaxFrames() const
+{
+    return frames_per_chunk * max_chunks;
+}
+
+size_t TrajectoryRecorder::getNumberOfRecorded()
+{
+    pthread_mutex_lock( &mutex );
+    size_t num = recorded;
+    pthread_mutex_unlock( &mutex );
+    return num;
+}
+
+size_t TrajectoryRecorder::getNumberOfDropped()
+{
+    pthread_mutex_lock( &mutex );
+    size_t num = dropped;
+    pthread_mutex_unlock( &mutex );
+    return num;
+}
+
+void *TrajectoryRecorder::writerEntry( void *arg )
+{
+    static_cast<TrajectoryRecorder *>( arg )->writerLoop();
+    return NULL;
+}
+
+void TrajectoryRecorder::writerLoop()
+{
+    pthread_mutex_lock( &mutex );
+
+    for( ;; )
+    {
+        while( queued_buffers.empty() && !stop )
+        {
+            pthread_cond_wait( &frame_available, &mutex );
+        }
+
+        if( queued_buffers.empty() )
+        {
+            break;
+        }
+
+        size_t index = queued_buffers.front();
+        queued_buffers.pop_front();
+        writing = true;
+        bool skip = error_occurred;
+        pthread_mutex_unlock( &mutex );
+
+        std::string message;
+        bool written = false;
+
+        try
+        {
+            if( !skip )
+            {
+                written = writeFrame( buffers[index] );
+            }
+        }
+        catch( Exception &err )
+        {
+            message = err.getMessage();
+        }
+        catch( std::exception &err )
+        {
+            message = err.what();
+        }
+
+        pthread_mutex_lock( &mutex );
+
+        if( written )
+        {
+            recorded++;
+        }
+        else if( !skip && message.empty() )
+        {
+            dropped++;
+            full = true;
+        }
+        else if( !message.empty() && !error_occurred )
+        {
+            error_occurred = true;
+            error_message = message;
+        }
+
+        writing = false;
+        free_buffers.push_back( index );
+        pthread_cond_broadcast( &frame_written );
+    }
+
+    pthread_mutex_unlock( &mutex );
+}
+
+/**
+    Appends \a frame to the file. Returns false if the file is full.
+*/
+bool TrajectoryRecorder::writeFrame( const std::vector<uint64_t> &frame )
+{
+    if( fd == -1 )
+    {
+        createFile();
+    }
+
+    if( !chunk || chunk_frames == frames_per_chunk )
+    {
+        if( num_chunks == max_chunks )
+        {
+            return false;
+        }
+
+        finishChunk();
+        startChunk();
+    }
+
+    memcpy( chunk + chunk_frames * frame_size, &frame[0], frame_size );
+
+    TrajectoryIndexEntry &entry = getIndex( header )[num_chunks - 1];
+
+    if( chunk_frames == 0 )
+    {
+        entry.first_iteration = frame[0];
+    }
+
+    chunk_frames++;
+    __atomic_store_n( &entry.num_frames, chunk_frames, __ATOMIC_RELEASE );
+    return true;
+}
+
+void TrajectoryRecorder::createFile()
+{
+    size_t page_size = sysconf( _SC_PAGESIZE );
+
+    chunk_size = roundUp( frames_per_chunk * frame_size, page_size );
+    data_offset = roundUp( roundUp( sizeof( TrajectoryHeader ), block_alignment ) + max_chunks * sizeof( TrajectoryIndexEntry ), page_size );
+
+    fd = open( filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+
+    if( fd == -1 ) {throw RuntimeError( "Unable to create trajectory file " + filename );}
+
+    if( ftruncate( fd, data_offset ) != 0 ) {throw RuntimeError( "Unable to resize trajectory file " + filename );}
+
+    void *mapping = mmap( NULL, data_offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if( mapping == MAP_FAILED ) {throw RuntimeError( "Unable to map trajectory file " + filename );}
+
+    header = static_cast<char *>( mapping );
+
+    TrajectoryHeader *file_header = reinterpret_cast<TrajectoryHeader *>( header );
+    memcpy( file_header->magic, magic_number, sizeof( magic_number ) );
+    file_header->version = version;
+    file_header->byte_order = byte_order_mark;
+    file_header->dimension = dimension;
+    file_header->count = count;
+    file_header->frames_per_chunk = frames_per_chunk;
+    file_header->frame_size = frame_size;
+    file_header->chunk_size = chunk_size;
+    file_header->data_offset = data_offset;
+    file_header->max_chunks = max_chunks;
+    file_header->num_chunks = 0;
+}
+
+/**
+    Allocates the next chunk on the disk and maps it into memory.
+*/
+void TrajectoryRecorder::startChunk()
+{
+    if( num_chunks == max_chunks ) {throw RuntimeError( "Trajectory file " + filename + " is full" );}
+
+    off_t offset = data_offset + num_chunks * chunk_size;
+
+    //allocates the blocks, otherwise a full disk would raise SIGBUS when writing to the mapping
+    if( posix_fallocate( fd, offset, chunk_size ) != 0 ) {throw RuntimeError( "Unable to allocate space for trajectory file " + filename );}
+
+    void *mapping = mmap( NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset );
+
+    if( mapping == MAP_FAILED ) {throw RuntimeError( "Unable to map trajectory file " + filename );}
+
+    chunk = static_cast<char *>( mapping );
+    chunk_frames = 0;
+
+    TrajectoryIndexEntry &entry = getIndex( header )[num_chunks];
+    entry.first_iteration = 0;
+    entry.num_frames = 0;
+
+    num_chunks++;
+    __atomic_store_n( &reinterpret_cast<TrajectoryHeader *>( header )->num_chunks, num_chunks, __ATOMIC_RELEASE );
+}
+
+/**
+    Unmaps the current chunk, the kernel writes the pages back to the file.
+*/
+void TrajectoryRecorder::finishChunk()
+{
+    if( chunk )
+    {
+        munmap( chunk, chunk_size );
+        chunk = NULL;
+    }
+}
+
+void TrajectoryRecorder::throwError()
+{
+    pthread_mutex_lock( &mutex );
+    std::string message = error_message;
+    pthread_mutex_unlock( &mutex );
+
+    throw RuntimeError( message );
+}
+
+TrajectoryReader::TrajectoryReader( const std::string &filename ) : mapping( NULL ), size( 0 ), num_frames( 0 )
+{
+    int fd = open( filename.c_str(), O_RDONLY );
+
+    if( fd == -1 ) {throw RuntimeError( "Unable to open trajectory file " + filename );}
+
+    struct stat st;
+
+    if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < sizeof( TrajectoryHeader ) )
+    {
+        ::close( fd );
+        throw RuntimeError( "Trajectory file " + filename + " is truncated" );
+    }
+
+    mapping = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+
+    if( mapping == MAP_FAILED )
+    {
+        mapping = NULL;
+        throw RuntimeError( "Unable to map trajectory file " + filename );
+    }
+
+    size = st.st_size;
+
+    const TrajectoryHeader *header = static_cast<const TrajectoryHeader *>( mapping );
+
+    if( memcmp( header->magic, magic_number, sizeof( magic_number ) ) != 0 || header->byte_order != byte_order_mark || header->version > TrajectoryRecorder::version )
+    {
+        munmap( mapping, size );
+        mapping = NULL;
+        throw RuntimeError( "File " + filename + " is not a trajectory of a supported version" );
+    }
+
+    dimension = header->dimension;
+    count = header->count;
+    frame_size = header->frame_size;
+    chunk_size = header->chunk_size;
+    data_offset = header->data_offset;
+    frames_per_chunk = header->frames_per_chunk;
+
+    size_t num_chunks = __atomic_load_n( &header->num_chunks, __ATOMIC_ACQUIRE );
+    size_t index_offset = roundUp( sizeof( TrajectoryHeader ), block_alignment );
+    size_t max_doubles = size / sizeof( double );
+
+    //the fields are checked against each other and the file before they are used in getFrame, count and dimension first so the sizes do not overflow
+    if( count > max_doubles || dimension > max_doubles || ( dimension != 0 && count > max_doubles / dimension ) ||
+        frame_size != block_alignment + 2 * getVectorBlockSize( count, dimension ) + getVectorBlockSize( count, 1 ) ||
+        frames_per_chunk == 0 || frames_per_chunk > chunk_size / frame_size ||
+        data_offset > size || data_offset < index_offset || header->max_chunks > ( data_offset - index_offset ) / sizeof( TrajectoryIndexEntry ) ||
+        num_chunks > header->max_chunks )
+    {
+        munmap( mapping, size );
+        mapping = NULL;
+        throw RuntimeError( "Trajectory file " + filename + " has an invalid header" );
+    }
+
+    const TrajectoryIndexEntry *index = getIndex( static_cast<char *>( mapping ) );
+
+    //only complete chunks are taken, the file may still be written
+    for( size_t i = 0; i < num_chunks && ( size - data_offset ) / chunk_size > i; i++ )
+    {
+        size_t chunk_frames = __atomic_load_n( &index[i].num_frames, __ATOMIC_ACQUIRE );
+        num_frames += std::min( chunk_frames, frames_per_chunk );
+
+        //getFrame expects all chunks but the last one to be full
+        if( chunk_frames < frames_per_chunk )
+        {
+            break;
+        }
+    }
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    if( mapping ) munmap( mapping, size );
+}
+
+size_t TrajectoryReader::getDimension() const
+{
+    return dimension;
+}
+
+size_t TrajectoryReader::getNumberOfParticles() const
+{
+    return count;
+}
+
+size_t TrajectoryReader::getNumberOfFrames() const
+{
+    return num_frames;
+}
+
+uint64_t TrajectoryReader::getIteration( size_t frame ) const
+{
+    return *reinterpret_cast<const uint64_t *>( getFrame( frame ) );
+}
+
+/**
+    Returns getNumberOfParticles rows of getDimension values.
+*/
+const double *TrajectoryReader::getPositions( size_t frame ) const
+{
+    return reinterpret_cast<const double *>( getFrame( frame ) + block_alignment );
+}
+
+const double *TrajectoryReader::getVelocities( size_t frame ) const
+{
+    return reinterpret_cast<const double *>( getFrame( frame ) + block_alignment + getVectorBlockSize( count, dimension ) );
+}
+
+const double *TrajectoryReader::getValues( size_t frame ) const
+{
+    return reinterpret_cast<const double *>( getFrame( frame ) + block_alignment + 2 * getVectorBlockSize( count, dimension ) );
+}
+
+/**
+    All chunks except the last one are full, so the chunk of a frame follows
+    from its number.
+*/
+const char *TrajectoryReader::getFrame( size_t frame ) const
+{
+    if( frame >= num_frames ) {throw RuntimeError( "Frame out of range" );}
+
+    return static_cast<const char *>( mapping ) + data_offset + ( frame / frames_per_chunk ) * chunk_size + ( frame % frames_per_chunk ) * frame_size;
+}
@@ -0,0 +1,159 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRAJECTORYRECORDER_H
+#define TRAJECTORYRECORDER_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+/**
+    Streams the position, the velocity and the fitness of every particle of
+    each iteration into a binary file, see \ref Swarm::setTrajectoryRecorder.
+
+    The file starts with a header and a small index, followed by chunks of
+    \ref getFramesPerChunk frames. A frame holds the iteration number and the
+    positions, the velocities (count * dimension doubles each) and the current
+    values (count doubles) of all particles, each block starts on a multiple
+    of 64 bytes. The space of a chunk is allocated on the disk with
+    posix_fallocate before the chunk is mapped into memory, so only the chunk
+    which is written at the moment occupies memory. The index entry of a chunk
+    holds its first iteration and its number of frames and is updated after
+    each frame, therefore the file is readable while it is written and after a
+    crash. The file can be read with \ref TrajectoryReader.
+
+    \ref record only copies the particles into one of \a queue_length frame
+    buffers, the file is written by a background thread. If all buffers are
+    waiting for the background thread, \ref record waits for a free buffer,
+    so every frame is written. With \a drop_frames_ set to true the frame is
+    dropped instead of blocking the optimization; the number of lost frames
+    is reported by \ref getNumberOfDropped.
+
+    The index has room for \a max_chunks_ chunks, so the file holds at most
+    \ref getMaxFrames frames (262144 with the defaults). The frames after
+    that are not recorded and counted by \ref getNumberOfDropped as well, a
+    full file does not stop the optimization.
+*/
+class TrajectoryRecorder
+{
+    public:
+        static const uint32_t version = 1;
+
+        TrajectoryRecorder( const std::string &filename_, size_t frames_per_chunk_ = 64, size_t max_chunks_ = 4096, size_t queue_length = 2, bool drop_frames_ = false );
+        virtual ~TrajectoryRecorder();
+
+        bool record( uint64_t iteration, const double *positions, const double *velocities, size_t stride, const double *values, size_t count, size_t dim );
+        void flush();
+        void close();
+
+        const std::string &getFilename() const;
+        size_t getFramesPerChunk() const;
+        size_t getMaxFrames() const;
+        size_t getNumberOfRecorded();
+        size_t getNumberOfDropped();
+
+    private:
+        TrajectoryRecorder( const TrajectoryRecorder &other ) {}
+        TrajectoryRecorder &operator=( const TrajectoryRecorder &other ) {return *this;}
+
+        static void *writerEntry( void *arg );
+        void writerLoop();
+        bool writeFrame( const std::vector<uint64_t> &frame );
+        void createFile();
+        void startChunk();
+        void finishChunk();
+        void throwError();
+
+        std::string                         filename;
+        size_t                              frames_per_chunk;
+        size_t                              max_chunks;
+        bool                                drop_frames;
+
+        size_t                              dimension;          //fixed by the first frame
+        size_t                              count;
+        size_t                              frame_size;         //bytes
+        size_t                              chunk_size;         //bytes, multiple of the page size
+        size_t                              data_offset;        //first chunk, multiple of the page size
+
+        std::vector<std::vector<uint64_t> > buffers;
+        std::vector<size_t>                 free_buffers;
+        std::deque<size_t>                  queued_buffers;
+        bool                                writing;
+        size_t                              recorded;
+        size_t                              dropped;
+        bool                                stop;
+        bool                                closed;
+        bool                                full;               //all chunks of the index are used, further frames are dropped
+        bool                                error_occurred;
+        std::string                         error_message;
+
+        int                                 fd;                 //only used by the background thread from here on
+        char                                *header;            //header and index
+        char                                *chunk;             //mapping of the current chunk
+        size_t                              num_chunks;
+        size_t                              chunk_frames;       //frames in the current chunk
+
+        pthread_t                           thread;
+        pthread_mutex_t                     mutex;
+        pthread_cond_t                      frame_available;
+        pthread_cond_t                      frame_written;
+};
+
+/**
+    Read only access to a file written by \ref TrajectoryRecorder. The file
+    is mapped into memory, the frames are not copied.
+*/
+class TrajectoryReader
+{
+    public:
+        TrajectoryReader( const std::string &filename );
+        virtual ~TrajectoryReader();
+
+        size_t getDimension() const;
+        size_t getNumberOfParticles() const;
+        size_t getNumberOfFrames() const;
+
+        uint64_t getIteration( size_t frame ) const;
+        const double *getPositions( size_t frame ) const;
+        const double *getVelocities( size_t frame ) const;
+        const double *getValues( size_t frame ) const;
+
+    private:
+        TrajectoryReader( const TrajectoryReader &other ) {}
+        TrajectoryReader &operator=( const TrajectoryReader &other ) {return *this;}
+
+        const char *getFrame( size_t frame ) const;
+
+        void        *mapping;
+        size_t      size;
+        size_t      dimension;
+        size_t      count;
+        size_t      frame_size;
+        size_t      chunk_size;
+        size_t      data_offset;
+        size_t      frames_per_chunk;
+        size_t      num_frames;
+};
+
+#endif // TRAJECTORYRECORDER_H
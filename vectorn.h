@@ -28,28 +28,141 @@ along with pso. If not, see <http://www.gnu.org/licenses/>.
 #include<cmath>
 
 #include "exception.h"
-#include "error.h"
 
+/**
+    Arithmetic expressions of VectorN objects like a * w + ( b - c ) * r are not
+    evaluated by the operators itself. The operators only build a light weight
+    expression object which is evaluated element by element directly into the
+    destination when it is assigned to a VectorN. Therefore no temporary vector
+    is allocated. VectorExpression is the common base class of all expressions
+    (including VectorN) using the curiously recurring template pattern.
+*/
+template<typename T, typename E>
+class VectorExpression
+{
+    public:
+        typedef T value_type;
+
+        const E &expression() const
+        {
+            return static_cast<const E &>( *this );
+        }
+};
+
+template<typename T>
+class VectorN;
+
+/**
+    Leaf vectors are stored by reference inside an expression, all other nodes
+    by value because they are temporaries which are created by the operators.
+*/
+template<typename E>
+struct VectorExpressionStorage
+{
+    typedef const E type;
+};
+
+template<typename T>
+struct VectorExpressionStorage< VectorN<T> >
+{
+    typedef const VectorN<T> &type;
+};
+
+struct VectorAdd
+{
+    template<typename T>
+    static T apply( const T &a, const T &b )
+    {
+        return a + b;
+    }
+};
+
+struct VectorSub
+{
+    template<typename T>
+    static T apply( const T &a, const T &b )
+    {
+        return a - b;
+    }
+};
+
+template<typename T, typename L, typename R, typename Op>
+class VectorBinaryExpression : public VectorExpression<T, VectorBinaryExpression<T, L, R, Op> >
+{
+    public:
+        VectorBinaryExpression( const L &a_, const R &b_ ) : a( a_ ), b( b_ )
+        {
+            if( a.size() != b.size() )
+            {
+                throw RuntimeError( "Wrong Dimension N for Operation" );
+            }
+        }
+
+        T operator []( size_t i ) const
+        {
+            return Op::apply( a[i], b[i] );
+        }
+
+        size_t size() const
+        {
+            return a.size();
+        }
+
+    protected:
+        typename VectorExpressionStorage<L>::type a;
+        typename VectorExpressionStorage<R>::type b;
+};
+
+template<typename T, typename E>
+class VectorScaleExpression : public VectorExpression<T, VectorScaleExpression<T, E> >
+{
+    public:
+        VectorScaleExpression( const E &a_, const T &s_ ) : a( a_ ), s( s_ )
+        {
+        }
+
+        T operator []( size_t i ) const
+        {
+            return a[i] * s;
+        }
+
+        size_t size() const
+        {
+            return a.size();
+        }
+
+    protected:
+        typename VectorExpressionStorage<E>::type a;
+        T s;
+};
+
+/**
+    Vector of dynamic size. Vectors with up to \ref small_size elements are stored
+    inside the object itself and do not allocate any memory on the heap.
+*/
 template<typename T>
-class VectorN
+class VectorN : public VectorExpression<T, VectorN<T> >
 {
     public:
+        static const size_t small_size = 8;
+
         VectorN( size_t N_ );
         VectorN( const VectorN &vm );
+        template<typename E>
+        VectorN( const VectorExpression<T, E> &vm );
         ~VectorN();
         VectorN &operator = ( const VectorN &vm );
+        template<typename E>
+        VectorN &operator = ( const VectorExpression<T, E> &vm );
         VectorN &operator *= ( const T &vm );
-        VectorN &operator += ( const VectorN &vm );
-        VectorN &operator -= ( const VectorN &vm );
+        template<typename E>
+        VectorN &operator += ( const VectorExpression<T, E> &vm );
+        template<typename E>
+        VectorN &operator -= ( const VectorExpression<T, E> &vm );
 
         bool operator == ( const VectorN &vm ) const;
         bool compare_equal( const VectorN &a , const VectorN &b, double epsilon = 1e-30 ) const;
 
-        VectorN operator + ( const VectorN &vm ) const;
-        T operator * ( const VectorN &vm ) const;
-        VectorN operator * ( const T &vm ) const;
-        VectorN operator - ( const VectorN &vm ) const;
-
         T operator []( int i ) const;
         T &operator []( int i );
 
@@ -82,7 +195,7 @@ class VectorN
 
         friend std::ostream &operator << ( std::ostream &os, VectorN &vm )
         {
-            for( int i = 0; i < vm.N ; i++ )
+            for( size_t i = 0; i < vm.N ; i++ )
             {
                 os << vm.data_container[i] << std::endl;
             }
@@ -91,183 +204,259 @@ class VectorN
         }
 
     protected:
+        void allocate( size_t dim );
+
         size_t N;
-        std::vector<T> data_container;
+        size_t capacity;
+        T *data_container;          //points to small_buffer or to memory on the heap
+        T small_buffer[small_size];
 };
 
-template<typename T>
-VectorN<T>::VectorN( size_t N_ ) : N( N_ ), data_container( N )
+template<typename T, typename L, typename R>
+inline VectorBinaryExpression<T, L, R, VectorAdd> operator + ( const VectorExpression<T, L> &a, const VectorExpression<T, R> &b )
 {
-
+    return VectorBinaryExpression<T, L, R, VectorAdd>( a.expression(), b.expression() );
 }
 
-template<typename T>
-VectorN<T>::VectorN( const VectorN &vm ) : N( vm.N ), data_container( vm.data_container )
+template<typename T, typename L, typename R>
+inline VectorBinaryExpression<T, L, R, VectorSub> operator - ( const VectorExpression<T, L> &a, const VectorExpression<T, R> &b )
 {
-
+    return VectorBinaryExpression<T, L, R, VectorSub>( a.expression(), b.expression() );
 }
 
-template<typename T>
-VectorN<T>::~VectorN()
+template<typename T, typename E>
+inline VectorScaleExpression<T, E> operator * ( const VectorExpression<T, E> &a, const typename VectorExpression<T, E>::value_type &s )
 {
+    return VectorScaleExpression<T, E>( a.expression(), s );
+}
 
+template<typename T, typename E>
+inline VectorScaleExpression<T, E> operator * ( const typename VectorExpression<T, E>::value_type &s, const VectorExpression<T, E> &a )
+{
+    return VectorScaleExpression<T, E>( a.expression(), s );
 }
 
-template<typename T>
-void VectorN<T>::checkDimension( const VectorN<T> &var ) const
+/**
+    The product of two vector expressions is the dot product.
+*/
+template<typename T, typename L, typename R>
+inline T operator * ( const VectorExpression<T, L> &a, const VectorExpression<T, R> &b )
 {
-    if( N != var.N )
+    const L &l = a.expression();
+    const R &r = b.expression();
+
+    if( l.size() != r.size() )
     {
         throw RuntimeError( "Wrong Dimension N for Operation" );
     }
+
+    T ret = T();
+
+    for( size_t i = 0; i < l.size(); i++ )
+    {
+        ret += l[i] * r[i];
+    }
+
+    return ret;
 }
 
 template<typename T>
-VectorN<T> &VectorN<T>::operator = ( const VectorN<T> &vm )
+VectorN<T>::VectorN( size_t N_ ) : N( 0 ), capacity( small_size ), data_container( small_buffer )
 {
-    N = vm.N;
-    data_container = vm.data_container;
-    return *this;
+    allocate( N_ );
+    setAll( T() );
 }
 
 template<typename T>
-VectorN<T> &VectorN<T>::operator += ( const VectorN<T> &vm )
+VectorN<T>::VectorN( const VectorN &vm ) : VectorExpression<T, VectorN<T> >(), N( 0 ), capacity( small_size ), data_container( small_buffer )
 {
-    checkDimension( vm );
+    allocate( vm.N );
 
-    for( int i = 0; i < N ; i++ )
+    for( size_t i = 0; i < N ; i++ )
     {
-        data_container[i] += vm.data_container[i];
+        data_container[i] = vm.data_container[i];
     }
-
-    return *this;
 }
 
 template<typename T>
-VectorN<T> &VectorN<T>::operator *= ( const T &vm )
+template<typename E>
+VectorN<T>::VectorN( const VectorExpression<T, E> &vm ) : N( 0 ), capacity( small_size ), data_container( small_buffer )
 {
-    checkDimension( vm );
+    const E &e = vm.expression();
+    allocate( e.size() );
 
-    for( int i = 0; i < N ; i++ )
+    for( size_t i = 0; i < N ; i++ )
     {
-        data_container[i] *= vm;
+        data_container[i] = e[i];
     }
-
-    return *this;
 }
 
 template<typename T>
-VectorN<T> &VectorN<T>::operator -= ( const VectorN<T> &vm )
+VectorN<T>::~VectorN()
 {
-    checkDimension( vm );
-
-    for( int i = 0; i < N ; i++ )
+    if( data_container != small_buffer )
     {
-        data_container[i] -= vm.data_container[i];
+        delete [] data_container;
     }
-
-    return *this;
 }
 
+/**
+    Makes sure that there is room for \a dim elements and sets the size to \a dim.
+    The content is undefined afterwards if the memory had to be reallocated.
+*/
 template<typename T>
-void VectorN<T>::add( const VectorN<T> &vm, VectorN<T> &ret ) const
+void VectorN<T>::allocate( size_t dim )
 {
-    checkDimension( vm );
+    if( dim > capacity )
+    {
+        if( data_container != small_buffer )
+        {
+            delete [] data_container;
+        }
 
-    if( N != ret.N ) {ret.resize( N );}
+        data_container = new T[dim];
+        capacity = dim;
+    }
 
-    for( int i = 0; i < N ; i++ )
+    N = dim;
+}
+
+template<typename T>
+void VectorN<T>::checkDimension( const VectorN<T> &var ) const
+{
+    if( N != var.N )
     {
-        ret.data_container[i] = data_container[i] + vm.data_container[i];
+        throw RuntimeError( "Wrong Dimension N for Operation" );
     }
 }
 
+template<typename T>
+VectorN<T> &VectorN<T>::operator = ( const VectorN<T> &vm )
+{
+    if( this != &vm )
+    {
+        allocate( vm.N );
 
+        for( size_t i = 0; i < N ; i++ )
+        {
+            data_container[i] = vm.data_container[i];
+        }
+    }
+
+    return *this;
+}
+
+/**
+    Evaluates the expression \a vm element by element directly into this vector.
+    The vector itself may be part of the expression because each element only
+    depends on the elements of the operands with the same index.
+*/
 template<typename T>
-VectorN<T> VectorN<T>::operator + ( const VectorN<T> &vm ) const
+template<typename E>
+VectorN<T> &VectorN<T>::operator = ( const VectorExpression<T, E> &vm )
 {
-    checkDimension( vm );
-    VectorN<T> ret( N );
+    const E &e = vm.expression();
 
-    for( unsigned int i = 0; i < N ; i++ )
+    if( N != e.size() ) {resize( e.size() );}
+
+    for( size_t i = 0; i < N ; i++ )
     {
-        ret.data_container[i] = data_container[i] + vm.data_container[i];
+        data_container[i] = e[i];
     }
 
-    return ret;
+    return *this;
 }
 
 template<typename T>
-void VectorN<T>::mul( const T &vm, VectorN<T> &ret ) const
+template<typename E>
+VectorN<T> &VectorN<T>::operator += ( const VectorExpression<T, E> &vm )
 {
-    checkDimension( vm );
+    const E &e = vm.expression();
 
-    if( N != ret.N ) {ret.resize( N );}
+    if( N != e.size() )
+    {
+        throw RuntimeError( "Wrong Dimension N for Operation" );
+    }
 
-    for( int i = 0; i < N ; i++ )
+    for( size_t i = 0; i < N ; i++ )
     {
-        ret.data_container[i] = data_container[i] * vm;
+        data_container[i] += e[i];
     }
+
+    return *this;
 }
 
 template<typename T>
-T VectorN<T>::operator * ( const VectorN<T> &vm ) const
+VectorN<T> &VectorN<T>::operator *= ( const T &vm )
 {
-    checkDimension( vm );
-    T ret = data_container[0] * vm.data_container[0];
-
-    for( int i = 1; i < N ; i++ )
+    for( size_t i = 0; i < N ; i++ )
     {
-        ret += data_container[i] * vm.data_container[i];
+        data_container[i] *= vm;
     }
 
-    return ret;
+    return *this;
 }
 
 template<typename T>
-VectorN<T> VectorN<T>::operator * ( const T &vm ) const
+template<typename E>
+VectorN<T> &VectorN<T>::operator -= ( const VectorExpression<T, E> &vm )
 {
-    VectorN<T> ret( N );
+    const E &e = vm.expression();
 
-    for( unsigned int i = 0; i < N ; i++ )
+    if( N != e.size() )
     {
-        ret.data_container[i] = data_container[i] * vm;
+        throw RuntimeError( "Wrong Dimension N for Operation" );
     }
 
-    return ret;
+    for( size_t i = 0; i < N ; i++ )
+    {
+        data_container[i] -= e[i];
+    }
+
+    return *this;
 }
 
 template<typename T>
-void VectorN<T>::sub( const VectorN &vm, VectorN &ret ) const
+void VectorN<T>::add( const VectorN<T> &vm, VectorN<T> &ret ) const
 {
     checkDimension( vm );
 
     if( N != ret.N ) {ret.resize( N );}
 
-    for( int i = 0; i < N ; i++ )
+    for( size_t i = 0; i < N ; i++ )
     {
-        ret.data_container[i] = data_container[i] - vm.data_container[i];
+        ret.data_container[i] = data_container[i] + vm.data_container[i];
     }
 }
 
 template<typename T>
-VectorN<T> VectorN<T>::operator - ( const VectorN<T> &vm ) const
+void VectorN<T>::mul( const T &vm, VectorN<T> &ret ) const
+{
+    if( N != ret.N ) {ret.resize( N );}
+
+    for( size_t i = 0; i < N ; i++ )
+    {
+        ret.data_container[i] = data_container[i] * vm;
+    }
+}
+
+template<typename T>
+void VectorN<T>::sub( const VectorN &vm, VectorN &ret ) const
 {
     checkDimension( vm );
-    VectorN<T> ret( N );
 
-    for( unsigned int i = 0; i < N ; i++ )
+    if( N != ret.N ) {ret.resize( N );}
+
+    for( size_t i = 0; i < N ; i++ )
     {
         ret.data_container[i] = data_container[i] - vm.data_container[i];
     }
-
-    return ret;
 }
 
 template<typename T>
 void VectorN<T>::set( int i, T  t )
 {
-    if( ( i >= 0 ) && ( i < N ) )
+    if( ( i >= 0 ) && ( static_cast<size_t>( i ) < N ) )
     {
         data_container[i] = t;
     }
@@ -280,7 +469,7 @@ void VectorN<T>::set( int i, T  t )
 template<typename T>
 void VectorN<T>::setAll( T t )
 {
-    for( unsigned int i = 0; i < N ; i++ )
+    for( size_t i = 0; i < N ; i++ )
     {
         data_container[i] = t;
     }
@@ -289,7 +478,7 @@ void VectorN<T>::setAll( T t )
 template<typename T>
 T VectorN<T>::get( int i ) const
 {
-    if( ( i >= 0 ) && ( i < N ) )
+    if( ( i >= 0 ) && ( static_cast<size_t>( i ) < N ) )
     {
         return data_container[i];
     }
@@ -318,48 +507,57 @@ size_t VectorN<T>::size() const
     return N;
 }
 
+/**
+    Changes the size to \a dim. The existing elements are kept and new
+    elements are initialised with T().
+*/
 template<typename T>
 void VectorN<T>::resize( size_t dim )
 {
+    if( dim > capacity )
+    {
+        T *new_data = new T[dim];
+
+        for( size_t i = 0; i < N; i++ )
+        {
+            new_data[i] = data_container[i];
+        }
+
+        if( data_container != small_buffer )
+        {
+            delete [] data_container;
+        }
+
+        data_container = new_data;
+        capacity = dim;
+    }
+
+    for( size_t i = N; i < dim; i++ )
+    {
+        data_container[i] = T();
+    }
+
     N = dim;
-    data_container.resize( N );
 }
 
 template<typename T>
 T VectorN<T>::dotProduct( const VectorN &vm ) const
 {
-    checkDimension( vm );
-    T ret = data_container[0] * vm.data_container[0];
-
-    for( int i = 1; i < N ; i++ )
-    {
-        ret += data_container[i] * vm.data_container[i];
-    }
-
-    return ret;
+    return *this * vm;
 }
 
 template<typename T>
 void VectorN<T>::dotProduct( const VectorN &vm, T &ret ) const
 {
-    checkDimension( vm );
-
-    if( N != ret.N ) {ret.resize( N );}
-
-    ret = data_container[0] * vm.data_container[0];
-
-    for( int i = 1; i < N ; i++ )
-    {
-        ret += data_container[i] * vm.data_container[i];
-    }
+    ret = *this * vm;
 }
 
 template<typename T>
 T VectorN<T>::length() const
 {
-    T tmp = data_container[0] * data_container[0];
+    T tmp = T();
 
-    for( int i = 1; i < N; i++ )
+    for( size_t i = 0; i < N; i++ )
     {
         tmp += ( data_container[i] * data_container[i] );
     }
@@ -376,7 +574,7 @@ T VectorN<T>::abs() const
 template<typename T>
 VectorN<T> VectorN<T>::getNormalized( double epsilon ) const
 {
-    VectorN<T> ret;
+    VectorN<T> ret( N );
     getNormalized( ret, epsilon );
     return ret;
 }
@@ -384,8 +582,6 @@ VectorN<T> VectorN<T>::getNormalized( double epsilon ) const
 template<typename T>
 void VectorN<T>::getNormalized( VectorN<T> &result, double epsilon ) const
 {
-    if( N != result.N ) {result.resize( N );}
-
     T l = length();
 
     if( l <= epsilon )
@@ -393,10 +589,7 @@ void VectorN<T>::getNormalized( VectorN<T> &result, double epsilon ) const
         throw Exception( "Length of Vector is Zero" );
     }
 
-    for( int i = 0; i < N; i++ )
-    {
-        result.data_container[i] = result.data_container[i] / l;
-    }
+    result = *this * ( T( 1 ) / l );
 }
 
 template<typename T>
@@ -410,7 +603,7 @@ bool VectorN<T>::isZero( double epsilon ) const
 {
     bool zero = true;
 
-    for( unsigned int i = 0; i < data_container.size(); i++ )
+    for( size_t i = 0; i < N; i++ )
     {
         if( data_container[i] > epsilon )
         {
@@ -435,7 +628,7 @@ bool VectorN<T>::compare_equal( const VectorN<T> &a, const VectorN<T> &b, double
         throw RuntimeError( "Wrong Dimension N for Operation" );
     }
 
-    for( unsigned int i = 0 ; i < N; i++ )
+    for( size_t i = 0 ; i < a.N; i++ )
     {
         if( ( a.data_container[i] - b.data_container[i] ) > epsilon )
         {
@@ -452,14 +645,14 @@ std::string VectorN<T>::toString( unsigned int digits ) const
     std::stringstream ss;
     ss.precision( digits );
 
-    for( unsigned int i = 0; i < data_container.size() - 1; i++ )
+    for( size_t i = 0; i + 1 < N; i++ )
     {
         ss << data_container[i] << ",";
     }
 
-    if( data_container.size() > 0 )
+    if( N > 0 )
     {
-        ss << data_container[data_container.size() - 1];
+        ss << data_container[N - 1];
     }
 
     return ss.str();
@@ -0,0 +1,121 @@
+/**
+Copyright (C) 2008-2013 Stefan Kolb.
+
+This file is part of the program pso (particle swarm optimization).
+
+The program pso is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public
+License as published by the Free Software Foundation, either
+version 2 of the License, or (at your option) any later version.
+
+The program pso is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with pso. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VECTORVIEW_H
+#define VECTORVIEW_H
+
+#include <sstream>
+#include <string>
+#include <cmath>
+
+#include "vectorn.h"
+
+/**
+    A non owning view on \a N consecutive elements of type T. It is used to
+    access a single row of the contiguous blocks in \ref ParticleStore without
+    copying the data. The view is only valid as long as the underlying memory
+    is not reallocated.
+*/
+template<typename T>
+class VectorView
+{
+    public:
+        VectorView( T *data_ = NULL, size_t N_ = 0 ) : data( data_ ), N( N_ )
+        {
+        }
+
+        T operator []( int i ) const
+        {
+            return data[i];
+        }
+
+        T &operator []( int i )
+        {
+            return data[i];
+        }
+
+        size_t size() const
+        {
+            return N;
+        }
+
+        T *getData() const
+        {
+            return data;
+        }
+
+        T length() const
+        {
+            T tmp = 0;
+
+            for( size_t i = 0; i < N; i++ )
+            {
+                tmp += data[i] * data[i];
+            }
+
+            return sqrt( tmp );
+        }
+
+        void copyTo( VectorN<T> &ret ) const
+        {
+            if( ret.size() != N ) {ret.resize( N );}
+
+            for( size_t i = 0; i < N; i++ )
+            {
+                ret[i] = data[i];
+            }
+        }
+
+        void copyFrom( const VectorN<T> &vm )
+        {
+            if( vm.size() != N )
+            {
+                throw RuntimeError( "Wrong Dimension N for Operation" );
+            }
+
+            for( size_t i = 0; i < N; i++ )
+            {
+                data[i] = vm[i];
+            }
+        }
+
+        std::string toString( unsigned int digits = 3 ) const
+        {
+            std::stringstream ss;
+            ss.precision( digits );
+
+            for( size_t i = 0; i + 1 < N; i++ )
+            {
+                ss << data[i] << ",";
+            }
+
+            if( N > 0 )
+            {
+                ss << data[N - 1];
+            }
+
+            return ss.str();
+        }
+
+    protected:
+        T       *data;
+        size_t  N;
+};
+
+#endif // VECTORVIEW_H